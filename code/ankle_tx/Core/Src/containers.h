@@ -0,0 +1,219 @@
+/* ========================================
+   File: containers.h
+   Fixed-capacity Containers Shared by Ankle and Wrist Nodes
+
+   Header-only, no heap:
+   - Ring: wait-free single-producer/single-consumer
+     queue, safe between one ISR and one task or
+     handler. Capacity is a power of two; indices
+     run free and are masked on access, so every
+     slot is usable.
+   - Vec: array with a length and a fixed capacity.
+   - Pool: up to 32 fixed-size objects handed out
+     from a free bitmap, lock-free on Cortex-M3/M4.
+   Storage is declared with the *_DEFINE macros.
+   Keep both node copies of this file identical.
+   ======================================== */
+
+#ifndef CONTAINERS_H
+#define CONTAINERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+#define CONTAINERS_ASSERT(c, msg) static_assert(c, msg)
+#else
+#define CONTAINERS_ASSERT(c, msg) _Static_assert(c, msg)
+#endif
+
+/* ---------------- SPSC ring ----------------
+   head is written only by the producer, tail only by the consumer.
+   Each side reads the other's index with acquire and publishes its
+   own with release, which orders the slot copy against the index
+   (a DMB on Cortex-M, plain stores on x86). */
+
+typedef struct {
+    uint32_t head;
+    uint32_t tail;
+    uint32_t mask;
+    uint32_t elem_size;
+    uint8_t *buf;
+} Ring_t;
+
+#define RING_DEFINE(name, type, capacity) \
+    CONTAINERS_ASSERT(((capacity) & ((capacity) - 1)) == 0, #name " capacity must be a power of two"); \
+    static type name##_storage[capacity]; \
+    static Ring_t name = { 0, 0, (capacity) - 1, sizeof(type), (uint8_t *)name##_storage }
+
+static inline uint32_t Ring_Load(const uint32_t *index)
+{
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+static inline void Ring_Store(uint32_t *index, uint32_t value)
+{
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t Ring_Capacity(const Ring_t *r)
+{
+    return r->mask + 1;
+}
+
+/* Exact from either side, a lower/upper bound from the other */
+static inline uint32_t Ring_Count(const Ring_t *r)
+{
+    return Ring_Load(&r->head) - Ring_Load(&r->tail);
+}
+
+static inline uint32_t Ring_Space(const Ring_t *r)
+{
+    return Ring_Capacity(r) - Ring_Count(r);
+}
+
+/* Empty the ring; only while neither side is using it */
+static inline void Ring_Reset(Ring_t *r)
+{
+    r->head = 0;
+    r->tail = 0;
+}
+
+/* Producer: slot to fill in place, or NULL when full; Ring_Commit publishes it */
+static inline void *Ring_Slot(Ring_t *r)
+{
+    uint32_t head = r->head;
+    if (head - Ring_Load(&r->tail) > r->mask) return NULL;
+    return r->buf + (head & r->mask) * r->elem_size;
+}
+
+static inline void Ring_Commit(Ring_t *r)
+{
+    Ring_Store(&r->head, r->head + 1);
+}
+
+/* Producer: copy one element in; 0 when full */
+static inline uint8_t Ring_Push(Ring_t *r, const void *item)
+{
+    void *slot = Ring_Slot(r);
+    if (slot == NULL) return 0;
+    memcpy(slot, item, r->elem_size);
+    Ring_Commit(r);
+    return 1;
+}
+
+/* Consumer: oldest element, or NULL when empty; stays queued until Ring_Drop */
+static inline void *Ring_Peek(Ring_t *r)
+{
+    uint32_t tail = r->tail;
+    if (tail == Ring_Load(&r->head)) return NULL;
+    return r->buf + (tail & r->mask) * r->elem_size;
+}
+
+static inline void Ring_Drop(Ring_t *r, uint32_t n)
+{
+    Ring_Store(&r->tail, r->tail + n);
+}
+
+/* Consumer: copy the oldest element out; 0 when empty */
+static inline uint8_t Ring_Pop(Ring_t *r, void *item)
+{
+    void *slot = Ring_Peek(r);
+    if (slot == NULL) return 0;
+    memcpy(item, slot, r->elem_size);
+    Ring_Drop(r, 1);
+    return 1;
+}
+
+/* Byte rings (elem_size 1). Producer: all of data or nothing, at most two memcpy */
+static inline uint8_t Ring_Write(Ring_t *r, const void *data, uint32_t len)
+{
+    uint32_t head = r->head;
+    if (len > Ring_Capacity(r) - (head - Ring_Load(&r->tail))) return 0;
+
+    uint32_t at = head & r->mask;
+    uint32_t first = Ring_Capacity(r) - at;
+    if (first > len) first = len;
+    memcpy(r->buf + at, data, first);
+    memcpy(r->buf, (const uint8_t *)data + first, len - first);
+    Ring_Store(&r->head, head + len);
+    return 1;
+}
+
+/* Byte rings. Consumer: longest contiguous run of queued bytes, for a DMA or
+   interrupt-driven transmit; Ring_Drop(r, len) once it is out */
+static inline uint32_t Ring_Span(Ring_t *r, const uint8_t **data)
+{
+    uint32_t tail = r->tail;
+    uint32_t count = Ring_Load(&r->head) - tail;
+    uint32_t at = tail & r->mask;
+
+    if (count > Ring_Capacity(r) - at) count = Ring_Capacity(r) - at;
+    *data = r->buf + at;
+    return count;
+}
+
+/* ---------------- Fixed-capacity vector ---------------- */
+
+#define VEC_DEFINE(name, type, capacity) \
+    static struct { uint32_t len; type items[capacity]; } name
+
+#define Vec_Capacity(v)     (sizeof((v)->items) / sizeof((v)->items[0]))
+#define Vec_Len(v)          ((v)->len)
+#define Vec_Full(v)         ((v)->len >= Vec_Capacity(v))
+#define Vec_Clear(v)        ((v)->len = 0)
+#define Vec_At(v, i)        ((v)->items[i])
+
+/* Evaluates to 1 if item was appended, 0 when full */
+#define Vec_Push(v, item) \
+    (Vec_Full(v) ? 0 : ((v)->items[(v)->len++] = (item), 1))
+
+/* Remove element i, keeping order */
+#define Vec_Remove(v, i) \
+    do { \
+        memmove(&(v)->items[i], &(v)->items[(i) + 1], ((v)->len - (i) - 1) * sizeof((v)->items[0])); \
+        (v)->len--; \
+    } while (0)
+
+/* ---------------- Object pool ---------------- */
+
+typedef struct {
+    uint32_t free;          /* Bit i set: object i is free */
+    uint32_t elem_size;
+    uint32_t capacity;
+    uint8_t *buf;
+} Pool_t;
+
+#define POOL_DEFINE(name, type, capacity) \
+    CONTAINERS_ASSERT((capacity) >= 1 && (capacity) <= 32, #name " capacity must be 1..32"); \
+    static type name##_storage[capacity]; \
+    static Pool_t name = { (uint32_t)(0xFFFFFFFFull >> (32 - (capacity))), sizeof(type), (capacity), \
+                           (uint8_t *)name##_storage }
+
+/* NULL when every object is taken; callable from interrupts */
+static inline void *Pool_Alloc(Pool_t *p)
+{
+    uint32_t free = __atomic_load_n(&p->free, __ATOMIC_RELAXED);
+
+    while (free != 0) {
+        uint32_t bit = free & (~free + 1);
+        if (__atomic_compare_exchange_n(&p->free, &free, free & ~bit, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return p->buf + (uint32_t)__builtin_ctz(bit) * p->elem_size;
+        }
+    }
+    return NULL;
+}
+
+static inline void Pool_Free(Pool_t *p, void *obj)
+{
+    uint32_t index = (uint32_t)((uint8_t *)obj - p->buf) / p->elem_size;
+    __atomic_fetch_or(&p->free, 1u << index, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t Pool_Available(const Pool_t *p)
+{
+    return (uint32_t)__builtin_popcount(__atomic_load_n(&p->free, __ATOMIC_RELAXED));
+}
+
+#endif /* CONTAINERS_H */
@@ -0,0 +1,194 @@
+/* ========================================
+   File: dsp.c
+   DSP Kernels Shared by Ankle and Wrist Nodes
+   ======================================== */
+
+#include "dsp.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP)
+
+#include "cmsis_compiler.h"
+
+#else
+
+/* C versions of the Cortex-M4 SIMD instructions used below,
+   bit-exact with the hardware, for builds on other targets */
+static uint32_t dsp_ge;   /* APSR.GE lane flags */
+
+static inline int32_t dsp_lo(uint32_t v) { return (int16_t)(v & 0xFFFF); }
+static inline int32_t dsp_hi(uint32_t v) { return (int16_t)(v >> 16); }
+
+static inline uint64_t __SMLALD(uint32_t a, uint32_t b, uint64_t acc)
+{
+    return (uint64_t)((int64_t)acc + (int64_t)dsp_lo(a) * dsp_lo(b) + (int64_t)dsp_hi(a) * dsp_hi(b));
+}
+
+static inline uint32_t __SSUB16(uint32_t a, uint32_t b)
+{
+    int32_t lo = dsp_lo(a) - dsp_lo(b);
+    int32_t hi = dsp_hi(a) - dsp_hi(b);
+    dsp_ge = (lo >= 0 ? 0x3u : 0u) | (hi >= 0 ? 0xCu : 0u);
+    return ((uint32_t)lo & 0xFFFFu) | ((uint32_t)hi << 16);
+}
+
+static inline uint32_t __SEL(uint32_t a, uint32_t b)
+{
+    uint32_t lo = (dsp_ge & 0x3u) ? (a & 0xFFFFu) : (b & 0xFFFFu);
+    uint32_t hi = (dsp_ge & 0xCu) ? (a & 0xFFFF0000u) : (b & 0xFFFF0000u);
+    return lo | hi;
+}
+
+#endif /* __ARM_FEATURE_DSP */
+
+/* Two Q15 lanes in one word, low half first; unaligned loads are fine on M4 */
+static inline uint32_t DSP_Read2Q15(const void *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void DSP_Write2Q15(void *p, uint32_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+/* --- Biquad cascade --- */
+
+void DSP_BiquadQ31_Init(DSP_BiquadQ31_t *s, uint8_t num_stages, uint8_t post_shift, const int32_t *coeffs, int32_t *state)
+{
+    s->num_stages = num_stages;
+    s->post_shift = post_shift;
+    s->coeffs = coeffs;
+    s->state = state;
+    memset(state, 0, (size_t)num_stages * DSP_BIQUAD_STATE * sizeof(int32_t));
+}
+
+void DSP_BiquadQ31_Process(DSP_BiquadQ31_t *s, const int32_t *src, int32_t *dst, uint32_t n)
+{
+    const int32_t *c = s->coeffs;
+    int32_t *st = s->state;
+    const int32_t *in = src;
+    uint32_t shift = 31u - s->post_shift;
+
+    for (uint8_t stage = 0; stage < s->num_stages; stage++) {
+        int32_t b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+        int32_t x1 = st[0], x2 = st[1], y1 = st[2], y2 = st[3];
+
+        /* History stays in registers for the whole block */
+        for (uint32_t i = 0; i < n; i++) {
+            int32_t x0 = in[i];
+            /* 32x32->64 multiply-accumulates compile to SMLAL */
+            int64_t acc = (int64_t)b0 * x0;
+            acc += (int64_t)b1 * x1;
+            acc += (int64_t)b2 * x2;
+            acc += (int64_t)a1 * y1;
+            acc += (int64_t)a2 * y2;
+            int32_t y0 = (int32_t)(acc >> shift);
+
+            x2 = x1; x1 = x0;
+            y2 = y1; y1 = y0;
+            dst[i] = y0;
+        }
+
+        st[0] = x1; st[1] = x2; st[2] = y1; st[3] = y2;
+        c += DSP_BIQUAD_COEFFS;
+        st += DSP_BIQUAD_STATE;
+        in = dst;   /* Later stages run in place */
+    }
+}
+
+/* --- Peak tracking --- */
+
+void DSP_PeakQ31_Init(DSP_PeakQ31_t *s, int32_t floor, uint16_t refractory, uint16_t decay_q15, uint16_t keep_q15)
+{
+    s->threshold = floor;
+    s->floor = floor;
+    s->decay_q15 = decay_q15;
+    s->keep_q15 = keep_q15;
+    s->refractory = refractory;
+    s->since_peak = refractory;
+    s->prev = 0;
+    s->prev2 = 0;
+    s->index = 0;
+}
+
+uint16_t DSP_PeakQ31_Process(DSP_PeakQ31_t *s, const int32_t *src, uint32_t n, uint32_t *peaks, uint16_t max_peaks)
+{
+    uint16_t found = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t x = src[i];
+
+        /* prev is a local maximum above the running threshold */
+        if (s->prev > s->prev2 && s->prev >= x &&
+            s->prev > s->threshold && s->since_peak >= s->refractory) {
+            if (found < max_peaks) peaks[found++] = s->index - 1;
+            s->threshold = (int32_t)(((int64_t)s->prev * s->keep_q15) >> 15);
+            s->since_peak = 0;
+        } else {
+            s->threshold = (int32_t)(((int64_t)s->threshold * s->decay_q15) >> 15);
+            if (s->threshold < s->floor) s->threshold = s->floor;
+            if (s->since_peak < UINT16_MAX) s->since_peak++;
+        }
+
+        s->prev2 = s->prev;
+        s->prev = x;
+        s->index++;
+    }
+    return found;
+}
+
+/* --- Block statistics --- */
+
+int64_t DSP_SumQ31(const int32_t *src, uint32_t n)
+{
+    int64_t sum = 0;
+
+    for (uint32_t i = 0; i < n; i++) sum += src[i];
+    return sum;
+}
+
+uint64_t DSP_AbsDevQ31(const int32_t *src, uint32_t n, int32_t mean)
+{
+    uint64_t sum = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t d = (int64_t)src[i] - mean;
+        sum += (uint64_t)(d < 0 ? -d : d);
+    }
+    return sum;
+}
+
+/* Two products per SMLALD */
+int64_t DSP_DotQ15(const int16_t *a, const int16_t *b, uint32_t n)
+{
+    uint64_t acc = 0;
+    uint32_t i = 0;
+
+    for (; i + 1 < n; i += 2) {
+        acc = __SMLALD(DSP_Read2Q15(&a[i]), DSP_Read2Q15(&b[i]), acc);
+    }
+    int64_t sum = (int64_t)acc;
+    if (i < n) sum += (int32_t)a[i] * b[i];
+    return sum;
+}
+
+/* |a - b| in full: the difference of two int16 fits a uint16, so nothing saturates.
+   Both SSUB16 orders, then SEL keeps the lane whose subtraction did not go negative. */
+void DSP_AbsDiffQ15(const int16_t *a, const int16_t *b, uint16_t *dst, uint32_t n)
+{
+    uint32_t i = 0;
+
+    for (; i + 1 < n; i += 2) {
+        uint32_t va = DSP_Read2Q15(&a[i]), vb = DSP_Read2Q15(&b[i]);
+        uint32_t d = __SSUB16(va, vb);
+        uint32_t e = __SSUB16(vb, va);
+        DSP_Write2Q15(&dst[i], __SEL(e, d));
+    }
+    if (i < n) {
+        int32_t d = (int32_t)a[i] - b[i];
+        dst[i] = (uint16_t)(d < 0 ? -d : d);
+    }
+}
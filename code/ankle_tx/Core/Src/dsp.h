@@ -0,0 +1,65 @@
+/* ========================================
+   File: dsp.h
+   DSP Kernels Shared by Ankle and Wrist Nodes
+
+   Block filters and statistics over the sample
+   batches both nodes process: the wrist's HR
+   band-pass, pulse peaks, SpO2 statistics and
+   canceller dot products, the ankle's gyro swing.
+   On Cortex-M4 the Q15 paths use the dual-16-bit
+   SIMD instructions; elsewhere the same code runs
+   on C equivalents, which code/host/dsp_bench
+   checks against plain loops.
+   Keep both node copies of this file identical.
+   ======================================== */
+
+#ifndef DSP_H
+#define DSP_H
+
+#include <stdint.h>
+
+/* Biquad cascade, direct form I.
+   Coefficients per stage: b0, b1, b2, a1, a2 with
+   y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] + a1*y[n-1] + a2*y[n-2]
+   (feedback terms already negated, as in CMSIS-DSP),
+   stored in Q31 scaled down by 2^post_shift so that
+   values up to +/-2^post_shift fit.
+   State per stage: x[n-1], x[n-2], y[n-1], y[n-2]. */
+#define DSP_BIQUAD_COEFFS       5
+#define DSP_BIQUAD_STATE        4
+
+typedef struct {
+    uint8_t num_stages;
+    uint8_t post_shift;
+    const int32_t *coeffs;
+    int32_t *state;
+} DSP_BiquadQ31_t;
+
+/* Peak tracker with refractory period and decaying threshold */
+typedef struct {
+    int32_t threshold;
+    int32_t floor;
+    uint16_t decay_q15;     /* Threshold multiplier per sample */
+    uint16_t keep_q15;      /* Fraction of a peak kept as next threshold */
+    uint16_t refractory;    /* Minimum samples between peaks */
+    uint16_t since_peak;
+    int32_t prev;
+    int32_t prev2;
+    uint32_t index;         /* Running sample index */
+} DSP_PeakQ31_t;
+
+/* Biquad cascade; dst may be src */
+void DSP_BiquadQ31_Init(DSP_BiquadQ31_t *s, uint8_t num_stages, uint8_t post_shift, const int32_t *coeffs, int32_t *state);
+void DSP_BiquadQ31_Process(DSP_BiquadQ31_t *s, const int32_t *src, int32_t *dst, uint32_t n);
+
+/* Peak tracking; writes running sample indices of the peaks found, returns the count */
+void DSP_PeakQ31_Init(DSP_PeakQ31_t *s, int32_t floor, uint16_t refractory, uint16_t decay_q15, uint16_t keep_q15);
+uint16_t DSP_PeakQ31_Process(DSP_PeakQ31_t *s, const int32_t *src, uint32_t n, uint32_t *peaks, uint16_t max_peaks);
+
+/* Block statistics */
+int64_t DSP_SumQ31(const int32_t *src, uint32_t n);
+uint64_t DSP_AbsDevQ31(const int32_t *src, uint32_t n, int32_t mean);
+int64_t DSP_DotQ15(const int16_t *a, const int16_t *b, uint32_t n);
+void DSP_AbsDiffQ15(const int16_t *a, const int16_t *b, uint16_t *dst, uint32_t n);
+
+#endif /* DSP_H */
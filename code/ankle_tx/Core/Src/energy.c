@@ -0,0 +1,226 @@
+/* ========================================
+   File: energy.c
+   Power-state Accounting Shared by Ankle and Wrist Nodes
+   ======================================== */
+
+#include "energy.h"
+#include "fmt.h"
+
+/* One uAh is 3.6e6 uA*ms */
+#define ENERGY_UA_MS_PER_UAH    3600000ull
+
+static const char *const state_names[ENERGY_COUNT] = {
+#define ENERGY_NAME(id, name) name,
+    ENERGY_STATES(ENERGY_NAME)
+#undef ENERGY_NAME
+};
+
+const char *Energy_Name(EnergyState_t state)
+{
+    return state_names[state];
+}
+
+/* Charge, average current and battery life from the state times and currents */
+void Energy_Estimate(EnergyReport_t *r)
+{
+    uint64_t ua_ms = (uint64_t)r->base_ua * r->uptime_ms;
+
+    for (uint8_t i = 0; i < ENERGY_COUNT; i++) {
+        ua_ms += (uint64_t)r->state_ua[i] * r->state_ms[i];
+    }
+    r->charge_uah = (uint32_t)(ua_ms / ENERGY_UA_MS_PER_UAH);
+    r->avg_ua = r->uptime_ms ? (uint32_t)(ua_ms / r->uptime_ms) : r->base_ua;
+    r->runtime_min = r->avg_ua ? (uint32_t)((uint64_t)r->battery_uah * 60 / r->avg_ua) : UINT32_MAX;
+}
+
+/* Machine-readable line for host/energy_est:
+   energy,<uptime ms>,<base uA>,<battery uAh>,<state>=<ms>:<uA>,... */
+int Energy_FormatTrace(const EnergyReport_t *r, char *buf, int size)
+{
+    Fmt_t f;
+
+    Fmt_Init(&f, buf, (uint16_t)size);
+    Fmt_Str(&f, "energy,");
+    Fmt_U32(&f, r->uptime_ms);
+    Fmt_Char(&f, ',');
+    Fmt_U32(&f, r->base_ua);
+    Fmt_Char(&f, ',');
+    Fmt_U32(&f, r->battery_uah);
+    for (uint8_t i = 0; i < ENERGY_COUNT; i++) {
+        Fmt_Char(&f, ',');
+        Fmt_Str(&f, state_names[i]);
+        Fmt_Char(&f, '=');
+        Fmt_U32(&f, r->state_ms[i]);
+        Fmt_Char(&f, ':');
+        Fmt_U32(&f, r->state_ua[i]);
+    }
+    Fmt_Str(&f, "\r\n");
+    return Fmt_End(&f);
+}
+
+/* Charge, average, battery life and the share of uptime in each state */
+int Energy_FormatSummary(const EnergyReport_t *r, char *buf, int size)
+{
+    uint32_t uptime_min = r->uptime_ms / 60000;
+    uint32_t left_min = r->runtime_min > uptime_min ? r->runtime_min - uptime_min : 0;
+    Fmt_t f;
+
+    Fmt_Init(&f, buf, (uint16_t)size);
+    Fmt_Str(&f, "Energy: ");
+    Fmt_Fixed(&f, (int32_t)(r->charge_uah / 10), 2);
+    Fmt_Str(&f, " mAh in ");
+    Fmt_U32(&f, r->uptime_ms / 1000);
+    Fmt_Str(&f, " s, avg ");
+    Fmt_Fixed(&f, (int32_t)(r->avg_ua / 10), 2);
+    Fmt_Str(&f, " mA, battery life ");
+    Fmt_Fixed(&f, (int32_t)(r->runtime_min / 6), 1);
+    Fmt_Str(&f, " h (");
+    Fmt_Fixed(&f, (int32_t)(left_min / 6), 1);
+    Fmt_Str(&f, " h left);");
+    for (uint8_t i = 0; i < ENERGY_COUNT; i++) {
+        uint32_t permille = r->uptime_ms ? (uint32_t)((uint64_t)r->state_ms[i] * 1000 / r->uptime_ms) : 0;
+        Fmt_Char(&f, ' ');
+        Fmt_Str(&f, state_names[i]);
+        Fmt_Char(&f, ' ');
+        Fmt_Fixed(&f, (int32_t)permille, 1);
+        Fmt_Char(&f, '%');
+    }
+    Fmt_Str(&f, "\r\n");
+    return Fmt_End(&f);
+}
+
+#if defined(__arm__)
+
+#include "main.h"
+#include "timebase.h"
+#include "energy_table.h"
+
+static const uint32_t state_ua[ENERGY_COUNT] = ENERGY_CURRENTS_UA;
+
+static uint64_t state_us[ENERGY_COUNT];
+static uint64_t uptime_us;
+static uint32_t on_since[ENERGY_COUNT];
+static uint32_t on_mask;
+static uint32_t last_us;
+static uint32_t last_cycles;
+static uint32_t cycle_rest;         /* Awake cycles short of a whole us */
+static uint32_t stopped_us;
+
+static void Energy_Credit(EnergyState_t state, uint32_t now)
+{
+    int32_t on = (int32_t)(now - on_since[state]);
+
+    if (on > 0) state_us[state] += (uint32_t)on;
+    on_since[state] = now;
+}
+
+/* After Time_Init */
+void Energy_Init(void)
+{
+    /* CYCCNT keeps counting if something else already enabled it */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    last_us = Time_NowUs();
+    last_cycles = DWT->CYCCNT;
+    __set_PRIMASK(primask);
+}
+
+/* Peripheral states only; from tasks, handlers or interrupts */
+void Energy_Set(EnergyState_t state, uint8_t on)
+{
+    uint32_t bit = 1u << state;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (on && !(on_mask & bit)) {
+        on_since[state] = Time_NowUs();
+        on_mask |= bit;
+    } else if (!on && (on_mask & bit)) {
+        Energy_Credit(state, Time_NowUs());
+        on_mask &= ~bit;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void Energy_On(EnergyState_t state)
+{
+    Energy_Set(state, 1);
+}
+
+void Energy_Off(EnergyState_t state)
+{
+    Energy_Set(state, 0);
+}
+
+/* After a STOP-mode wakeup: how long the core was stopped (from the RTC or
+   the wakeup timer). Neither TIM2 nor CYCCNT counts it, so it is added to
+   the uptime on top of the wall time */
+void Energy_Stopped(uint32_t us)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stopped_us += us;
+    __set_PRIMASK(primask);
+}
+
+/* Splits the timebase time since the last call into active and sleep, adds
+   any stop time and credits the peripheral states still on; interrupts masked */
+static void Energy_Advance(void)
+{
+    uint32_t now = Time_NowUs();
+    uint32_t cycles = DWT->CYCCNT;
+    uint32_t per_us = SystemCoreClock / 1000000;
+    uint64_t awake_cycles = (uint64_t)(cycles - last_cycles) + cycle_rest;
+    uint32_t wall = now - last_us;
+    uint32_t awake = (uint32_t)(awake_cycles / per_us);
+
+    cycle_rest = (uint32_t)(awake_cycles % per_us);
+    if (awake > wall) awake = wall;
+
+    state_us[ENERGY_ACTIVE] += awake;
+    state_us[ENERGY_SLEEP] += wall - awake;
+    state_us[ENERGY_STOP] += stopped_us;
+    uptime_us += (uint64_t)wall + stopped_us;
+    stopped_us = 0;
+
+    for (uint8_t i = ENERGY_FIRST_PERIPHERAL; i < ENERGY_COUNT; i++) {
+        if (on_mask & (1u << i)) Energy_Credit((EnergyState_t)i, now);
+    }
+    last_us = now;
+    last_cycles = cycles;
+}
+
+/* Must run more often than CYCCNT wraps: 537 s at 8 MHz (ankle), 23.8 s at 180 MHz (wrist) */
+void Energy_Update(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Energy_Advance();
+    __set_PRIMASK(primask);
+}
+
+/* Totals since Energy_Init with this node's current table */
+void Energy_Report(EnergyReport_t *r)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Energy_Advance();
+    r->uptime_ms = (uint32_t)(uptime_us / 1000);
+    for (uint8_t i = 0; i < ENERGY_COUNT; i++) {
+        r->state_ms[i] = (uint32_t)(state_us[i] / 1000);
+    }
+    __set_PRIMASK(primask);
+
+    r->base_ua = ENERGY_BASE_UA;
+    r->battery_uah = ENERGY_BATTERY_UAH;
+    for (uint8_t i = 0; i < ENERGY_COUNT; i++) {
+        r->state_ua[i] = state_ua[i];
+    }
+    Energy_Estimate(r);
+}
+
+#endif /* __arm__ */
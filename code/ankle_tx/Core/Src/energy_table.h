@@ -0,0 +1,37 @@
+/* ========================================
+   File: energy_table.h
+   Ankle Node Current Table
+
+   uA at the 5 V input for energy.c. Base comes
+   from the power spreadsheet (documents/POWER_CONS
+   & SIZE_DATA.xlsx). The MCU rows are F303xE
+   datasheet typicals for this node's clock, the
+   8 MHz HSI without the PLL, code in flash, all
+   peripherals clocked; the spreadsheet's 25 mA
+   was for 72 MHz. The rest are datasheet
+   typicals until measured.
+   ======================================== */
+
+#ifndef ENERGY_TABLE_H
+#define ENERGY_TABLE_H
+
+/* Always drawn: MPU6050 module 4 mA, nRF24 standby 26 uA */
+#define ENERGY_BASE_UA          4026
+
+/* 500 mAh cell at 3.2 V behind the 5 V boost, counted as the spreadsheet
+   does (500 * 3.2 / 5) */
+#define ENERGY_BATTERY_UAH      320000
+
+/* Added on top of the base while in each state */
+#define ENERGY_CURRENTS_UA { \
+    [ENERGY_SLEEP]    = 4400,  /* F303 at 8 MHz HSI in WFI */ \
+    [ENERGY_STOP]     = 300,   /* Not entered yet */ \
+    [ENERGY_ACTIVE]   = 7300,  /* F303 running at 8 MHz HSI */ \
+    [ENERGY_I2C]      = 700,   /* 4.7 k pull-ups at 3.3 V, each line low about half the time */ \
+    [ENERGY_RADIO_TX] = 7500,  /* nRF24 TX at -12 dBm (PA_LOW); the ACK wait is counted here too */ \
+    [ENERGY_RADIO_RX] = 12600, /* nRF24 RX at 250 kbps; this node never listens */ \
+    [ENERGY_SD]       = 0,     /* No card on this node */ \
+    [ENERGY_LED]      = 2000,  /* Nucleo LD2 */ \
+}
+
+#endif /* ENERGY_TABLE_H */
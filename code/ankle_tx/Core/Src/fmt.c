@@ -0,0 +1,154 @@
+/* ========================================
+   File: fmt.c
+   Text Formatting Shared by Ankle and Wrist Nodes
+   ======================================== */
+
+#include "fmt.h"
+#include <string.h>
+
+static const uint32_t pow10_table[FMT_MAX_DECIMALS + 1] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+void Fmt_Init(Fmt_t *f, char *buf, uint16_t size)
+{
+    f->buf = buf;
+    f->size = size;
+    f->len = 0;
+    f->truncated = 0;
+    if (size > 0) buf[0] = 0;
+}
+
+/* One byte is always left for the terminator */
+void Fmt_Char(Fmt_t *f, char c)
+{
+    if (f->len + 1 >= f->size) {
+        f->truncated = 1;
+        return;
+    }
+    f->buf[f->len++] = c;
+}
+
+void Fmt_Str(Fmt_t *f, const char *s)
+{
+    while (*s) Fmt_Char(f, *s++);
+}
+
+/* Digits of value, at least min_digits with leading zeros */
+static void Fmt_Digits(Fmt_t *f, uint32_t value, uint8_t min_digits)
+{
+    char tmp[10];
+    uint8_t n = 0;
+
+    do {
+        tmp[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (n < min_digits) tmp[n++] = '0';
+    while (n > 0) Fmt_Char(f, tmp[--n]);
+}
+
+void Fmt_U32(Fmt_t *f, uint32_t value)
+{
+    Fmt_Digits(f, value, 1);
+}
+
+void Fmt_I32(Fmt_t *f, int32_t value)
+{
+    if (value < 0) {
+        Fmt_Char(f, '-');
+        Fmt_Digits(f, 0u - (uint32_t)value, 1);
+    } else {
+        Fmt_Digits(f, (uint32_t)value, 1);
+    }
+}
+
+/* 64-bit division only for values that need it, nine digits at a time */
+void Fmt_U64(Fmt_t *f, uint64_t value)
+{
+    if (value > UINT32_MAX) {
+        Fmt_U64(f, value / 1000000000u);
+        Fmt_Digits(f, (uint32_t)(value % 1000000000u), 9);
+        return;
+    }
+    Fmt_Digits(f, (uint32_t)value, 1);
+}
+
+void Fmt_I64(Fmt_t *f, int64_t value)
+{
+    if (value < 0) {
+        Fmt_Char(f, '-');
+        Fmt_U64(f, 0u - (uint64_t)value);
+    } else {
+        Fmt_U64(f, (uint64_t)value);
+    }
+}
+
+/* Upper case, exactly digits wide (1..8) */
+void Fmt_Hex(Fmt_t *f, uint32_t value, uint8_t digits)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    while (digits > 0) {
+        digits--;
+        Fmt_Char(f, hex[(value >> (digits * 4)) & 0xF]);
+    }
+}
+
+/* value / 10^decimals, e.g. (2537, 2) -> "25.37", (-5, 2) -> "-0.05" */
+void Fmt_Fixed(Fmt_t *f, int32_t value, uint8_t decimals)
+{
+    uint32_t mag = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+
+    if (decimals > FMT_MAX_DECIMALS) decimals = FMT_MAX_DECIMALS;
+    if (value < 0) Fmt_Char(f, '-');
+    Fmt_Digits(f, mag / pow10_table[decimals], 1);
+    if (decimals == 0) return;
+    Fmt_Char(f, '.');
+    Fmt_Digits(f, mag % pow10_table[decimals], decimals);
+}
+
+/* Rounded to decimals places, without a negative zero; "nan", or "ovf"
+   past +/-2^31 in the last place */
+void Fmt_Float(Fmt_t *f, float value, uint8_t decimals)
+{
+    if (decimals > FMT_MAX_DECIMALS) decimals = FMT_MAX_DECIMALS;
+    float scaled = value * (float)pow10_table[decimals];
+
+    if (scaled != scaled) {
+        Fmt_Str(f, "nan");
+        return;
+    }
+    if (scaled >= 2147483647.0f || scaled <= -2147483647.0f) {
+        Fmt_Str(f, "ovf");
+        return;
+    }
+    Fmt_Fixed(f, (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f), decimals);
+}
+
+/* Right-align what was written since start in width columns */
+void Fmt_Right(Fmt_t *f, uint16_t start, uint8_t width)
+{
+    uint16_t used = f->len - start;
+    if (used >= width) return;
+
+    uint16_t pad = width - used;
+    if (f->len + pad >= f->size) {
+        f->truncated = 1;
+        return;
+    }
+    memmove(&f->buf[start + pad], &f->buf[start], used);
+    memset(&f->buf[start], ' ', pad);
+    f->len += pad;
+}
+
+/* Pad what was written since start to width columns */
+void Fmt_Left(Fmt_t *f, uint16_t start, uint8_t width)
+{
+    while (f->len - start < width && !f->truncated) Fmt_Char(f, ' ');
+}
+
+/* Terminates the text; returns its length */
+uint16_t Fmt_End(Fmt_t *f)
+{
+    if (f->size > 0) f->buf[f->len] = 0;
+    return f->len;
+}
@@ -20,7 +20,15 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "nrf24l01.h"
-#include <stdio.h>
+#include "sched.h"
+#include "containers.h"
+#include "prof.h"
+#include "telemetry.h"
+#include "fmt.h"
+#include "uart_tx.h"
+#include "energy.h"
+#include "timebase.h"
+#include "dsp.h"
 #include <string.h>
 
 /* --- DEFINES --- */
@@ -46,13 +54,53 @@ typedef struct __attribute__((packed)) {
     float temp;          // Single temperature reading for the batch  //4B
 } sentData_t; 		//26B
 
+/* --- EVENTS (number = priority, 0 runs first) --- */
+enum {
+    EV_SAMPLE = 0,   // 50 Hz: start the IMU burst read; never waits behind radio or UART
+    EV_SAMPLE_DONE,  // I2C completion: queue the sample for the detector
+    EV_DETECT,       // Step detection, DETECT_BLOCK queued samples at a time
+    EV_BATCH,        // Steps into 5-step packets, timeout flush
+    EV_RADIO,        // nRF24 transmit and retry
+    EV_ENERGY,       // Power-state and scheduler totals into telemetry frames
+    EV_PROFILE       // 'p' on USART2: probe table into the telemetry ring
+};
+
+_Static_assert(TEL_SCHED_EVENTS == SCHED_MAX_EVENTS, "TelSched_t out of step with sched.h");
+
+/* Raw IMU words, converted by the detector */
+typedef struct {
+    int16_t gy_raw;
+    int16_t gz_raw;
+    int16_t tp_raw;
+    uint32_t time_us;    // Read started, TIM2 timebase
+} ImuSample_t;
+
+typedef struct {
+    uint32_t count;      // Step number
+    uint32_t time_us;
+    uint32_t period_us;
+    uint16_t intensity;
+} StepEvent_t;
+
+typedef struct {
+    sentData_t data;
+    uint8_t partial;     // Sent by the timeout flush
+} TxBatch_t;
+
+typedef enum {
+    RADIO_IDLE,
+    RADIO_BUSY,          // Payload in the nRF24, polling STATUS
+    RADIO_RETRY          // Waiting RADIO_RETRY_MS after a failure
+} RadioState_t;
+
 // State Variables (Place these above main)
 uint8_t batch_index = 0;       // Track which step (0-4) we are filling
 uint32_t step_count = 0;       // Global step counter
-uint32_t last_step_time = 0;   // Time marker for previous step
+uint32_t last_step_time = 0;   // Time marker for previous step (us)
 uint8_t is_above_threshold = 0;// Lock flag
 
 #define GYRO_TH 175.0
+#define GYRO_RESET 75.0
 
 #define OPERATION_2G 16384.0
 #define OPERATION_4G 8192.0
@@ -63,12 +111,32 @@ uint8_t is_above_threshold = 0;// Lock flag
 #define OPERATION_500 65.5
 #define OPERATION_1000 32.75
 #define OPERATION_2000 16.375
+
+// Thresholds in raw swing counts, so the detector stays integer
+#define GYRO_TH_RAW ((uint16_t)(GYRO_TH * OPERATION_1000))
+#define GYRO_RESET_RAW ((uint16_t)(GYRO_RESET * OPERATION_1000))
+
 // Define these floats outside the loop:
 //for device 1
 #define ACCEL_X_OFFSET 0
 #define ACCEL_Y_OFFSET  0
 #define ACCEL_Z_OFFSET 0.135
 
+#define SAMPLE_PERIOD_MS 20    // 50 Hz
+#define DETECT_BLOCK 4         // Samples per detector run (80 ms); steps keep their sample times
+#define STEP_PAUSE_MS 2500     // No step for this long flushes a partial batch
+#define RADIO_POLL_MS 1
+#define RADIO_RETRY_MS 5000
+
+// Queue depths (powers of two)
+#define SAMPLE_QUEUE_LEN 8
+#define STEP_QUEUE_LEN 8
+#define TX_QUEUE_LEN 4
+#define TEL_RING_SIZE 512
+
+#define ENERGY_REPORT_MS 10000  // Also keeps energy.c inside one CYCCNT wrap (537 s at 8 MHz)
+#define TEL_CONFIG_EVERY 250   // Samples between config frames (5 s), for a decoder that joins late
+
 /* --- GLOBAL VARIABLES --- */
 SensorData_t data_imu; // This holds the actual sensor values
 sentData_t sentData;
@@ -77,42 +145,483 @@ uint8_t TxAddress[5] = {0xEE, 0xDD, 0xCC, 0xBB, 0xAA};
 // FIX 1: Correct Size (Do NOT subtract 1 for binary structs)
 const uint8_t MyDataSize = sizeof(SensorData_t);
 
+// Handler queues: each has one producer and one consumer, both in handlers
+RING_DEFINE(sample_queue, ImuSample_t, SAMPLE_QUEUE_LEN);
+RING_DEFINE(step_queue, StepEvent_t, STEP_QUEUE_LEN);
+RING_DEFINE(tx_queue, TxBatch_t, TX_QUEUE_LEN);
+
+// IMU burst read in flight under I2C1 interrupts
+static uint8_t imu_buffer[14];
+static uint32_t imu_time_us;
+static uint8_t imu_busy;
+static volatile uint8_t imu_error;
+
+static uint32_t batch_last_step;   // Time of the newest step in sentData (us)
+static RadioState_t radio_state = RADIO_IDLE;
+static uint32_t radio_start;
+
+static uint8_t tel_seq;            // Counts dropped frames too, so the decoder sees the gap
+static uint16_t tel_samples;
+
+// Console commands, one byte at a time from USART2
+static uint8_t console_rx;
+static uint8_t profile_line;       // Next probe the dump prints
+PROF_VAR(imu_start);
+PROF_VAR(radio_tx_start);
+
+// Losses, for the debugger
+static uint32_t i2c_errors;
+static uint32_t samples_dropped;
+static uint32_t steps_dropped;
+static uint32_t batches_dropped;
+
 /* --- HANDLES --- */
 I2C_HandleTypeDef hi2c1;
 SPI_HandleTypeDef hspi1;
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+// Setup text, then telemetry frames, out of USART2 by DMA; drops are counted in uart_tx.stats
+UART_TX_DEFINE(uart_tx, &huart2, TEL_RING_SIZE);
 
 /* --- PROTOTYPES --- */
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_SPI1_Init(void);
 static void MX_USART2_UART_Init(void);
 static void UART_SendString(char *pString);
+static void Telemetry_Send(uint8_t channel, const void *payload, uint16_t len);
+static void Telemetry_Text(const char *pString);
+static void Sample_Handler(void);
+static void Detect_Handler(void);
+static void Batch_Handler(void);
+static void Radio_Handler(void);
+static void Energy_Handler(void);
+static void Profile_Handler(void);
 
 /* --- HELPER FUNCTION --- */
+// Setup text; never waits for the UART
 static void UART_SendString(char *pString) {
-    HAL_UART_Transmit(&huart2, (uint8_t*)pString, strlen(pString), HAL_MAX_DELAY);
+    UartTx_Write(&uart_tx, pString, (uint16_t)strlen(pString));
 }
 
 int _write(int file, char *ptr, int len)
 {
-  HAL_UART_Transmit(&huart2, (uint8_t*)ptr, len, HAL_MAX_DELAY);
+  UartTx_Write(&uart_tx, ptr, (uint16_t)len);
   return len;
 }
 
-static void LowPowerDelay(uint32_t delay_ms)
+// Queues one whole frame for the DMA, or drops it
+static void Telemetry_Send(uint8_t channel, const void *payload, uint16_t len)
+{
+    uint8_t frame[TEL_MAX_FRAME];
+    uint16_t n;
+    {
+        PROF_SCOPE(PROF_TEL_FRAME);
+        n = Tel_Frame(channel, tel_seq++, payload, len, frame);
+    }
+    if (n == 0) return;
+    PROF_SCOPE(PROF_UART_WRITE);
+    UartTx_Write(&uart_tx, frame, n);
+}
+
+static void Telemetry_Text(const char *pString)
+{
+    Telemetry_Send(TEL_CH_TEXT, pString, (uint16_t)strlen(pString));
+}
+
+static void Telemetry_Config(void)
+{
+    TelConfig_t c;
+    c.sample_period_ms = SAMPLE_PERIOD_MS;
+    c.threshold = (int16_t)(GYRO_TH * OPERATION_1000);
+    c.lsb_per_dps_x100 = (uint16_t)(OPERATION_1000 * 100);
+    Telemetry_Send(TEL_CH_CONFIG, &c, sizeof(c));
+}
+
+// DMA1 channel 7 interrupts: free what USART2 has sent, start the next chunk
+void HAL_UART_TxHalfCpltCallback(UART_HandleTypeDef *huart)
 {
-    uint32_t start = HAL_GetTick();
-    // Enable Power Control clock
-    __HAL_RCC_PWR_CLK_ENABLE();
+    if (huart->Instance == USART2) {
+        UartTx_HalfDone(&uart_tx);
+    }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART2) {
+        UartTx_Done(&uart_tx);
+    }
+}
+
+// USART2 interrupt: 'p' dumps the profile probes, 'r' clears them
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance != USART2) return;
+    if (console_rx == 'p') {
+        profile_line = 0;
+        Sched_Post(EV_PROFILE);
+    } else if (console_rx == 'r') {
+        Prof_Reset();
+    }
+    HAL_UART_Receive_IT(&huart2, &console_rx, 1);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART2) {
+        UartTx_Error(&uart_tx);
+        HAL_UART_Receive_IT(&huart2, &console_rx, 1);
+    }
+}
+
+/* --- HANDLERS --- */
+// Highest priority: start one I2C burst read; the core sleeps or runs other
+// handlers for the ~1.6 ms it takes at 100 kHz
+static void Sample_Handler(void)
+{
+    if (imu_busy) {
+        // No completion for a whole period: the bus is stuck, restart I2C1
+        i2c_errors++;
+        Energy_Off(ENERGY_I2C);
+        HAL_I2C_DeInit(&hi2c1);
+        MX_I2C1_Init();
+        imu_busy = 0;
+        return;
+    }
+
+    imu_time_us = Time_NowUs();
+    imu_error = 0;
+    PROF_MARK(imu_start);
+    Energy_On(ENERGY_I2C);
+    // Read 14 bytes (Accel, Temp, Gyro)
+    if (HAL_I2C_Mem_Read_IT(&hi2c1, MPU6050_ADDR, 0x3B, 1, imu_buffer, 14) != HAL_OK) {
+        Energy_Off(ENERGY_I2C);
+        i2c_errors++;
+        Telemetry_Text("I2C Error.");
+        return;
+    }
+    imu_busy = 1;
+}
+
+// Burst read finished: queue the raw words for the detector
+static void SampleDone_Handler(void)
+{
+    imu_busy = 0;
+    PROF_SPAN(PROF_I2C_READ, imu_start);
+    if (imu_error) {
+        i2c_errors++;
+        Telemetry_Text("I2C Error.");
+        return;
+    }
+    ImuSample_t *s = Ring_Slot(&sample_queue);
+    if (s == NULL) {
+        samples_dropped++;
+        return;
+    }
+
+    s->tp_raw = (int16_t)(imu_buffer[6] << 8 | imu_buffer[7]);
+    s->gy_raw = (int16_t)(imu_buffer[10] << 8 | imu_buffer[11]);
+    s->gz_raw = (int16_t)(imu_buffer[12] << 8 | imu_buffer[13]);
+    s->time_us = imu_time_us;
+    Ring_Commit(&sample_queue);
+
+    if (Ring_Count(&sample_queue) >= DETECT_BLOCK) {
+        Sched_Post(EV_DETECT);
+    }
+}
+
+// I2C1 interrupt: the burst read is done or failed
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->Instance == I2C1) {
+        Energy_Off(ENERGY_I2C);
+        Sched_Post(EV_SAMPLE_DONE);
+    }
+}
 
-    while ((HAL_GetTick() - start) < delay_ms)
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    if (hi2c->Instance == I2C1) {
+        Energy_Off(ENERGY_I2C);
+        imu_error = 1;
+        Sched_Post(EV_SAMPLE_DONE);
+    }
+}
+
+static void Detect_Handler(void)
+{
+    ImuSample_t block[DETECT_BLOCK];
+    int16_t gy[DETECT_BLOCK], gz[DETECT_BLOCK];
+    uint16_t swing[DETECT_BLOCK];
+    uint32_t n = 0;
+    PROF_SCOPE(PROF_DETECT);
+
+    while (n < DETECT_BLOCK && Ring_Pop(&sample_queue, &block[n])) {
+        gy[n] = block[n].gy_raw;
+        gz[n] = block[n].gz_raw;
+        n++;
+    }
+    if (n == 0) return;
+
+    // Gyro swing |gy - gz| on raw counts (up to 65535), the whole block at once
+    DSP_AbsDiffQ15(gy, gz, swing, n);
+
+    // Convert to float; only the newest sample goes out with the batch
+    const ImuSample_t *last = &block[n - 1];
+    data_imu.temp = (last->tp_raw / 310.0f) + 18.53f;
+    data_imu.gy = last->gy_raw / OPERATION_1000;
+    data_imu.gz = last->gz_raw / OPERATION_1000;
+
+    for (uint32_t i = 0; i < n; i++) {
+        TelSample_t t;
+        uint32_t current_time = block[i].time_us;
+        uint32_t time_diff = current_time - last_step_time;
+        t.time_us = current_time;
+        t.gy = block[i].gy_raw;
+        t.gz = block[i].gz_raw;
+        t.diff = swing[i];
+
+        // --- STEP DETECTION LOGIC ---
+        if (swing[i] > GYRO_TH_RAW && !is_above_threshold)
+        {
+            is_above_threshold = 1; // Lock
+
+            // CASE 1: Valid Step (Between 250ms and 2500ms)
+            if ((time_diff >= 250 * 1000u && time_diff <= STEP_PAUSE_MS * 1000u) || step_count == 0)
+            {
+                step_count += 1;
+                last_step_time = current_time;
+
+                StepEvent_t *e = Ring_Slot(&step_queue);
+                if (e == NULL) {
+                    steps_dropped++;
+                } else {
+                    e->count = step_count;
+                    e->time_us = current_time;
+                    e->period_us = time_diff;
+                    e->intensity = (uint16_t)(swing[i] / OPERATION_1000);
+
+                    TelStep_t ts = { e->count, e->time_us, e->period_us, e->intensity };
+                    Ring_Commit(&step_queue);
+                    Sched_Post(EV_BATCH);
+                    Telemetry_Send(TEL_CH_STEP, &ts, sizeof(ts));
+                }
+            }
+            // CASE 2: New Start (Pause detected > 2500ms)
+            else if (time_diff > STEP_PAUSE_MS * 1000u)
+            {
+                 last_step_time = current_time;
+            }
+        }
+        // Reset Lock
+        else if (swing[i] < GYRO_RESET_RAW)
+        {
+            is_above_threshold = 0;
+        }
+
+        // --- PLOTTER --- (host side: code/host/tel_plot)
+        if (tel_samples++ % TEL_CONFIG_EVERY == 0) {
+            Telemetry_Config();
+        }
+        Telemetry_Send(TEL_CH_SAMPLE, &t, sizeof(t));
+    }
+
+    if (Ring_Count(&sample_queue) >= DETECT_BLOCK) {
+        Sched_Post(EV_DETECT);
+    }
+}
+
+// Hands the current batch to the radio queue and starts a new one
+static void Batch_Queue(uint8_t partial)
+{
+    sentData.temp = data_imu.temp;
+    batch_index = 0; // Reset
+
+    TxBatch_t *b = Ring_Slot(&tx_queue);
+    if (b == NULL) {
+        batches_dropped++;
+        Telemetry_Text(">> TX QUEUE FULL: batch dropped");
+        return;
+    }
+    b->data = sentData;
+    b->partial = partial;
+    Ring_Commit(&tx_queue);
+    Sched_Post(EV_RADIO);
+}
+
+// Runs on new steps and on its own flush timer
+static void Batch_Handler(void)
+{
+    StepEvent_t *e;
+    PROF_SCOPE(PROF_BATCH);
+
+    while ((e = Ring_Peek(&step_queue)) != NULL)
+    {
+
+        // -- Batching Logic --
+        if (batch_index == 0) {
+            sentData.step_initial_count = e->count;
+        }
+        // The radio packet keeps whole ms
+        sentData.steps[batch_index].period = (uint16_t)Time_UsToMs(e->period_us);
+        sentData.steps[batch_index].intensity = e->intensity;
+        batch_index++;
+        batch_last_step = e->time_us;
+        Ring_Drop(&step_queue, 1);
+
+        // Check if Batch is Full (5 steps)
+        if (batch_index >= 5) {
+            Batch_Queue(0);
+        }
+    }
+
+    // --- TIMEOUT FLUSH LOGIC ---
+    if (batch_index == 0) {
+        Sched_Cancel(EV_BATCH);
+        return;
+    }
+
+    uint32_t idle = Time_SinceUs(batch_last_step) / 1000;
+    if (idle > STEP_PAUSE_MS)
+    {
+        // Fill remaining slots with 0
+        for(int i = batch_index; i < 5; i++) {
+            sentData.steps[i].period = 0;
+            sentData.steps[i].intensity = 0;
+        }
+        Batch_Queue(1);
+        Sched_Cancel(EV_BATCH);
+    }
+    else
+    {
+        Sched_PostAfter(EV_BATCH, STEP_PAUSE_MS + 1 - idle);
+    }
+}
+
+// One SPI exchange per run; waits and retries are timer events
+static void Radio_Handler(void)
+{
+    NRF24_TX_Result_t res = NRF24_TX_PENDING;
+    TxBatch_t *b = Ring_Peek(&tx_queue);
+    TelRadio_t t;
+    PROF_SCOPE(PROF_RADIO);
+
+    switch (radio_state)
+    {
+    case RADIO_RETRY:
+        // New batches post us too; only the retry timer moves on
+        if (HAL_GetTick() - radio_start < RADIO_RETRY_MS) return;
+        radio_state = RADIO_IDLE;
+        /* fall through */
+
+    case RADIO_IDLE:
+        if (b == NULL) return;
+        PROF_MARK(radio_tx_start);
+        Energy_On(ENERGY_RADIO_TX);
+        NRF24_StartTransmit((uint8_t*)&b->data, sizeof(sentData_t));
+        radio_start = HAL_GetTick();
+        radio_state = RADIO_BUSY;
+        Sched_PostAfter(EV_RADIO, RADIO_POLL_MS);
+        return;
+
+    case RADIO_BUSY:
+        res = NRF24_PollTransmit(radio_start);
+        if (res == NRF24_TX_PENDING) {
+            Sched_PostAfter(EV_RADIO, RADIO_POLL_MS);
+            return;
+        }
+        break;
+    }
+
+    PROF_SPAN(PROF_RADIO_TX, radio_tx_start);
+    Energy_Off(ENERGY_RADIO_TX);
+    t.step_initial_count = b->data.step_initial_count;
+    t.ok = (res == NRF24_TX_OK);
+    t.partial = b->partial;
+    Telemetry_Send(TEL_CH_RADIO, &t, sizeof(t));
+
+    if (res != NRF24_TX_OK)
     {
-        // Enter Sleep Mode (CPU disabled, Peripherals+SysTick enabled)
-        // Wakes up every 1ms via SysTick interrupt to check loop condition
-        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+        radio_start = HAL_GetTick();
+        radio_state = RADIO_RETRY;
+        Sched_PostAfter(EV_RADIO, RADIO_RETRY_MS);
+        return;
+    }
+
+    HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5); // Blink LED
+    Energy_Set(ENERGY_LED, (GPIOA->ODR & GPIO_PIN_5) != 0);
+
+    Ring_Drop(&tx_queue, 1);
+    radio_state = RADIO_IDLE;
+    if (Ring_Count(&tx_queue) > 0) {
+        Sched_Post(EV_RADIO);
+    }
+}
+
+static uint16_t Sat16(uint32_t v)
+{
+    return v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+}
+
+// The scheduler's dispatch stats: how long sampling waited behind other handlers
+static void Sched_Report(void)
+{
+    const Sched_Stats_t *st = Sched_GetStats();
+    TelSched_t t;
+
+    t.sleeps = st->sleeps;
+    for (uint8_t i = 0; i < TEL_SCHED_EVENTS; i++) {
+        t.event[i].runs = st->event[i].runs;
+        t.event[i].overruns = st->event[i].overruns;
+        t.event[i].max_wait_ms = Sat16(st->event[i].max_wait_ms);
+        t.event[i].max_run_ms = Sat16(st->event[i].max_run_ms);
+    }
+    Telemetry_Send(TEL_CH_SCHED, &t, sizeof(t));
+}
+
+// Every ENERGY_REPORT_MS: totals since boot; tel_plot turns them into charge,
+// battery life and an energy_est trace line, then prints the scheduler stats
+static void Energy_Handler(void)
+{
+    EnergyReport_t r;
+    TelEnergy_t t;
+
+    Energy_Report(&r);
+    t.uptime_ms = r.uptime_ms;
+    t.base_ua = r.base_ua;
+    t.battery_uah = r.battery_uah;
+    memcpy(t.state_ms, r.state_ms, sizeof(t.state_ms));
+    memcpy(t.state_ua, r.state_ua, sizeof(t.state_ua));
+    Telemetry_Send(TEL_CH_ENERGY, &t, sizeof(t));
+    Sched_Report();
+}
+
+// Lowest priority: one probe line per run, only when the ring has room for it
+static void Profile_Handler(void)
+{
+#if PROF_ENABLE
+    char line[128];
+    int len;
+
+    if (profile_line == 0) {
+        len = Prof_FormatHeader(line, sizeof(line));
+    } else {
+        len = Prof_FormatLine((ProfProbe_t)(profile_line - 1), line, sizeof(line));
     }
+    if (UartTx_Space(&uart_tx) < TEL_MAX_FRAME) {
+        Sched_PostAfter(EV_PROFILE, 10);
+        return;
+    }
+    Telemetry_Send(TEL_CH_TEXT, line, (uint16_t)len);
+    if (++profile_line <= PROF_COUNT) {
+        Sched_Post(EV_PROFILE);
+    }
+#else
+    Telemetry_Text("Profiling disabled: build with DEBUG or PROF_ENABLE=1");
+#endif
 }
 
 
@@ -124,7 +633,9 @@ int main(void)
 
   HAL_Init();
   SystemClock_Config();
+  Time_Init();
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_SPI1_Init();
 
   NRF24_Init(&hspi1, GPIOA, GPIO_PIN_9, GPIOC, GPIO_PIN_7);
@@ -138,21 +649,25 @@ int main(void)
   MX_USART2_UART_Init();
 
   MX_I2C1_Init();
+  Prof_Init();
+  Energy_Init();
 
   /* --- NRF24L01 Initialization --- */
   UART_SendString("NRF24L01 Transmitter Initialized.\r\n");
 
   /* --- MPU6050 Initialization --- */
-  char log_buffer[100]; // Buffer for printing
   uint8_t check;
   uint8_t i2c_reg_val;  // Renamed from 'data' to avoid confusion
+  char line[80];
+  Fmt_t f;
 
-  printf("--- Program Started ---\r\n");
+  UART_SendString("--- Program Started ---\r\n");
   	  HAL_Delay(100); // Give it time to send
 
   	  // 1. Check if I2C device is found
   	  if (HAL_I2C_IsDeviceReady(&hi2c1, MPU6050_ADDR, 2, 100) != HAL_OK) {
   		UART_SendString("!!! I2C Device Not Ready. Check wiring. Stuck in Error_Handler().\r\n");
+  		UartTx_Flush(&uart_tx, 100);
   		Error_Handler();
   	  }
 
@@ -164,7 +679,12 @@ int main(void)
 
   	  if (check == 0x70) // 0x68 is the default MPU-6050 Who Am I value
   	  {
-  		printf("MPU6050 WHO_AM_I check SUCCESS (0x%X). Waking up sensor...\r\n", check);
+  		Fmt_Init(&f, line, sizeof(line));
+  		Fmt_Str(&f, "MPU6050 WHO_AM_I check SUCCESS (0x");
+  		Fmt_Hex(&f, check, 2);
+  		Fmt_Str(&f, "). Waking up sensor...\r\n");
+  		Fmt_End(&f);
+  		UART_SendString(line);
 
   		  // Configure accelerometer ±2g
   		i2c_reg_val = 0x08;
@@ -180,139 +700,38 @@ int main(void)
 
 
   	  } else {
-  		printf("!!! MPU6050 WHO_AM_I check FAILED. Value was: 0x%X. Check AD0 pin.\r\n", check);
+  		Fmt_Init(&f, line, sizeof(line));
+  		Fmt_Str(&f, "!!! MPU6050 WHO_AM_I check FAILED. Value was: 0x");
+  		Fmt_Hex(&f, check, 2);
+  		Fmt_Str(&f, ". Check AD0 pin.\r\n");
+  		Fmt_End(&f);
+  		UART_SendString(line);
+  		UartTx_Flush(&uart_tx, 100);
 
   		  Error_Handler();
   	  }
 
-  	  UART_SendString("Setup Complete. Entering main loop...\r\n\r\n");
+  	  UART_SendString("Setup Complete. Starting scheduler...\r\n\r\n");
+  	  // From here on USART2 carries telemetry frames; a leading delimiter
+  	  // separates them from the setup text above
+  	  UartTx_Write(&uart_tx, "", 1);
   	  HAL_Delay(100);
 
-  	while (1)
-  	  {
-  	      uint8_t buffer[14];
-  	      // Read 14 bytes (Accel, Temp, Gyro)
-  	      HAL_StatusTypeDef status = HAL_I2C_Mem_Read(&hi2c1, MPU6050_ADDR, 0x3B, 1, buffer, 14, 100);
-
-  	      if (status == HAL_OK)
-  	      {
-  	          // 1. Parse raw data
-  	          //int16_t ax_raw = (int16_t)(buffer[0] << 8 | buffer[1]);
-  	          //int16_t ay_raw = (int16_t)(buffer[2] << 8 | buffer[3]);
-  	          //int16_t az_raw = (int16_t)(buffer[4] << 8 | buffer[5]);
-  	          int16_t tp_raw = (int16_t)(buffer[6] << 8 | buffer[7]);
-  	          //int16_t gx_raw = (int16_t)(buffer[8] << 8 | buffer[9]);
-  	          int16_t gy_raw = (int16_t)(buffer[10] << 8 | buffer[11]);
-  	          int16_t gz_raw = (int16_t)(buffer[12] << 8 | buffer[13]);
-
-  	          // 2. Convert to float
-  	          //data_imu.ax = ax_raw / OPERATION_4G + ACCEL_X_OFFSET;
-  	          //data_imu.ay = ay_raw / OPERATION_4G + ACCEL_Y_OFFSET;
-  	          //data_imu.az = az_raw / OPERATION_4G + ACCEL_Z_OFFSET;
-  	          data_imu.temp = (tp_raw / 310.0f) + 18.53f;
-  	          //data_imu.gx = gx_raw / OPERATION_1000;
-  	          data_imu.gy = gy_raw / OPERATION_1000;
-  	          data_imu.gz = gz_raw / OPERATION_1000;
-
-  	          // 3. Calculate Gyro Swing
-  	          float gyro_diff = fabsf(data_imu.gy - data_imu.gz);
-
-  	          uint32_t current_time = HAL_GetTick();
-  	          uint32_t time_diff = current_time - last_step_time;
-
-  	          // --- STEP DETECTION LOGIC ---
-  	          if (gyro_diff > GYRO_TH && !is_above_threshold)
-  	          {
-  	              is_above_threshold = 1; // Lock
-
-  	              // CASE 1: Valid Step (Between 300ms and 2000ms)
-  	              if ((time_diff >= 250 && time_diff <= 2500) || step_count == 0)
-  	              {
-  	                  step_count += 1;
-
-  	                  // -- Batching Logic --
-  	                  if (batch_index == 0) {
-  	                      sentData.step_initial_count = step_count;
-  	                  }
-
-  	                  sentData.steps[batch_index].period = (uint16_t)time_diff;
-  	                  sentData.steps[batch_index].intensity = (uint16_t)gyro_diff;
-
-  	                  batch_index++;
-  	                  last_step_time = current_time;
-
-  	                  // Check if Batch is Full (5 steps)
-  	                  if (batch_index >= 5)
-  	                  {
-  	                      sentData.temp = data_imu.temp;
-
-  	                      // Transmit Full Batch
-  	                      NRF24_TX_Result_t res = NRF24_Transmit((uint8_t*)&sentData, sizeof(sentData));
-
-  	                      while(res != NRF24_TX_OK)
-  	                      {
-  	                          UART_SendString(">> FULL BATCH SENT: FAILED. Retrying in 5s...\r\n");
-  	                          LowPowerDelay(5000);
-  	                          res = NRF24_Transmit((uint8_t*)&sentData, sizeof(sentData));
-  	                      }
-
-  	                      UART_SendString(">> FULL BATCH SENT: OK\r\n");
-  	                      HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5); // Blink LED
-
-  	                      batch_index = 0; // Reset
-  	                  }
-  	              }
-  	              // CASE 2: New Start (Pause detected > 2000ms)
-  	              else if (time_diff > 2500)
-  	              {
-  	                   last_step_time = current_time;
-  	              }
-  	          }
-  	          // Reset Lock
-  	          else if (gyro_diff < 75.0f)
-  	          {
-  	              is_above_threshold = 0;
-  	          }
-
-  	          // --- TIMEOUT FLUSH LOGIC ---
-  	          // If data pending AND no steps for > 2 seconds
-  	          if (batch_index > 0 && (current_time - last_step_time > 2500))
-  	          {
-  	              // Fill remaining slots with 0
-  	              for(int i = batch_index; i < 5; i++) {
-  	                  sentData.steps[i].period = 0;
-  	                  sentData.steps[i].intensity = 0;
-  	              }
-
-  	              sentData.temp = data_imu.temp;
-
-  	              // Transmit Partial Batch
-  	              NRF24_TX_Result_t res = NRF24_Transmit((uint8_t*)&sentData, sizeof(sentData));
-
-  	              while(res != NRF24_TX_OK)
-  	              {
-  	                  UART_SendString(">> TIMEOUT FLUSH: FAILED. Retrying in 5s...\r\n");
-  	                  LowPowerDelay(5000);
-  	                  res = NRF24_Transmit((uint8_t*)&sentData, sizeof(sentData));
-  	              }
-
-  	              UART_SendString(">> TIMEOUT FLUSH: OK\r\n");
-  	              HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5);
-
-  	              batch_index = 0; // Buffer cleared
-  	          }
-
-  	          // --- PLOTTER ---
-  	          sprintf(log_buffer, "Diff:%.2f,Thresh%.2f:.0\r\n", gyro_diff, GYRO_TH);
-  	          UART_SendString(log_buffer);
-  	      }
-  	      else
-  	      {
-  	          UART_SendString("I2C Error.\r\n");
-  	      }
-
-  	      LowPowerDelay(20); // 50Hz Loop in Sleep Mode
-  	  }
+  	  /* --- SCHEDULER --- */
+  	  // Each concern is a handler; sampling outranks everything else
+  	  Sched_Init();
+  	  Sched_Register(EV_SAMPLE, Sample_Handler);
+  	  Sched_Register(EV_SAMPLE_DONE, SampleDone_Handler);
+  	  Sched_Register(EV_DETECT, Detect_Handler);
+  	  Sched_Register(EV_BATCH, Batch_Handler);
+  	  Sched_Register(EV_RADIO, Radio_Handler);
+  	  Sched_Register(EV_ENERGY, Energy_Handler);
+  	  Sched_Register(EV_PROFILE, Profile_Handler);
+  	  Sched_Every(EV_SAMPLE, SAMPLE_PERIOD_MS);
+  	  Sched_Every(EV_ENERGY, ENERGY_REPORT_MS);
+  	  HAL_UART_Receive_IT(&huart2, &console_rx, 1); // 'p' profile dump, 'r' reset
+
+  	  Sched_Run(); // Sleeps in WFI between events; never returns
 }
 
 
@@ -573,6 +992,22 @@ static void MX_USART2_UART_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Channel7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Channel7_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
@@ -1,4 +1,5 @@
 #include "nrf24l01.h"
+#include "timebase.h"
 
 // --- Hardware Variables (Private) ---
 // Bu degiskenler Init fonksiyonu ile doldurulacak
@@ -172,8 +173,8 @@ void NRF24_SetTXMode(void) {
     WriteReg(NRF24_REG_CONFIG, config);
 }
 
-NRF24_TX_Result_t NRF24_Transmit(uint8_t* pData, uint8_t size) {
-    uint8_t status;
+/* Loads the payload and pulses CE; the result comes from NRF24_PollTransmit */
+void NRF24_StartTransmit(uint8_t* pData, uint8_t size) {
     CE_Reset();
     CSN_Reset();
     SPI_Byte(NRF24_CMD_W_TX_PAYLOAD);
@@ -181,26 +182,38 @@ NRF24_TX_Result_t NRF24_Transmit(uint8_t* pData, uint8_t size) {
     CSN_Set();
 
     CE_Set();
-    for(volatile int i=0; i<100; i++);
+    Time_DelayUs(15);   // The CE pulse must last at least 10 us (Thce)
     CE_Reset();
+}
 
-    uint32_t start = HAL_GetTick();
-    while (1) {
-        status = NRF24_GetStatus();
-        if (status & NRF24_STATUS_TX_DS) {
-            NRF24_ClearInterrupts();
-            return NRF24_TX_OK;
-        }
-        if (status & NRF24_STATUS_MAX_RT) {
-            NRF24_ClearInterrupts();
-            NRF24_FlushTX();
-            return NRF24_TX_MAX_RT;
-        }
-        if (HAL_GetTick() - start > 100) {
-            NRF24_FlushTX();
-            return NRF24_TX_ERROR;
-        }
+/* One STATUS read; NRF24_TX_PENDING until the ACK, MAX_RT or 100 ms from start */
+NRF24_TX_Result_t NRF24_PollTransmit(uint32_t start) {
+    uint8_t status = NRF24_GetStatus();
+    if (status & NRF24_STATUS_TX_DS) {
+        NRF24_ClearInterrupts();
+        return NRF24_TX_OK;
+    }
+    if (status & NRF24_STATUS_MAX_RT) {
+        NRF24_ClearInterrupts();
+        NRF24_FlushTX();
+        return NRF24_TX_MAX_RT;
     }
+    if (HAL_GetTick() - start > 100) {
+        NRF24_FlushTX();
+        return NRF24_TX_ERROR;
+    }
+    return NRF24_TX_PENDING;
+}
+
+NRF24_TX_Result_t NRF24_Transmit(uint8_t* pData, uint8_t size) {
+    NRF24_TX_Result_t res;
+    NRF24_StartTransmit(pData, size);
+
+    uint32_t start = HAL_GetTick();
+    do {
+        res = NRF24_PollTransmit(start);
+    } while (res == NRF24_TX_PENDING);
+    return res;
 }
 
 /* --- ALICI (RX) --- */
@@ -28,7 +28,8 @@ typedef enum {
 typedef enum {
     NRF24_TX_OK,
     NRF24_TX_MAX_RT,
-    NRF24_TX_ERROR
+    NRF24_TX_ERROR,
+    NRF24_TX_PENDING
 } NRF24_TX_Result_t;
 
 /* --- FONKSIYONLAR --- */
@@ -52,6 +53,8 @@ void NRF24_SetRXAddress_P0(uint8_t* pAddress);
 // TX (Verici)
 void NRF24_SetTXMode(void);
 NRF24_TX_Result_t NRF24_Transmit(uint8_t* pData, uint8_t size);
+void NRF24_StartTransmit(uint8_t* pData, uint8_t size);
+NRF24_TX_Result_t NRF24_PollTransmit(uint32_t start);
 
 // RX (Alici)
 void NRF24_SetRXMode(void);
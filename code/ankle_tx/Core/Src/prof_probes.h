@@ -0,0 +1,21 @@
+/* ========================================
+   File: prof_probes.h
+   Ankle Node Profiling Probes
+
+   X(id, name) for each stage timed by prof.h,
+   printed in this order by the 'p' command.
+   ======================================== */
+
+#ifndef PROF_PROBES_H
+#define PROF_PROBES_H
+
+#define PROF_PROBES(X) \
+    X(PROF_I2C_READ,   "i2c read")   /* IMU burst, start to completion callback */ \
+    X(PROF_DETECT,     "detect")     /* Step detection on one DETECT_BLOCK of samples */ \
+    X(PROF_TEL_FRAME,  "tel frame")  /* Telemetry frame CRC and COBS encoding */ \
+    X(PROF_BATCH,      "batch")      /* Step batch into a radio packet */ \
+    X(PROF_RADIO_TX,   "radio tx")   /* StartTransmit to TX_DS/MAX_RT */ \
+    X(PROF_RADIO,      "radio")      /* One radio handler run (SPI exchange) */ \
+    X(PROF_UART_WRITE, "uart write") /* Frame into the DMA ring, and the DMA start when idle */
+
+#endif /* PROF_PROBES_H */
@@ -0,0 +1,155 @@
+/* ========================================
+   File: sched.c
+   Run-to-Completion Event Scheduler
+   ======================================== */
+
+#include "sched.h"
+#include "main.h"
+#include <string.h>
+
+static Sched_Handler_t handlers[SCHED_MAX_EVENTS];
+static volatile uint32_t pending;
+static volatile uint32_t armed;
+static uint32_t posted_at[SCHED_MAX_EVENTS];
+static uint32_t due[SCHED_MAX_EVENTS];
+static uint32_t period[SCHED_MAX_EVENTS];
+static Sched_Stats_t stats;
+
+void Sched_Init(void)
+{
+    __disable_irq();
+    pending = 0;
+    armed = 0;
+    memset(handlers, 0, sizeof(handlers));
+    memset(&stats, 0, sizeof(stats));
+    __enable_irq();
+}
+
+void Sched_Register(uint8_t event, Sched_Handler_t handler)
+{
+    if (event < SCHED_MAX_EVENTS) handlers[event] = handler;
+}
+
+/* Callers hold the interrupt mask */
+static void Post_Locked(uint8_t event)
+{
+    uint32_t bit = 1u << event;
+
+    if (pending & bit) {
+        stats.event[event].overruns++;
+        return;
+    }
+    pending |= bit;
+    posted_at[event] = HAL_GetTick();
+}
+
+/* Safe from handlers and interrupts */
+void Sched_Post(uint8_t event)
+{
+    if (event >= SCHED_MAX_EVENTS) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    Post_Locked(event);
+    __set_PRIMASK(primask);
+}
+
+static void Arm(uint8_t event, uint32_t delay_ms, uint32_t period_ms)
+{
+    if (event >= SCHED_MAX_EVENTS) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    due[event] = HAL_GetTick() + delay_ms;
+    period[event] = period_ms;
+    armed |= 1u << event;
+    __set_PRIMASK(primask);
+}
+
+/* One-shot; re-arming replaces the previous deadline */
+void Sched_PostAfter(uint8_t event, uint32_t delay_ms)
+{
+    Arm(event, delay_ms, 0);
+}
+
+/* Periodic, first post one period from now; deadlines do not drift */
+void Sched_Every(uint8_t event, uint32_t period_ms)
+{
+    Arm(event, period_ms, period_ms);
+}
+
+/* Stops the timer; an event already pending still runs */
+void Sched_Cancel(uint8_t event)
+{
+    if (event >= SCHED_MAX_EVENTS) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    armed &= ~(1u << event);
+    __set_PRIMASK(primask);
+}
+
+/* Called from SysTick_Handler after HAL_IncTick; masked against
+   higher-priority interrupts that post */
+void Sched_TickISR(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t now = HAL_GetTick();
+    uint32_t timers = armed;
+
+    while (timers) {
+        uint8_t event = (uint8_t)__CLZ(__RBIT(timers));
+        timers &= timers - 1;
+
+        if ((int32_t)(now - due[event]) < 0) continue;
+
+        if (period[event]) {
+            due[event] += period[event];
+            /* After a long stall, skip the missed periods instead of bursting */
+            if ((int32_t)(now - due[event]) >= 0) due[event] = now + period[event];
+        } else {
+            armed &= ~(1u << event);
+        }
+        Post_Locked(event);
+    }
+    __set_PRIMASK(primask);
+}
+
+/* Never returns. The pending check and WFI run with interrupts masked, so a
+   post that lands between them still wakes the core. */
+void Sched_Run(void)
+{
+    while (1) {
+        __disable_irq();
+        uint32_t ready = pending;
+        if (ready == 0) {
+            stats.sleeps++;
+            __WFI();
+            __enable_irq();
+            continue;
+        }
+
+        /* Lowest set bit is the highest priority */
+        uint8_t event = (uint8_t)__CLZ(__RBIT(ready));
+        pending &= ~(1u << event);
+        uint32_t start = HAL_GetTick();
+        uint32_t wait = start - posted_at[event];
+        __enable_irq();
+
+        Sched_EventStats_t *es = &stats.event[event];
+        if (wait > es->max_wait_ms) es->max_wait_ms = wait;
+
+        if (handlers[event]) handlers[event]();
+
+        uint32_t run = HAL_GetTick() - start;
+        if (run > es->max_run_ms) es->max_run_ms = run;
+        es->runs++;
+    }
+}
+
+const Sched_Stats_t *Sched_GetStats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,51 @@
+/* ========================================
+   File: sched.h
+   Run-to-Completion Event Scheduler
+
+   Events are bits in one pending word and the
+   event number is its priority: 0 runs first.
+   Sched_Run dispatches the highest pending event,
+   its handler runs to completion, and the core
+   sleeps in WFI while nothing is pending. Events
+   are posted by handlers, by interrupts, or by
+   one software timer per event driven from
+   SysTick. A handler can only be delayed by the
+   one already running, so every handler must
+   return quickly and split long work into steps.
+   Dispatch stats go out with the energy frame;
+   tel_plot prints them.
+   ======================================== */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+#define SCHED_MAX_EVENTS        8
+
+typedef void (*Sched_Handler_t)(void);
+
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns;          /* Posted again before it ran */
+    uint32_t max_wait_ms;       /* Post to dispatch */
+    uint32_t max_run_ms;
+} Sched_EventStats_t;
+
+typedef struct {
+    uint32_t sleeps;            /* WFI entries with nothing pending */
+    Sched_EventStats_t event[SCHED_MAX_EVENTS];
+} Sched_Stats_t;
+
+/* Function prototypes */
+void Sched_Init(void);
+void Sched_Register(uint8_t event, Sched_Handler_t handler);
+void Sched_Post(uint8_t event);
+void Sched_PostAfter(uint8_t event, uint32_t delay_ms);
+void Sched_Every(uint8_t event, uint32_t period_ms);
+void Sched_Cancel(uint8_t event);
+void Sched_TickISR(void);
+void Sched_Run(void);
+const Sched_Stats_t *Sched_GetStats(void);
+
+#endif /* SCHED_H */
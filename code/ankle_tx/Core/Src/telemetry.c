@@ -0,0 +1,93 @@
+/* ========================================
+   File: telemetry.c
+   Binary Telemetry Frames from the Ankle Node
+   ======================================== */
+
+#include "telemetry.h"
+#include <string.h>
+
+/* CRC-16/CCITT-FALSE; bitwise is a few hundred cycles on a sample frame */
+uint16_t Tel_Crc16(const uint8_t *data, uint16_t len, uint16_t crc)
+{
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* Consistent Overhead Byte Stuffing: out holds no zeros and is at most
+   len + len / 254 + 1 bytes; returns its length */
+uint16_t Tel_CobsEncode(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t code_at = 0;
+    uint16_t n = 1;
+    uint8_t code = 1;
+
+    for (uint16_t i = 0; i < len; i++) {
+        if (in[i] != 0) {
+            out[n++] = in[i];
+            code++;
+        }
+        if (in[i] == 0 || code == 0xFF) {
+            out[code_at] = code;
+            code_at = n++;
+            code = 1;
+        }
+    }
+    out[code_at] = code;
+    return n;
+}
+
+/* Inverse of Tel_CobsEncode, delimiter excluded; 0 on a malformed block */
+uint16_t Tel_CobsDecode(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t i = 0;
+    uint16_t n = 0;
+
+    while (i < len) {
+        uint8_t code = in[i++];
+        if (code == 0 || i + code - 1 > len) return 0;
+        for (uint8_t k = 1; k < code; k++) {
+            if (in[i] == 0) return 0;
+            out[n++] = in[i++];
+        }
+        if (code != 0xFF && i < len) out[n++] = 0;
+    }
+    return n;
+}
+
+/* Whole encoded frame, delimiter included, into out (TEL_MAX_FRAME bytes);
+   returns its length, 0 if the payload is too long */
+uint16_t Tel_Frame(uint8_t channel, uint8_t seq, const void *payload, uint16_t len, uint8_t *out)
+{
+    uint8_t raw[TEL_HEADER + TEL_MAX_PAYLOAD + TEL_CRC];
+
+    if (len > TEL_MAX_PAYLOAD) return 0;
+    raw[0] = channel;
+    raw[1] = seq;
+    memcpy(&raw[TEL_HEADER], payload, len);
+    uint16_t crc = Tel_Crc16(raw, TEL_HEADER + len, 0xFFFF);
+    raw[TEL_HEADER + len] = (uint8_t)crc;
+    raw[TEL_HEADER + len + 1] = (uint8_t)(crc >> 8);
+
+    uint16_t n = Tel_CobsEncode(raw, TEL_HEADER + len + TEL_CRC, out);
+    out[n++] = 0;
+    return n;
+}
+
+/* One received block between delimiters into frame (at least len bytes):
+   channel at frame[0], seq at frame[1], payload from frame[2].
+   Returns the payload length, or -1 for a bad block or CRC */
+int32_t Tel_Unframe(const uint8_t *in, uint16_t len, uint8_t *frame)
+{
+    uint16_t n = Tel_CobsDecode(in, len, frame);
+
+    if (n < TEL_HEADER + TEL_CRC || n > TEL_HEADER + TEL_MAX_PAYLOAD + TEL_CRC) return -1;
+    n -= TEL_CRC;
+    uint16_t crc = Tel_Crc16(frame, n, 0xFFFF);
+    if (frame[n] != (uint8_t)crc || frame[n + 1] != (uint8_t)(crc >> 8)) return -1;
+    return n - TEL_HEADER;
+}
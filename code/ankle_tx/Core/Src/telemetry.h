@@ -0,0 +1,96 @@
+/* ========================================
+   File: telemetry.h
+   Binary Telemetry Frames from the Ankle Node
+
+   Every USART2 message after setup is one frame:
+     channel (1) | seq (1) | payload (0..TEL_MAX_PAYLOAD) | CRC-16 (2, LE)
+   COBS-encoded and terminated by a 0x00 byte, so a
+   reader that joins mid-stream syncs on the next
+   zero. seq counts every frame sent, so gaps show
+   frames dropped on a full ring. The CRC is
+   CRC-16/CCITT-FALSE over channel, seq and payload.
+   Payloads are packed little-endian structs.
+   No HAL here: the host decoder (code/host) builds
+   this file too.
+   ======================================== */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include "energy.h"
+
+#define TEL_MAX_PAYLOAD         128
+#define TEL_HEADER              2
+#define TEL_CRC                 2
+/* Encoded frame: one COBS code byte per 254 data bytes, plus the delimiter */
+#define TEL_MAX_FRAME           (TEL_HEADER + TEL_MAX_PAYLOAD + TEL_CRC + 2)
+
+typedef enum {
+    TEL_CH_TEXT = 1,            /* Status line, ASCII, no terminator */
+    TEL_CH_CONFIG = 2,          /* TelConfig_t: scales for the sample channel */
+    TEL_CH_SAMPLE = 3,          /* TelSample_t: one IMU sample */
+    TEL_CH_STEP = 4,            /* TelStep_t: one detected step */
+    TEL_CH_RADIO = 5,           /* TelRadio_t: one batch transmit result */
+    TEL_CH_ENERGY = 6,          /* TelEnergy_t: power-state totals since boot */
+    TEL_CH_SCHED = 7            /* TelSched_t: scheduler dispatch stats since boot */
+} TelChannel_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t sample_period_ms;
+    int16_t threshold;          /* Step threshold on diff, raw gyro counts */
+    uint16_t lsb_per_dps_x100;  /* Gyro counts per deg/s, x100 */
+} TelConfig_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_us;           /* Read started, on the node's 1 MHz timebase */
+    int16_t gy;                 /* Raw gyro counts */
+    int16_t gz;
+    uint16_t diff;              /* |gy - gz| */
+} TelSample_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t count;
+    uint32_t time_us;           /* Time of the sample that crossed the threshold */
+    uint32_t period_us;         /* Since the previous step */
+    uint16_t intensity;         /* deg/s */
+} TelStep_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t step_initial_count;
+    uint8_t ok;
+    uint8_t partial;            /* Sent by the timeout flush */
+} TelRadio_t;
+
+/* States in energy.h order; the host derives charge and battery life */
+typedef struct __attribute__((packed)) {
+    uint32_t uptime_ms;
+    uint32_t base_ua;
+    uint32_t battery_uah;
+    uint32_t state_ms[ENERGY_COUNT];
+    uint32_t state_ua[ENERGY_COUNT];
+} TelEnergy_t;
+
+/* Events in the ankle's priority order (EV_ in main.c), up to SCHED_MAX_EVENTS */
+#define TEL_SCHED_EVENTS        8
+
+typedef struct __attribute__((packed)) {
+    uint32_t runs;
+    uint32_t overruns;          /* Posted again before it ran */
+    uint16_t max_wait_ms;       /* Post to dispatch, saturated */
+    uint16_t max_run_ms;
+} TelSchedEvent_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t sleeps;            /* WFI entries with nothing pending */
+    TelSchedEvent_t event[TEL_SCHED_EVENTS];
+} TelSched_t;
+
+/* Function prototypes */
+uint16_t Tel_Crc16(const uint8_t *data, uint16_t len, uint16_t crc);
+uint16_t Tel_CobsEncode(const uint8_t *in, uint16_t len, uint8_t *out);
+uint16_t Tel_CobsDecode(const uint8_t *in, uint16_t len, uint8_t *out);
+uint16_t Tel_Frame(uint8_t channel, uint8_t seq, const void *payload, uint16_t len, uint8_t *out);
+int32_t Tel_Unframe(const uint8_t *in, uint16_t len, uint8_t *frame);
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,56 @@
+/* ========================================
+   File: timebase.h
+   Microsecond Timebase Shared by Ankle and Wrist Nodes
+
+   TIM2 (32-bit on both parts) free-runs at 1 MHz
+   from reset to reset: no interrupt, no reload, so
+   reading the time is one register load and costs
+   nothing between reads. It keeps counting in
+   sleep and stops in STOP. The count wraps every
+   71.6 minutes; compare times only through the
+   helpers below, which take the difference first
+   and are exact for spans up to 35.8 minutes. The
+   HAL tick stays the millisecond clock for delays
+   and timeouts. TIM2 is set up by register here,
+   not by CubeMX, so leave it unassigned in the .ioc.
+   Keep both node copies of this file identical.
+   ======================================== */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "main.h"
+
+/* Function prototypes */
+void Time_Init(void);
+void Time_DelayUs(uint32_t us);
+
+static inline uint32_t Time_NowUs(void)
+{
+    return TIM2->CNT;
+}
+
+/* later - earlier; negative if later is actually the earlier one */
+static inline int32_t Time_DiffUs(uint32_t later, uint32_t earlier)
+{
+    return (int32_t)(later - earlier);
+}
+
+static inline uint32_t Time_SinceUs(uint32_t since)
+{
+    return Time_NowUs() - since;
+}
+
+/* 1 once now is at or past deadline */
+static inline uint8_t Time_Reached(uint32_t now, uint32_t deadline)
+{
+    return Time_DiffUs(now, deadline) >= 0;
+}
+
+/* us rounded to the nearest ms, for the millisecond fields of packets and logs */
+static inline uint32_t Time_UsToMs(uint32_t us)
+{
+    return (us + 500u) / 1000u;
+}
+
+#endif /* TIMEBASE_H */
@@ -0,0 +1,85 @@
+/* ========================================
+   File: uart_tx.c
+   DMA UART Transmit Shared by Ankle and Wrist Nodes
+   ======================================== */
+
+#include "uart_tx.h"
+
+/* Largest single DMA transfer the HAL takes */
+#define UART_TX_MAX_CHUNK       0xFFFFu
+
+/* Copies the message in and starts the DMA if it is idle; 0 if it was dropped */
+uint8_t UartTx_Write(UartTx_t *tx, const void *data, uint16_t len)
+{
+    if (!Ring_Write(tx->ring, data, len)) {
+        tx->stats.writes_dropped++;
+        tx->stats.bytes_dropped += len;
+        return 0;
+    }
+
+    uint32_t queued = Ring_Count(tx->ring);
+    if (queued > tx->stats.peak) tx->stats.peak = queued;
+    UartTx_Kick(tx);
+    return 1;
+}
+
+/* Next contiguous run to the DMA; from writers and from the callbacks,
+   so it runs with interrupts masked */
+void UartTx_Kick(UartTx_t *tx)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (tx->inflight == 0 && tx->huart->gState == HAL_UART_STATE_READY) {
+        const uint8_t *chunk;
+        uint32_t len = Ring_Span(tx->ring, &chunk);
+        if (len > UART_TX_MAX_CHUNK) len = UART_TX_MAX_CHUNK;
+        if (len > 0 && HAL_UART_Transmit_DMA(tx->huart, (uint8_t *)chunk, (uint16_t)len) == HAL_OK) {
+            tx->inflight = (uint16_t)len;
+            tx->released = 0;
+        }
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/* HAL_UART_TxHalfCpltCallback: the DMA has read the first half */
+void UartTx_HalfDone(UartTx_t *tx)
+{
+    uint16_t half = tx->inflight / 2;
+
+    Ring_Drop(tx->ring, half - tx->released);
+    tx->released = half;
+}
+
+/* HAL_UART_TxCpltCallback */
+void UartTx_Done(UartTx_t *tx)
+{
+    if (tx->inflight == 0) return;
+    Ring_Drop(tx->ring, tx->inflight - tx->released);
+    tx->stats.bytes_sent += tx->inflight;
+    tx->inflight = 0;
+    UartTx_Kick(tx);
+}
+
+/* HAL_UART_ErrorCallback: receive errors leave the transfer running */
+void UartTx_Error(UartTx_t *tx)
+{
+    if (tx->inflight == 0 || tx->huart->gState != HAL_UART_STATE_READY) return;
+    Ring_Drop(tx->ring, tx->inflight - tx->released);
+    tx->stats.errors++;
+    tx->inflight = 0;
+    UartTx_Kick(tx);
+}
+
+/* Waits for the ring to drain, e.g. before halting; 0 on timeout */
+uint8_t UartTx_Flush(UartTx_t *tx, uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (Ring_Count(tx->ring) > 0) {
+        if (HAL_GetTick() - start >= timeout_ms) return 0;
+        UartTx_Kick(tx);
+    }
+    return 1;
+}
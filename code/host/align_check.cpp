@@ -0,0 +1,162 @@
+/* ========================================
+   File: align_check.cpp
+   Step / Heart-Rate Alignment Checks
+
+   Feeds step_align.c scripted ankle batches and
+   HR estimates on Linux: step times walked back
+   from full and partial batches, batches received
+   in the first seconds after the wrist boots,
+   retransmits and numbering gaps, the 16-bit step
+   counter wrap and HR interpolation between
+   estimates. Needs no FatFs. Exits non-zero if
+   any check fails.
+
+   Usage: align_check
+   ======================================== */
+
+extern "C" {
+#include "step_align.h"
+}
+
+#include "bench_check.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using bench::Check;
+
+sentData_t Batch(uint16_t first, std::vector<uint16_t> periods)
+{
+    sentData_t b = {};
+    b.step_initial_count = first;
+    for (size_t i = 0; i < periods.size() && i < 5; i++) {
+        b.steps[i].period = periods[i];
+        b.steps[i].intensity = 200;
+    }
+    b.temp = 31.5f;
+    return b;
+}
+
+// Everything the aligner lets go by now
+std::vector<AlignedStep_t> Drain(uint32_t now)
+{
+    std::vector<AlignedStep_t> out;
+    AlignedStep_t step;
+    while (Align_GetRecord(&step, now) == 0) out.push_back(step);
+    return out;
+}
+
+bool TimesAre(const std::vector<AlignedStep_t> &steps, std::vector<uint32_t> want)
+{
+    if (steps.size() != want.size()) return false;
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (steps[i].time_ms != want[i]) return false;
+    }
+    return true;
+}
+
+void WalkBack()
+{
+    Align_Init();
+    sentData_t full = Batch(1, { 1000, 1000, 900, 1100, 1000 });
+    Align_AddBatch(&full, 60000);
+    std::vector<AlignedStep_t> s = Drain(70000);
+    Check("full batch", TimesAre(s, { 56000, 57000, 57900, 59000, 60000 }), "%zu step(s), first at %u",
+          s.size(), s.empty() ? 0 : s[0].time_ms);
+
+    // A partial batch leaves the ankle ALIGN_FLUSH_DELAY_MS after its last step
+    sentData_t partial = Batch(6, { 1000, 800 });
+    Align_AddBatch(&partial, 80000);
+    s = Drain(90000);
+    Check("partial batch", TimesAre(s, { 80000 - ALIGN_FLUSH_DELAY_MS - 800, 80000 - ALIGN_FLUSH_DELAY_MS }),
+          "%zu step(s), last at %u", s.size(), s.empty() ? 0 : s.back().time_ms);
+}
+
+void EarlyBoot()
+{
+    // Received 1.2 s after the wrist booted: both steps predate it
+    Align_Init();
+    sentData_t partial = Batch(1, { 1000, 1000 });
+    Align_AddBatch(&partial, 1200);
+    std::vector<AlignedStep_t> s = Drain(10000);
+    Check("partial before boot", TimesAre(s, { 0, 0 }) && Align_GetStats()->steps_early == 2,
+          "times %u, %u, %u early", s.size() > 0 ? s[0].time_ms : 0, s.size() > 1 ? s[1].time_ms : 0,
+          Align_GetStats()->steps_early);
+
+    // Full batch at 1.5 s: the last two steps are after the boot
+    Align_Init();
+    sentData_t full = Batch(1, { 1000, 1000, 1000, 1000, 1000 });
+    Align_AddBatch(&full, 1500);
+    s = Drain(10000);
+    Check("full across boot", TimesAre(s, { 0, 0, 0, 500, 1500 }) && Align_GetStats()->steps_early == 3,
+          "%zu step(s), %u early", s.size(), Align_GetStats()->steps_early);
+
+    // Landing exactly on tick 0 is not early
+    Align_Init();
+    sentData_t exact = Batch(1, { 1000, 500 });
+    Align_AddBatch(&exact, ALIGN_FLUSH_DELAY_MS + 500);
+    s = Drain(10000);
+    Check("on the boot tick", TimesAre(s, { 0, 500 }) && Align_GetStats()->steps_early == 0,
+          "%u early", Align_GetStats()->steps_early);
+}
+
+void Numbering()
+{
+    Align_Init();
+    sentData_t a = Batch(1, { 1000, 1000, 1000, 1000, 1000 });
+    Align_AddBatch(&a, 10000);
+    Align_AddBatch(&a, 10100);     // Retransmit
+    sentData_t b = Batch(9, { 1000, 1000, 1000, 1000, 1000 });
+    Align_AddBatch(&b, 20000);
+    std::vector<AlignedStep_t> s = Drain(30000);
+    const AlignStats_t *st = Align_GetStats();
+    Check("retransmit and gap", s.size() == 10 && st->steps_duplicate == 5 && st->steps_lost == 3,
+          "%zu step(s), %u duplicate, %u lost", s.size(), st->steps_duplicate, st->steps_lost);
+
+    // The on-air count is 16-bit; the aligner carries it past 65535
+    Align_Init();
+    sentData_t c = Batch(65531, { 1000, 1000, 1000, 1000, 1000 });
+    sentData_t d = Batch(0, { 1000, 1000, 1000, 1000, 1000 });
+    Align_AddBatch(&c, 10000);
+    Align_AddBatch(&d, 15000);
+    s = Drain(30000);
+    Check("16-bit count wrap", s.size() == 10 && s.back().step_number == 65540 && Align_GetStats()->steps_lost == 0,
+          "last step %u, %u lost", s.empty() ? 0 : s.back().step_number, Align_GetStats()->steps_lost);
+}
+
+void HeartRate()
+{
+    Align_Init();
+    Align_AddHeartRate(60, 49000);
+    sentData_t a = Batch(1, { 1000, 1000, 1000, 1000, 1000 });
+    Align_AddBatch(&a, 54000);
+
+    // Held until an estimate after the last step arrives
+    std::vector<AlignedStep_t> s = Drain(54500);
+    const size_t held = s.size();
+    Align_AddHeartRate(100, 55000);
+    std::vector<AlignedStep_t> rest = Drain(55000);
+    s.insert(s.end(), rest.begin(), rest.end());
+
+    const bool ok = s.size() == 5 && s[0].heart_rate == 66 && s[4].heart_rate == 93 && s[4].hr_valid;
+    Check("hr interpolation", held == 0 && ok, "%zu released early, last step %d bpm", held,
+          s.size() == 5 ? s[4].heart_rate : 0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        std::fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    WalkBack();
+    EarlyBoot();
+    Numbering();
+    HeartRate();
+    return bench::Summary("check(s)");
+}
@@ -0,0 +1,49 @@
+/* ========================================
+   File: bench_check.h
+   PASS/FAIL Lines and Timing for the Host Checks
+
+   Shared by the host tools that check firmware
+   code: one line per check with a printf-style
+   detail, a failure count for the exit status and
+   ns per operation for the timing sections.
+   ======================================== */
+
+#ifndef BENCH_CHECK_H
+#define BENCH_CHECK_H
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+namespace bench {
+
+inline int failures = 0;
+
+inline void Check(const char *name, bool ok, const char *fmt, ...)
+{
+    char detail[160];
+    va_list ap;
+    va_start(ap, fmt);
+    std::vsnprintf(detail, sizeof(detail), fmt, ap);
+    va_end(ap);
+    std::printf("%s  %-28s %s\n", ok ? "PASS" : "FAIL", name, detail);
+    if (!ok) failures++;
+}
+
+inline double NsSince(std::chrono::steady_clock::time_point t0, uint64_t ops)
+{
+    std::chrono::duration<double, std::nano> dt = std::chrono::steady_clock::now() - t0;
+    return dt.count() / ops;
+}
+
+/* Footer line; the exit status for main. what: "check(s)", "scenario(s)" */
+inline int Summary(const char *what)
+{
+    std::printf("\n%s: %d %s failed\n", failures ? "FAILED" : "ok", failures, what);
+    return failures ? 1 : 0;
+}
+
+} // namespace bench
+
+#endif /* BENCH_CHECK_H */
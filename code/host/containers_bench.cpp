@@ -0,0 +1,309 @@
+/* ========================================
+   File: containers_bench.cpp
+   Shared Container Checks and Benchmarks
+
+   Exercises containers.h (identical in both node
+   trees) on Linux: ring, vector and pool edge
+   cases, index wrap at 2^32, a producer and a
+   consumer thread hammering the ring (yielding
+   when full or empty, so one core is enough),
+   then times
+   the ring against the hand-rolled modulo rings it
+   replaced. Exits non-zero if any check fails.
+
+   Usage: containers_bench [-n MILLIONS]
+   ======================================== */
+
+extern "C" {
+#include "containers.h"
+}
+
+#include "bench_check.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+using bench::Check;
+using bench::NsSince;
+
+/* Same shape as the firmware queues */
+struct Packet {
+    uint32_t seq;
+    uint8_t body[26];
+};
+
+RING_DEFINE(packets, Packet, 32);
+RING_DEFINE(bytes, uint8_t, 512);
+VEC_DEFINE(steps, uint16_t, 5);
+POOL_DEFINE(pool, Packet, 32);
+POOL_DEFINE(single, uint32_t, 1);
+
+/* ---- Single-threaded edge cases ------------------------------------------- */
+
+void RingBasics()
+{
+    Packet p = {};
+    bool ok = Ring_Count(&packets) == 0 && Ring_Peek(&packets) == nullptr && !Ring_Pop(&packets, &p);
+    for (uint32_t i = 0; i < 32; i++) {
+        p.seq = i;
+        ok = ok && Ring_Push(&packets, &p);
+    }
+    p.seq = 99;
+    ok = ok && !Ring_Push(&packets, &p) && Ring_Slot(&packets) == nullptr && Ring_Space(&packets) == 0;
+    for (uint32_t i = 0; i < 32; i++) ok = ok && Ring_Pop(&packets, &p) && p.seq == i;
+    ok = ok && Ring_Count(&packets) == 0;
+    Check("ring fill/drain", ok, "all %u slots usable, FIFO order, full and empty refused", Ring_Capacity(&packets));
+
+    /* Free-running indices straddling 2^32 */
+    Ring_t r = packets;
+    r.head = r.tail = 0xFFFFFFF0u;
+    ok = true;
+    for (uint32_t i = 0; i < 1000; i++) {
+        p.seq = i;
+        ok = ok && Ring_Push(&r, &p);
+        if (i % 3 == 2) {
+            for (uint32_t k = 0; k < 3; k++) ok = ok && Ring_Pop(&r, &p) && p.seq == i - 2 + k;
+        }
+    }
+    Check("ring index wrap", ok, "head/tail through 0xFFFFFFFF, count %u", Ring_Count(&r));
+
+    uint8_t line[300], out[512];
+    for (uint32_t i = 0; i < sizeof(line); i++) line[i] = uint8_t(i * 7);
+    Ring_Reset(&bytes);
+    bytes.head = bytes.tail = 400;
+    ok = Ring_Write(&bytes, line, 300) && !Ring_Write(&bytes, line, 213) && Ring_Write(&bytes, line, 212);
+    const uint8_t *span;
+    uint32_t first = Ring_Span(&bytes, &span);
+    std::memcpy(out, span, first);
+    Ring_Drop(&bytes, first);
+    uint32_t second = Ring_Span(&bytes, &span);
+    std::memcpy(out + first, span, second);
+    Ring_Drop(&bytes, second);
+    ok = ok && first == 112 && second == 400 && std::memcmp(out, line, 300) == 0 &&
+         std::memcmp(out + 300, line, 212) == 0 && Ring_Span(&bytes, &span) == 0;
+    Check("byte ring split", ok, "write wraps, all-or-nothing, spans %u + %u", first, second);
+}
+
+void VecBasics()
+{
+    bool ok = Vec_Capacity(&steps) == 5 && Vec_Len(&steps) == 0;
+    for (uint16_t i = 0; i < 5; i++) ok = ok && Vec_Push(&steps, uint16_t(100 + i));
+    ok = ok && Vec_Full(&steps) && !Vec_Push(&steps, uint16_t(7));
+    Vec_Remove(&steps, 1);
+    ok = ok && Vec_Len(&steps) == 4 && Vec_At(&steps, 0) == 100 && Vec_At(&steps, 1) == 102 && Vec_At(&steps, 3) == 104;
+    Vec_Clear(&steps);
+    ok = ok && Vec_Len(&steps) == 0;
+    Check("vector", ok, "push to capacity, ordered remove, clear");
+}
+
+void PoolBasics()
+{
+    void *got[32];
+    bool ok = Pool_Available(&pool) == 32;
+    for (int i = 0; i < 32; i++) {
+        got[i] = Pool_Alloc(&pool);
+        ok = ok && got[i] != nullptr;
+        for (int k = 0; k < i; k++) ok = ok && got[k] != got[i];
+    }
+    ok = ok && Pool_Alloc(&pool) == nullptr && Pool_Available(&pool) == 0;
+    Pool_Free(&pool, got[17]);
+    ok = ok && Pool_Alloc(&pool) == got[17];
+    for (int i = 0; i < 32; i++) Pool_Free(&pool, got[i]);
+    ok = ok && Pool_Available(&pool) == 32;
+
+    void *one = Pool_Alloc(&single);
+    ok = ok && one != nullptr && Pool_Alloc(&single) == nullptr;
+    Pool_Free(&single, one);
+    ok = ok && Pool_Available(&single) == 1;
+    Check("pool", ok, "32 distinct objects, exhaustion, reuse, 1-object pool");
+}
+
+/* ---- Two threads ---------------------------------------------------------- */
+
+void RingThreads(uint64_t n)
+{
+    Ring_Reset(&packets);
+    uint64_t bad = 0;
+
+    std::thread producer([n] {
+        Packet p;
+        for (uint64_t i = 0; i < n; i++) {
+            p.seq = uint32_t(i);
+            std::memset(p.body, int(i & 0xFF), sizeof(p.body));
+            while (!Ring_Push(&packets, &p)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    Packet p;
+    for (uint64_t i = 0; i < n; i++) {
+        while (!Ring_Pop(&packets, &p)) {
+            std::this_thread::yield();
+        }
+        if (p.seq != uint32_t(i) || p.body[0] != uint8_t(i) || p.body[25] != uint8_t(i)) bad++;
+    }
+    producer.join();
+    Check("ring SPSC threads", bad == 0, "%llu packets, %llu out of order or torn",
+          (unsigned long long)n, (unsigned long long)bad);
+
+    /* Byte ring with odd-sized writes and spans, like printf into the UART ring */
+    Ring_Reset(&bytes);
+    uint64_t total = n * 8;
+    std::thread writer([total] {
+        uint8_t chunk[61];
+        uint64_t at = 0;
+        uint32_t len = 1;
+        while (at < total) {
+            len = len % 61 + 1;
+            if (len > total - at) len = uint32_t(total - at);
+            for (uint32_t k = 0; k < len; k++) chunk[k] = uint8_t((at + k) * 13);
+            if (Ring_Write(&bytes, chunk, len)) {
+                at += len;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    bad = 0;
+    for (uint64_t at = 0; at < total;) {
+        const uint8_t *span;
+        uint32_t len = Ring_Span(&bytes, &span);
+        if (len == 0) std::this_thread::yield();
+        for (uint32_t k = 0; k < len; k++) bad += span[k] != uint8_t((at + k) * 13);
+        Ring_Drop(&bytes, len);
+        at += len;
+    }
+    writer.join();
+    Check("byte ring threads", bad == 0, "%llu bytes, %llu corrupted", (unsigned long long)total,
+          (unsigned long long)bad);
+}
+
+void PoolThreads(uint64_t n)
+{
+    uint64_t clash = 0;
+    auto worker = [n](uint32_t id, uint64_t *clashes) {
+        for (uint64_t i = 0; i < n; i++) {
+            Packet *p = static_cast<Packet *>(Pool_Alloc(&pool));
+            if (p == nullptr) continue;
+            p->seq = id;
+            for (int spin = 0; spin < 8; spin++) *clashes += p->seq != id;
+            Pool_Free(&pool, p);
+        }
+    };
+    uint64_t other = 0;
+    std::thread t(worker, 1u, &other);
+    worker(2u, &clash);
+    t.join();
+    Check("pool threads", clash + other == 0 && Pool_Available(&pool) == 32, "%llu alloc/free pairs per thread",
+          (unsigned long long)n);
+}
+
+/* ---- Timing --------------------------------------------------------------- */
+
+/* The ad-hoc ring sd_logger.c used: head + count, modulo indexing */
+struct ModRing {
+    Packet slot[32];
+    uint8_t head = 0;
+    uint8_t count = 0;
+};
+
+void Bench(uint64_t n, double cross_ns)
+{
+    Packet p = {};
+    volatile uint32_t sink = 0;
+
+    Ring_Reset(&packets);
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        p.seq = uint32_t(i);
+        Ring_Push(&packets, &p);
+        Ring_Pop(&packets, &p);
+        sink = sink + p.seq;
+    }
+    double ring_ns = NsSince(t0, n);
+
+    static ModRing mod;
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        p.seq = uint32_t(i);
+        if (mod.count < 32) {
+            mod.slot[(mod.head + mod.count) % 32] = p;
+            mod.count++;
+        }
+        if (mod.count > 0) {
+            p = mod.slot[mod.head];
+            mod.head = (mod.head + 1) % 32;
+            mod.count--;
+        }
+        sink = sink + p.seq;
+    }
+    double mod_ns = NsSince(t0, n);
+    std::printf("push+pop 30 B       %6.2f ns ring, %6.2f ns modulo ring\n", ring_ns, mod_ns);
+
+    /* 24-byte plotter line: one Ring_Write against the old byte-at-a-time copy */
+    static const char line[] = "Diff:123.45,Thresh175.0\r";
+    static uint8_t tel[512];
+    static uint16_t tel_head, tel_tail;
+    Ring_Reset(&bytes);
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        Ring_Write(&bytes, line, 24);
+        Ring_Drop(&bytes, 24);
+    }
+    double write_ns = NsSince(t0, n);
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        uint16_t used = (tel_head - tel_tail) & 511;
+        if (24 <= 511 - used) {
+            for (int k = 0; k < 24; k++) {
+                tel[tel_head] = uint8_t(line[k]);
+                tel_head = (tel_head + 1) & 511;
+            }
+        }
+        tel_tail = tel_head;
+        sink = sink + tel[tel_tail];
+    }
+    double loop_ns = NsSince(t0, n);
+    std::printf("24-byte line        %6.2f ns Ring_Write, %6.2f ns byte loop\n", write_ns, loop_ns);
+
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        void *obj = Pool_Alloc(&pool);
+        Pool_Free(&pool, obj);
+    }
+    std::printf("pool alloc+free     %6.2f ns\n", NsSince(t0, n));
+    std::printf("cross-thread        %6.2f ns per packet, plus 8 bytes through the byte ring\n", cross_ns);
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+    uint64_t n = 4000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = uint64_t(std::strtod(argv[++i], nullptr) * 1e6);
+        } else {
+            std::fprintf(stderr, "usage: %s [-n MILLIONS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    RingBasics();
+    VecBasics();
+    PoolBasics();
+    auto t0 = std::chrono::steady_clock::now();
+    RingThreads(n);
+    double cross_ns = NsSince(t0, n);
+    PoolThreads(n / 4);
+    std::printf("\n");
+    Bench(n, cross_ns);
+
+    return bench::Summary("check(s)");
+}
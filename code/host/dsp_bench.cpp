@@ -0,0 +1,406 @@
+/* ========================================
+   File: dsp_bench.cpp
+   DSP Kernel Checks and Benchmarks
+
+   Checks dsp.c on Linux, where the SIMD
+   instructions run as their C equivalents,
+   against plain one-sample-at-a-time loops:
+   length and full-scale edges, random blocks,
+   and that splitting a stream into blocks does
+   not change the filter or peak output. Runs
+   the wrist HR front end on a synthetic PPG.
+   Then times each batched path against the same
+   work done a sample per call. Exits non-zero
+   if any check fails.
+
+   Usage: dsp_bench [-n MILLIONS]
+   ======================================== */
+
+extern "C" {
+#include "dsp.h"
+}
+
+#include "bench_check.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using bench::Check;
+using bench::NsSince;
+
+constexpr double kPi = 3.14159265358979;
+constexpr double kFs = 25;            // max30102.h MAX30102_SAMPLE_HZ
+constexpr uint32_t kBatch = 4;        // wrist PPG_BATCH, ankle DETECT_BLOCK
+
+// max30102.c HR band-pass: 0.5 Hz high-pass, 4 Hz low-pass, post shift 1
+const int32_t kHrCoeffs[2 * DSP_BIQUAD_COEFFS] = {
+    982440638, -1964881276, 982440638, 1957103774, -898916953,
+    156040332,   312080664, 156040332,  720512000, -270931504
+};
+
+// ---- plain references ------------------------------------------------------
+
+int64_t RefSum(const int32_t *src, uint32_t n)
+{
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) sum += src[i];
+    return sum;
+}
+
+uint64_t RefAbsDev(const int32_t *src, uint32_t n, int32_t mean)
+{
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const int64_t d = int64_t(src[i]) - mean;
+        sum += uint64_t(d < 0 ? -d : d);
+    }
+    return sum;
+}
+
+int64_t RefDot(const int16_t *a, const int16_t *b, uint32_t n)
+{
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) sum += int32_t(a[i]) * b[i];
+    return sum;
+}
+
+// Both stages a sample at a time, history in memory
+struct RefBiquad {
+    const int32_t *c;
+    int stages, shift;
+    int32_t st[8][4] = {};
+
+    int32_t Step(int32_t x)
+    {
+        for (int s = 0; s < stages; s++) {
+            const int32_t *k = &c[s * DSP_BIQUAD_COEFFS];
+            int32_t *h = st[s];
+            const int64_t acc = int64_t(k[0]) * x + int64_t(k[1]) * h[0] + int64_t(k[2]) * h[1] +
+                                int64_t(k[3]) * h[2] + int64_t(k[4]) * h[3];
+            const int32_t y = int32_t(acc >> shift);
+            h[1] = h[0]; h[0] = x;
+            h[3] = h[2]; h[2] = y;
+            x = y;
+        }
+        return x;
+    }
+};
+
+// ---- checks ----------------------------------------------------------------
+
+int CompareStats(const std::vector<int32_t> &v, int32_t mean)
+{
+    const uint32_t n = uint32_t(v.size());
+    int bad = 0;
+    if (DSP_SumQ31(v.data(), n) != RefSum(v.data(), n)) bad++;
+    if (DSP_AbsDevQ31(v.data(), n, mean) != RefAbsDev(v.data(), n, mean)) bad++;
+    return bad;
+}
+
+int CompareQ15(const std::vector<int16_t> &a, const std::vector<int16_t> &b)
+{
+    const uint32_t n = uint32_t(a.size());
+    int bad = 0;
+    if (DSP_DotQ15(a.data(), b.data(), n) != RefDot(a.data(), b.data(), n)) bad++;
+
+    // One spare slot past the end catches a paired store that overruns an odd length
+    std::vector<uint16_t> d(n + 1, 0xBEEF);
+    DSP_AbsDiffQ15(a.data(), b.data(), d.data(), n);
+    for (uint32_t i = 0; i < n; i++) {
+        const int32_t r = int32_t(a[i]) - b[i];
+        if (d[i] != uint16_t(r < 0 ? -r : r)) bad++;
+    }
+    if (d[n] != 0xBEEF) bad++;
+    return bad;
+}
+
+void Edges()
+{
+    int bad = 0;
+    for (uint32_t n = 0; n <= 9; n++) {
+        std::vector<int32_t> v(n);
+        std::vector<int16_t> a(n), b(n);
+        for (uint32_t i = 0; i < n; i++) {
+            v[i] = int32_t(i * 7919) - 20000;
+            a[i] = int16_t(i * 4099 - 15000);
+            b[i] = int16_t(9000 - i * 3001);
+        }
+        bad += CompareStats(v, -3) + CompareQ15(a, b);
+    }
+    Check("lengths 0..9", bad == 0, "%d mismatch(es)", bad);
+
+    bad = 0;
+    const std::vector<int32_t> high(13, INT32_MAX), low(13, INT32_MIN);
+    std::vector<int32_t> mixed(13);
+    for (size_t i = 0; i < mixed.size(); i++) mixed[i] = i & 1 ? INT32_MAX : INT32_MIN;
+    for (int32_t mean : { INT32_MIN, -1, 0, INT32_MAX }) {
+        bad += CompareStats(high, mean) + CompareStats(low, mean) + CompareStats(mixed, mean);
+    }
+    Check("int32 full scale", bad == 0, "%d mismatch(es)", bad);
+
+    // Largest products and the full 0..65535 swing either way round
+    bad = 0;
+    const std::vector<int16_t> max(7, INT16_MAX), min(7, INT16_MIN);
+    bad += CompareQ15(min, min) + CompareQ15(max, min) + CompareQ15(min, max) + CompareQ15(max, max);
+    uint16_t swing[2];
+    const int16_t gy[2] = { INT16_MAX, INT16_MIN }, gz[2] = { INT16_MIN, INT16_MAX };
+    DSP_AbsDiffQ15(gy, gz, swing, 2);
+    Check("int16 full scale", bad == 0 && swing[0] == 65535 && swing[1] == 65535, "%d mismatch(es), swing %u %u",
+          bad, swing[0], swing[1]);
+}
+
+void Random(uint64_t n)
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> len(1, 200);
+    std::uniform_int_distribution<int32_t> counts(0, (1 << 18) - 1);   // 18-bit PPG ADC
+    std::uniform_int_distribution<int32_t> q15(INT16_MIN, INT16_MAX);
+    int bad = 0;
+
+    for (uint64_t blocks = 0; blocks < n; blocks++) {
+        std::vector<int32_t> v(len(rng));
+        for (int32_t &x : v) x = counts(rng);
+        const int32_t mean = int32_t(RefSum(v.data(), uint32_t(v.size())) / int64_t(v.size()));
+        bad += CompareStats(v, mean);
+
+        std::vector<int16_t> a(len(rng) % 33), b(a.size());
+        for (size_t i = 0; i < a.size(); i++) {
+            a[i] = int16_t(q15(rng));
+            b[i] = int16_t(q15(rng));
+        }
+        bad += CompareQ15(a, b);
+    }
+    Check("random blocks", bad == 0, "%d mismatch(es) in %" PRIu64 " blocks", bad, n);
+}
+
+// Synthetic wrist PPG: DC, a pulse at bpm and some noise
+std::vector<int32_t> Ppg(double bpm, double seconds, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0, 20);
+    std::vector<int32_t> v(size_t(seconds * kFs));
+    for (size_t i = 0; i < v.size(); i++) {
+        const double t = i / kFs;
+        v[i] = int32_t(120000 + 400 * std::sin(2 * kPi * bpm / 60 * t) + noise(rng));
+    }
+    return v;
+}
+
+void Biquad()
+{
+    // Block and sample-at-a-time outputs agree bit for bit, for any split of the stream
+    const std::vector<int32_t> in = Ppg(72, 60, 3);
+    RefBiquad ref{ kHrCoeffs, 2, 30 };
+    int32_t state[2 * DSP_BIQUAD_STATE];
+    DSP_BiquadQ31_t bq;
+    DSP_BiquadQ31_Init(&bq, 2, 1, kHrCoeffs, state);
+
+    std::mt19937 rng(4);
+    std::vector<int32_t> out(in.size());
+    int bad = 0;
+    for (size_t i = 0; i < in.size();) {
+        const uint32_t n = uint32_t(std::min<size_t>(1 + rng() % 32, in.size() - i));
+        DSP_BiquadQ31_Process(&bq, &in[i], &out[i], n);
+        i += n;
+    }
+    for (size_t i = 0; i < in.size(); i++) {
+        if (out[i] != ref.Step(in[i])) bad++;
+    }
+    Check("biquad blocks = per sample", bad == 0, "%d mismatch(es) in %zu samples", bad, in.size());
+
+    // In place, as the later stages run
+    std::vector<int32_t> inplace(in);
+    DSP_BiquadQ31_Init(&bq, 2, 1, kHrCoeffs, state);
+    DSP_BiquadQ31_Process(&bq, inplace.data(), inplace.data(), uint32_t(inplace.size()));
+    Check("biquad in place", inplace == out, "%s", inplace == out ? "same" : "differs");
+
+    // Pass band and stop band of the HR filter, after 10 s to settle
+    auto gain = [&](double hz) {
+        DSP_BiquadQ31_Init(&bq, 2, 1, kHrCoeffs, state);
+        double peak = 0;
+        for (int i = 0; i < 30 * kFs; i++) {
+            int32_t x = int32_t(10000 * std::sin(2 * kPi * hz * i / kFs)), y;
+            DSP_BiquadQ31_Process(&bq, &x, &y, 1);
+            if (i >= 10 * kFs) peak = std::max(peak, std::fabs(double(y)));
+        }
+        return peak / 10000;
+    };
+    const double pass = gain(1.2), low = gain(0.1), high = gain(10);
+    Check("HR band-pass response", pass > 0.95 && low < 0.06 && high < 0.1, "1.2 Hz x%.3f, 0.1 Hz x%.3f, 10 Hz x%.3f",
+          pass, low, high);
+}
+
+// HR front end as max30102.c runs it: band-pass, peaks, mean interval in bpm
+double HeartRate(const std::vector<int32_t> &in, uint32_t block, std::vector<uint32_t> *peaks_out)
+{
+    int32_t state[2 * DSP_BIQUAD_STATE];
+    DSP_BiquadQ31_t bq;
+    DSP_PeakQ31_t pk;
+    DSP_BiquadQ31_Init(&bq, 2, 1, kHrCoeffs, state);
+    state[0] = state[1] = in[0];   // Primed at the first level, as MAX30102_PrimeHeartRate does
+    DSP_PeakQ31_Init(&pk, 100, 7, 31785, 16384);
+
+    std::vector<uint32_t> peaks;
+    int32_t f[32];
+    uint32_t found[32];
+    for (size_t i = 0; i < in.size(); i += block) {
+        const uint32_t n = uint32_t(std::min<size_t>(block, in.size() - i));
+        DSP_BiquadQ31_Process(&bq, &in[i], f, n);
+        const uint16_t k = DSP_PeakQ31_Process(&pk, f, n, found, 32);
+        peaks.insert(peaks.end(), found, found + k);
+    }
+    if (peaks_out) *peaks_out = peaks;
+    if (peaks.size() < 2) return 0;
+    return 60 * kFs * double(peaks.size() - 1) / double(peaks.back() - peaks.front());
+}
+
+void Peaks()
+{
+    std::vector<uint32_t> whole, batched, single;
+    const std::vector<int32_t> in = Ppg(72, 60, 5);
+    const double bpm = HeartRate(in, 32, &whole);
+    HeartRate(in, kBatch, &batched);
+    HeartRate(in, 1, &single);
+    Check("peaks, any block size", whole == batched && whole == single, "%zu, %zu and %zu peaks",
+          whole.size(), batched.size(), single.size());
+    Check("72 bpm PPG", std::fabs(bpm - 72) < 1, "%.1f bpm from %zu peaks", bpm, whole.size());
+
+    int bad = 0;
+    for (double rate : { 45.0, 100.0, 160.0 }) {
+        const double got = HeartRate(Ppg(rate, 60, 6), kBatch, nullptr);
+        if (std::fabs(got - rate) > rate / 50) {
+            std::printf("      %.0f bpm read as %.1f\n", rate, got);
+            bad++;
+        }
+    }
+    Check("45..160 bpm PPG", bad == 0, "%d rate(s) off by more than 2%%", bad);
+
+    // Flat input: nothing crosses the floor
+    const std::vector<int32_t> flat(500, 120000);
+    const double none = HeartRate(flat, kBatch, &whole);
+    Check("no pulse, no peaks", none == 0 && whole.empty(), "%zu peak(s)", whole.size());
+}
+
+// ---- timing: batches against the same work a sample per call ----------------
+
+void Timing(uint64_t n)
+{
+    enum { kBuffer = 100 };   // max30102.c BUFFER_SIZE
+    const std::vector<int32_t> ppg = Ppg(72, 40, 7);
+    const uint32_t len = uint32_t(ppg.size()) / kBatch * kBatch;
+    const uint64_t passes = n / len + 1;
+    volatile int64_t sink = 0;
+
+    // HR front end: band-pass and peaks, one call per sample against one per batch
+    int32_t state[2 * DSP_BIQUAD_STATE], y[kBatch];
+    uint32_t found[kBatch];
+    DSP_BiquadQ31_t bq;
+    DSP_PeakQ31_t pk;
+    double ns[2];
+    for (uint32_t mode = 0; mode < 2; mode++) {
+        const uint32_t step = mode ? kBatch : 1;
+        DSP_BiquadQ31_Init(&bq, 2, 1, kHrCoeffs, state);
+        DSP_PeakQ31_Init(&pk, 100, 7, 31785, 16384);
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t p = 0; p < passes; p++) {
+            for (uint32_t i = 0; i < len; i += step) {
+                DSP_BiquadQ31_Process(&bq, &ppg[i], y, step);
+                sink = sink + DSP_PeakQ31_Process(&pk, y, step, found, kBatch);
+            }
+        }
+        ns[mode] = NsSince(t0, passes * len);
+    }
+    std::printf("\nper sample, %u-sample batches against one sample per call (host, C in place of SIMD)\n",
+                unsigned(kBatch));
+    std::printf("HR band-pass + peaks:      %.1f ns, batched %.1f ns\n", ns[0], ns[1]);
+
+    // SpO2 statistics over the 100-sample buffers: every sample before, every batch now
+    int32_t buf[kBuffer];
+    for (int i = 0; i < kBuffer; i++) buf[i] = ppg[i];
+    for (uint32_t mode = 0; mode < 2; mode++) {
+        const uint32_t step = mode ? kBatch : 1;
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < n; i += step) {
+            buf[i % kBuffer] ^= 1;
+            const int32_t dc = int32_t(DSP_SumQ31(buf, kBuffer) / kBuffer);
+            sink = sink + int64_t(DSP_AbsDevQ31(buf, kBuffer, dc));
+        }
+        ns[mode] = NsSince(t0, n);
+    }
+    std::printf("SpO2 sum + abs-dev:        %.1f ns, batched %.1f ns\n", ns[0], ns[1]);
+
+    // Ankle swing: SSUB16/SEL pairs against the scalar |gy - gz|
+    std::mt19937 rng(8);
+    int16_t gy[256], gz[256];
+    uint16_t sw[256];
+    for (int i = 0; i < 256; i++) {
+        gy[i] = int16_t(rng());
+        gz[i] = int16_t(rng());
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        const uint32_t k = i & 255;
+        const int32_t d = int32_t(gy[k]) - gz[k];
+        sink = sink + (d < 0 ? -d : d);
+    }
+    ns[0] = NsSince(t0, n);
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i += kBatch) {
+        DSP_AbsDiffQ15(&gy[i & 252], &gz[i & 252], sw, kBatch);
+        sink = sink + sw[0];
+    }
+    ns[1] = NsSince(t0, n);
+    std::printf("ankle |gy - gz|:           %.1f ns, batched %.1f ns\n", ns[0], ns[1]);
+
+    // Canceller estimate: four Q15 taps against the float loop it replaced
+    const int16_t ref[4] = { 23170, -23170, 0, 32767 };
+    int16_t taps[4] = { 1200, -300, 45, 800 };
+    float wf[4] = { 1200, -300, 45, 800 }, rf[4] = { 0.7071f, -0.7071f, 0, 1 };
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        wf[i & 3] += 1;
+        float acc = 0;
+        for (int k = 0; k < 4; k++) acc += wf[k] * rf[k];
+        sink = sink + int64_t(acc);
+    }
+    ns[0] = NsSince(t0, n);
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        taps[i & 3]++;
+        sink = sink + (DSP_DotQ15(taps, ref, 4) >> 15);
+    }
+    ns[1] = NsSince(t0, n);
+    std::printf("canceller 4-tap estimate:  float %.1f ns, Q15 %.1f ns\n", ns[0], ns[1]);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint64_t n = 1000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = uint64_t(std::strtod(argv[++i], nullptr) * 1e6);
+        } else {
+            std::fprintf(stderr, "usage: %s [-n MILLIONS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Edges();
+    Random(n / 10);
+    Biquad();
+    Peaks();
+    Timing(n);
+    return bench::Summary("check(s)");
+}
@@ -0,0 +1,268 @@
+/* ========================================
+   File: energy_est.cpp
+   Battery-life Estimator from Recorded Energy Traces
+
+   Reads the "energy,..." lines either node prints
+   (energy.c: cumulative ms per power state and the
+   node's current table) from a wrist console
+   capture, a tel_plot -e trace or stdin; other
+   lines are skipped. An uptime that goes backwards
+   is a reset and starts a new segment. The state
+   times are replayed twice, against the trace's
+   own currents and against an alternative set:
+   per-state currents (-i), per-state time factors
+   (-t; active or stop time taken off or given back
+   to sleep), base current (-B) and cell capacity
+   (-b, times -k for the 3.2 V to 5 V conversion of
+   the power spreadsheet). Prints charge per state,
+   average current and battery life for both.
+
+   Usage: energy_est [-i STATE=UA]... [-t STATE=FACTOR]...
+                     [-B UA] [-b MAH] [-k FACTOR] [-c CSV] [FILE|-]
+     -c  average current per trace interval, both configurations
+   ======================================== */
+
+extern "C" {
+#include "energy.h"
+}
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Row {
+    uint32_t uptime_ms;
+    uint32_t base_ua;
+    uint32_t battery_uah;
+    uint32_t state_ms[ENERGY_COUNT];
+    uint32_t state_ua[ENERGY_COUNT];
+};
+
+struct Config {
+    double base_ua = -1;                // Negative: keep the trace's value
+    double battery_uah = -1;
+    double state_ua[ENERGY_COUNT];
+    double time_factor[ENERGY_COUNT];
+
+    Config()
+    {
+        for (int i = 0; i < ENERGY_COUNT; i++) {
+            state_ua[i] = -1;
+            time_factor[i] = 1.0;
+        }
+    }
+};
+
+struct Totals {
+    double uptime_ms = 0;
+    double state_ms[ENERGY_COUNT] = {};
+    double base_uah = 0;
+    double state_uah[ENERGY_COUNT] = {};
+    double charge_uah = 0;
+    double battery_uah = 0;
+
+    double AvgUa() const { return uptime_ms > 0 ? charge_uah * 3.6e6 / uptime_ms : 0; }
+    double LifeH() const { return AvgUa() > 0 ? battery_uah / AvgUa() : 0; }
+};
+
+int StateByName(const std::string &name)
+{
+    for (int i = 0; i < ENERGY_COUNT; i++) {
+        if (name == Energy_Name(EnergyState_t(i))) return i;
+    }
+    return -1;
+}
+
+// "energy,<uptime>,<base>,<battery>,<state>=<ms>:<uA>,..." in energy.h state order
+bool ParseRow(const char *s, Row &row)
+{
+    const char *p = std::strstr(s, "energy,");
+    if (!p) return false;
+    p += 7;
+
+    char *end;
+    uint32_t head[3];
+    for (uint32_t &v : head) {
+        v = uint32_t(std::strtoul(p, &end, 10));
+        if (end == p || *end != ',') return false;
+        p = end + 1;
+    }
+    row.uptime_ms = head[0];
+    row.base_ua = head[1];
+    row.battery_uah = head[2];
+
+    for (int i = 0; i < ENERGY_COUNT; i++) {
+        const char *name = Energy_Name(EnergyState_t(i));
+        const size_t n = std::strlen(name);
+        if (std::strncmp(p, name, n) != 0 || p[n] != '=') return false;
+        p += n + 1;
+        row.state_ms[i] = uint32_t(std::strtoul(p, &end, 10));
+        if (end == p || *end != ':') return false;
+        p = end + 1;
+        row.state_ua[i] = uint32_t(std::strtoul(p, &end, 10));
+        if (end == p) return false;
+        p = end;
+        if (i + 1 < ENERGY_COUNT && *p++ != ',') return false;
+    }
+    return true;
+}
+
+// One interval of a trace with cfg applied; the core states still add up to the uptime
+void Replay(const Row &from, const Row &to, const Config &cfg, Totals &t)
+{
+    double ms[ENERGY_COUNT];
+    const double uptime = double(to.uptime_ms) - from.uptime_ms;
+
+    for (int i = 0; i < ENERGY_COUNT; i++) {
+        ms[i] = (double(to.state_ms[i]) - from.state_ms[i]) * cfg.time_factor[i];
+        if (ms[i] < 0) ms[i] = 0;
+    }
+    for (int i : { ENERGY_ACTIVE, ENERGY_STOP }) {
+        const double extra = ms[i] - (double(to.state_ms[i]) - from.state_ms[i]);
+        const double take = extra < ms[ENERGY_SLEEP] ? extra : ms[ENERGY_SLEEP];
+        ms[ENERGY_SLEEP] -= take;
+        ms[i] -= extra - take;
+    }
+    for (int i = ENERGY_FIRST_PERIPHERAL; i < ENERGY_COUNT; i++) {
+        if (ms[i] > uptime) ms[i] = uptime;
+    }
+
+    const double base_ua = cfg.base_ua >= 0 ? cfg.base_ua : to.base_ua;
+    t.uptime_ms += uptime;
+    t.base_uah += base_ua * uptime / 3.6e6;
+    t.charge_uah += base_ua * uptime / 3.6e6;
+    for (int i = 0; i < ENERGY_COUNT; i++) {
+        const double ua = cfg.state_ua[i] >= 0 ? cfg.state_ua[i] : to.state_ua[i];
+        t.state_ms[i] += ms[i];
+        t.state_uah[i] += ua * ms[i] / 3.6e6;
+        t.charge_uah += ua * ms[i] / 3.6e6;
+    }
+    t.battery_uah = cfg.battery_uah >= 0 ? cfg.battery_uah : to.battery_uah;
+}
+
+void Print(const Totals &a, const Totals &b)
+{
+    std::printf("%-10s %8s %10s %10s %10s %10s\n", "state", "time %", "trace mAh", "alt time %", "alt mAh",
+                "change");
+    for (int i = 0; i < ENERGY_COUNT; i++) {
+        std::printf("%-10s %8.2f %10.3f %10.2f %10.3f %+10.3f\n", Energy_Name(EnergyState_t(i)),
+                    a.uptime_ms > 0 ? a.state_ms[i] * 100 / a.uptime_ms : 0, a.state_uah[i] / 1000,
+                    b.uptime_ms > 0 ? b.state_ms[i] * 100 / b.uptime_ms : 0, b.state_uah[i] / 1000,
+                    (b.state_uah[i] - a.state_uah[i]) / 1000);
+    }
+    std::printf("%-10s %8s %10.3f %10s %10.3f %+10.3f\n", "base", "", a.base_uah / 1000, "", b.base_uah / 1000,
+                (b.base_uah - a.base_uah) / 1000);
+    std::printf("%-10s %8s %10.3f %10s %10.3f %+10.3f\n\n", "total", "", a.charge_uah / 1000, "",
+                b.charge_uah / 1000, (b.charge_uah - a.charge_uah) / 1000);
+    std::printf("average      %8.2f mA  -> %8.2f mA\n", a.AvgUa() / 1000, b.AvgUa() / 1000);
+    std::printf("battery      %8.0f mAh -> %8.0f mAh\n", a.battery_uah / 1000, b.battery_uah / 1000);
+    std::printf("battery life %8.1f h   -> %8.1f h (%+.1f%%)\n", a.LifeH(), b.LifeH(),
+                a.LifeH() > 0 ? (b.LifeH() / a.LifeH() - 1) * 100 : 0);
+}
+
+bool ParseSetting(const char *arg, int &state, double &value)
+{
+    const char *eq = std::strchr(arg, '=');
+    if (!eq) return false;
+    state = StateByName(std::string(arg, eq));
+    char *end;
+    value = std::strtod(eq + 1, &end);
+    return state >= 0 && end != eq + 1 && *end == 0 && value >= 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Config cfg;
+    const char *path = "-";
+    const char *csv_path = nullptr;
+    double cell_mah = -1, cell_factor = 0.64;
+    bool usage = false;
+
+    for (int i = 1; i < argc && !usage; i++) {
+        int state;
+        double value;
+        if ((std::strcmp(argv[i], "-i") == 0 || std::strcmp(argv[i], "-t") == 0) && i + 1 < argc) {
+            const bool time = argv[i][1] == 't';
+            if (!ParseSetting(argv[++i], state, value) || (time && state == ENERGY_SLEEP)) {
+                std::fprintf(stderr, "bad setting %s (sleep time is what is left over)\n", argv[i]);
+                return 2;
+            }
+            (time ? cfg.time_factor : cfg.state_ua)[state] = value;
+        } else if (std::strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+            cfg.base_ua = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            cell_mah = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            cell_factor = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0) {
+            path = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage) {
+        std::fprintf(stderr, "usage: %s [-i STATE=UA]... [-t STATE=FACTOR]... [-B UA] [-b MAH] [-k FACTOR] "
+                             "[-c CSV] [FILE|-]\n", argv[0]);
+        return 2;
+    }
+    if (cell_mah >= 0) cfg.battery_uah = cell_mah * 1000 * cell_factor;
+
+    FILE *in = std::strcmp(path, "-") == 0 ? stdin : std::fopen(path, "r");
+    if (!in) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    FILE *csv = nullptr;
+    if (csv_path) {
+        csv = std::fopen(csv_path, "w");
+        if (!csv) {
+            std::fprintf(stderr, "cannot create %s\n", csv_path);
+            return 1;
+        }
+        std::fprintf(csv, "segment,uptime_s,trace_avg_ma,alt_avg_ma\n");
+    }
+
+    const Config trace_cfg;
+    Totals trace, alt;
+    Row prev = {}, row;
+    unsigned rows = 0, segments = 0;
+    char line[1024];
+
+    while (std::fgets(line, sizeof(line), in)) {
+        if (!ParseRow(line, row)) continue;
+        rows++;
+        if (segments == 0 || row.uptime_ms < prev.uptime_ms) {
+            segments++;
+            prev = {};
+        }
+        Totals a, b;
+        Replay(prev, row, trace_cfg, a);
+        Replay(prev, row, cfg, b);
+        Replay(prev, row, trace_cfg, trace);
+        Replay(prev, row, cfg, alt);
+        if (csv && a.uptime_ms > 0) {
+            std::fprintf(csv, "%u,%.3f,%.3f,%.3f\n", segments, row.uptime_ms / 1000.0, a.AvgUa() / 1000,
+                         b.AvgUa() / 1000);
+        }
+        prev = row;
+    }
+    if (in != stdin) std::fclose(in);
+    if (csv) std::fclose(csv);
+
+    if (rows == 0) {
+        std::fprintf(stderr, "no energy lines in %s\n", path);
+        return 1;
+    }
+    std::printf("%u energy lines, %u segment%s, %.1f min of uptime\n\n", rows, segments, segments == 1 ? "" : "s",
+                trace.uptime_ms / 60000);
+    Print(trace, alt);
+    return 0;
+}
@@ -0,0 +1,217 @@
+/* ========================================
+   File: fmt_bench.cpp
+   Shared Formatter Checks and Benchmarks
+
+   Checks fmt.c (identical in both node trees)
+   against snprintf on Linux: integers at the
+   edges of each width, fixed-point and rounded
+   float decimals over a random sweep, padding and
+   truncation. Then times the wrist's HR line and
+   the ankle's old plotter line both ways. Exits
+   non-zero if any check fails.
+
+   Usage: fmt_bench [-n MILLIONS]
+   ======================================== */
+
+extern "C" {
+#include "fmt.h"
+}
+
+#include "bench_check.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+
+using bench::Check;
+using bench::NsSince;
+
+template <typename Fn>
+const char *Format(char *buf, uint16_t size, Fn fn)
+{
+    Fmt_t f;
+    Fmt_Init(&f, buf, size);
+    fn(&f);
+    Fmt_End(&f);
+    return buf;
+}
+
+void Integers()
+{
+    static const int64_t signed_values[] = { 0, 1, -1, 9, -10, 12345, INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN,
+                                             int64_t(UINT32_MAX) + 1, -int64_t(UINT32_MAX) - 1 };
+    char buf[32], ref[32];
+    int bad = 0;
+
+    for (int64_t v : signed_values) {
+        std::snprintf(ref, sizeof(ref), "%" PRId64, v);
+        if (std::strcmp(Format(buf, sizeof(buf), [&](Fmt_t *f) { Fmt_I64(f, v); }), ref) != 0) bad++;
+        if (v >= INT32_MIN && v <= INT32_MAX) {
+            if (std::strcmp(Format(buf, sizeof(buf), [&](Fmt_t *f) { Fmt_I32(f, int32_t(v)); }), ref) != 0) bad++;
+        }
+    }
+    Check("signed", bad == 0, "%d mismatch(es)", bad);
+
+    bad = 0;
+    static const uint64_t unsigned_values[] = { 0, 7, 1000000000, UINT32_MAX, uint64_t(UINT32_MAX) + 1,
+                                                10000000000000000000ull, UINT64_MAX };
+    for (uint64_t v : unsigned_values) {
+        std::snprintf(ref, sizeof(ref), "%" PRIu64, v);
+        if (std::strcmp(Format(buf, sizeof(buf), [&](Fmt_t *f) { Fmt_U64(f, v); }), ref) != 0) bad++;
+        if (v <= UINT32_MAX) {
+            if (std::strcmp(Format(buf, sizeof(buf), [&](Fmt_t *f) { Fmt_U32(f, uint32_t(v)); }), ref) != 0) bad++;
+        }
+    }
+    Check("unsigned", bad == 0, "%d mismatch(es)", bad);
+
+    Format(buf, sizeof(buf), [](Fmt_t *f) { Fmt_Hex(f, 0x70, 2); Fmt_Char(f, ' '); Fmt_Hex(f, 0xDEADBEEF, 8); });
+    Check("hex", std::strcmp(buf, "70 DEADBEEF") == 0, "\"%s\"", buf);
+}
+
+void Decimals(uint64_t n)
+{
+    std::mt19937 rng(1);
+    char buf[32], ref[32];
+    uint64_t fixed_bad = 0, float_bad = 0;
+
+    for (uint64_t i = 0; i < n; i++) {
+        const int32_t v = int32_t(rng());
+        const uint8_t d = uint8_t(i % (FMT_MAX_DECIMALS + 1));
+        const int64_t scale = int64_t(std::pow(10, d));
+        const int64_t mag = std::llabs(int64_t(v));
+        if (d == 0) {
+            std::snprintf(ref, sizeof(ref), "%" PRId32, v);
+        } else {
+            std::snprintf(ref, sizeof(ref), "%s%" PRId64 ".%0*" PRId64, v < 0 ? "-" : "", mag / scale, int(d),
+                          mag % scale);
+        }
+        if (std::strcmp(Format(buf, sizeof(buf), [&](Fmt_t *f) { Fmt_Fixed(f, v, d); }), ref) != 0) fixed_bad++;
+
+        /* Sensor-sized floats; printf rounds the exact binary value, Fmt_Float the
+           scaled float, so allow one unit in the last place */
+        const float x = float(int32_t(rng() % 2000000) - 1000000) / 997.0f;
+        Format(buf, sizeof(buf), [&](Fmt_t *f) { Fmt_Float(f, x, 2); });
+        if (std::fabs(std::strtod(buf, nullptr) - double(x)) > 0.0051) float_bad++;
+    }
+    Check("fixed", fixed_bad == 0, "%llu of %llu mismatch", (unsigned long long)fixed_bad, (unsigned long long)n);
+    Check("float 2 places", float_bad == 0, "%llu of %llu off by more than 0.01", (unsigned long long)float_bad,
+          (unsigned long long)n);
+
+    Format(buf, sizeof(buf), [](Fmt_t *f) { Fmt_Float(f, -0.004f, 2); Fmt_Char(f, ' '); Fmt_Float(f, 36.875f, 2); });
+    Check("float rounding", std::strcmp(buf, "0.00 36.88") == 0, "\"%s\"", buf);
+    Format(buf, sizeof(buf), [](Fmt_t *f) { Fmt_Float(f, NAN, 1); Fmt_Char(f, ' '); Fmt_Float(f, 1e12f, 2); });
+    Check("float nan/overflow", std::strcmp(buf, "nan ovf") == 0, "\"%s\"", buf);
+}
+
+void Layout()
+{
+    char buf[32];
+
+    Format(buf, sizeof(buf), [](Fmt_t *f) {
+        Fmt_Str(f, "ab");
+        Fmt_Left(f, 0, 6);
+        uint16_t at = f->len;
+        Fmt_U32(f, 42);
+        Fmt_Right(f, at, 5);
+        Fmt_Char(f, '|');
+    });
+    Check("padding", std::strcmp(buf, "ab       42|") == 0, "\"%s\"", buf);
+
+    char small[8];
+    Fmt_t f;
+    Fmt_Init(&f, small, sizeof(small));
+    Fmt_Str(&f, "123456789");
+    const uint16_t len = Fmt_End(&f);
+    Check("truncation", len == 7 && f.truncated && std::strcmp(small, "1234567") == 0, "\"%s\", flag %u", small,
+          f.truncated);
+}
+
+void Bench(uint64_t n)
+{
+    char buf[96];
+    volatile uint32_t sink = 0;
+    int32_t hr = 72, spo2 = 97;
+    uint32_t ir = 51234, red = 40321;
+    float temp = 31.4f;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        sink += uint32_t(std::snprintf(buf, sizeof(buf), "HR: %" PRId32 " bpm, SpO2: %" PRId32 "%%, IR: %" PRIu32
+                                       ", Red: %" PRIu32 ", Die: %.2f C\r\n", hr, spo2, ir + uint32_t(i & 63), red,
+                                       double(temp)));
+    }
+    const double printf_ns = NsSince(t0, n);
+
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        Fmt_t f;
+        Fmt_Init(&f, buf, sizeof(buf));
+        Fmt_Str(&f, "HR: ");
+        Fmt_I32(&f, hr);
+        Fmt_Str(&f, " bpm, SpO2: ");
+        Fmt_I32(&f, spo2);
+        Fmt_Str(&f, "%, IR: ");
+        Fmt_U32(&f, ir + uint32_t(i & 63));
+        Fmt_Str(&f, ", Red: ");
+        Fmt_U32(&f, red);
+        Fmt_Str(&f, ", Die: ");
+        Fmt_Float(&f, temp, 2);
+        Fmt_Str(&f, " C\r\n");
+        sink += Fmt_End(&f);
+    }
+    const double fmt_ns = NsSince(t0, n);
+    std::printf("HR line          snprintf %6.1f ns, fmt %6.1f ns (%.1fx)\n", printf_ns, fmt_ns, printf_ns / fmt_ns);
+
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        sink += uint32_t(std::snprintf(buf, sizeof(buf), "Diff:%.2f,Thresh%.2f:.0\r\n", double(i & 1023) / 32.75,
+                                       175.0));
+    }
+    const double plot_printf_ns = NsSince(t0, n);
+
+    t0 = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n; i++) {
+        Fmt_t f;
+        Fmt_Init(&f, buf, sizeof(buf));
+        Fmt_Str(&f, "Diff:");
+        Fmt_Fixed(&f, int32_t((i & 1023) * 100 * 100 / 3275), 2);
+        Fmt_Str(&f, ",Thresh");
+        Fmt_Fixed(&f, 17500, 2);
+        Fmt_Str(&f, ":.0\r\n");
+        sink += Fmt_End(&f);
+    }
+    const double plot_fmt_ns = NsSince(t0, n);
+    std::printf("plotter line     snprintf %6.1f ns, fmt %6.1f ns (%.1fx)\n", plot_printf_ns, plot_fmt_ns,
+                plot_printf_ns / plot_fmt_ns);
+    (void)sink;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint64_t n = 2000000;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            n = uint64_t(std::strtod(argv[++i], nullptr) * 1e6);
+        } else {
+            std::fprintf(stderr, "usage: %s [-n MILLIONS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Integers();
+    Decimals(n);
+    Layout();
+    std::printf("\n");
+    Bench(n);
+
+    return bench::Summary("check(s)");
+}
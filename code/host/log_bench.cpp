@@ -0,0 +1,277 @@
+/* ========================================
+   File: log_bench.cpp
+   Wrist Logging Benchmark on a Disk Image
+
+   Runs the wrist logging path (log_writer.c,
+   sd_logger.c, FatFs and the CubeMX USER_Driver
+   glue) on Linux against a file-backed card,
+   feeding it a synthetic walk/rest day through a
+   simulated nRF24 FIFO. Reports host throughput
+   and what the card would have been asked to do,
+   then the firmware's own profile probes (prof.h,
+   nanoseconds on the host) for the run. Exits
+   non-zero if packing made either stream bigger
+   than its raw records.
+
+   Usage: log_bench [-i IMAGE] [-s MB] [-t HOURS] [-f] [-k]
+     -f  force the FatFs append path instead of the raw contiguous log
+     -k  keep an existing image (tests resume; starts a new session)
+   ======================================== */
+
+#include "image_disk.h"
+#include "sim_radio.h"
+#include "bench_check.h"
+
+extern "C" {
+#include "log_writer.h"
+#include "log_record.h"
+#include "ff_gen_drv.h"
+#include "prof.h"
+}
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+extern "C" {
+extern Diskio_drvTypeDef USER_Driver;
+volatile uint32_t sim_tick = 0;
+}
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kLoopMs = 10;        /* HAL_Delay in the wrist superloop */
+constexpr uint32_t kHrEveryMs = 1000;   /* Roughly one estimate per beat window */
+
+/* Ankle side: walking bouts with rests, five steps per packet */
+class Ankle {
+public:
+    /* Returns true when a packet leaves the ankle at this tick */
+    bool Tick(uint32_t now, sentData_t &out)
+    {
+        const uint32_t cycle = now % (15 * 60000);
+        const bool walking = cycle < 10 * 60000;
+
+        if (walking && now >= next_step_) {
+            const uint16_t period = uint16_t(520 + 40 * std::sin(now / 60000.0) + std::rand() % 30);
+            if (fill_ == 0) batch_.step_initial_count = uint16_t(step_ + 1);
+            batch_.steps[fill_].period = last_ ? uint16_t(now - last_) : period;
+            batch_.steps[fill_].intensity = uint16_t(300 + std::rand() % 120);
+            fill_++;
+            step_++;
+            last_ = now;
+            next_step_ = now + period;
+        }
+
+        /* Full batch now, partial one after the ankle's flush timeout */
+        if (fill_ == 5 || (fill_ > 0 && now - last_ >= 2500)) {
+            batch_.temp = 31.0f + 0.5f * std::sin(now / 3600000.0);
+            for (int i = fill_; i < 5; i++) batch_.steps[i] = {0, 0};
+            out = batch_;
+            fill_ = 0;
+            if (!walking) last_ = 0;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    sentData_t batch_{};
+    uint8_t fill_ = 0;
+    uint32_t step_ = 0;
+    uint32_t last_ = 0;
+    uint32_t next_step_ = 0;
+};
+
+struct SyncCost {
+    uint64_t count = 0;
+    uint64_t sectors = 0;
+    uint64_t max_sectors = 0;
+    double seconds = 0;
+    double max_seconds = 0;
+};
+
+bool Format(const char *path)
+{
+    static BYTE work[_MAX_SS * 4];
+    FRESULT res = f_mkfs(path, FM_ANY, 0, work, sizeof(work));
+    if (res != FR_OK) std::fprintf(stderr, "f_mkfs failed: %d\n", res);
+    return res == FR_OK;
+}
+
+/* FAT, directory and data regions, so writes can be told apart */
+void ReportLayout(const FATFS &fs)
+{
+    DWORD dir = fs.dirbase, dir_len = fs.n_rootdir * 32 / _MAX_SS;
+    if (fs.fs_type == FS_FAT32) {
+        dir = fs.database + (fs.dirbase - 2) * fs.csize;
+        dir_len = fs.csize;
+    }
+    ImageDisk_SetLayout(fs.fatbase, fs.database, dir, dir_len);
+}
+
+/* A short file that is not the pre-allocated size keeps the logger on FatFs */
+bool ForceFatFsPath()
+{
+    FIL fil;
+    UINT bw;
+    static const BYTE zero[_MAX_SS] = {0};
+    if (f_open(&fil, LOG_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK) return false;
+    bool ok = f_write(&fil, zero, sizeof(zero), &bw) == FR_OK && bw == sizeof(zero);
+    return f_close(&fil) == FR_OK && ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string image = "wlog_bench.img";
+    uint32_t size_mb = 256;
+    double hours = 2.0;
+    bool force_fatfs = false, keep = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            image = argv[++i];
+        } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            size_mb = uint32_t(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            hours = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "-f") == 0) {
+            force_fatfs = true;
+        } else if (std::strcmp(argv[i], "-k") == 0) {
+            keep = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [-i IMAGE] [-s MB] [-t HOURS] [-f] [-k]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (ImageDisk_Open(image.c_str(), size_mb * 2048u, !keep) != 0) {
+        std::fprintf(stderr, "cannot open image %s\n", image.c_str());
+        return 1;
+    }
+
+    static char path[4];
+    static FATFS fs;
+    FATFS_LinkDriver(&USER_Driver, path);
+    if (!keep && !Format(path)) return 1;
+    if (f_mount(&fs, path, 1) != FR_OK) {
+        std::fprintf(stderr, "mount failed\n");
+        return 1;
+    }
+    ReportLayout(fs);
+    if (force_fatfs && !keep && !ForceFatFsPath()) {
+        std::fprintf(stderr, "cannot create %s\n", LOG_FILE_NAME);
+        return 1;
+    }
+
+    LogWriter_Init();
+    const auto open_start = Clock::now();
+    if (LogWriter_Open(0) != 0) {
+        std::fprintf(stderr, "log open failed\n");
+        return 1;
+    }
+    const double open_s = std::chrono::duration<double>(Clock::now() - open_start).count();
+    const ImageDiskStats_t open_disk = *ImageDisk_GetStats();
+    Prof_Init();
+
+    Ankle ankle;
+    SyncCost sync;
+    uint32_t radio_lost = 0;
+    double task_s = 0;
+    const uint32_t end = uint32_t(hours * 3600000.0);
+    const auto run_start = Clock::now();
+
+    for (sim_tick = 0; sim_tick < end; sim_tick += kLoopMs) {
+        sentData_t packet;
+        if (ankle.Tick(sim_tick, packet) && SimRadio_Push(&packet) != 0) radio_lost++;
+        if (sim_tick % kHrEveryMs == 0) LogWriter_HeartRate(70 + int32_t(sim_tick / 7000 % 15), sim_tick);
+
+        /* Same order as the wrist superloop */
+        Logger_PollRadio();
+        LogPacket_t p;
+        while (LogWriter_Ready() && Logger_GetPacket(&p) == 0) {
+            LogWriter_Packet(&p, 50000 + std::rand() % 500, 40000 + std::rand() % 500, 72, 97,
+                             LOG_FLAG_HR_VALID | LOG_FLAG_SPO2_VALID);
+        }
+
+        const uint32_t commits = Logger_GetStats()->commits;
+        const uint64_t written = ImageDisk_GetStats()->sectors_written;
+        const auto t0 = Clock::now();
+        LogWriter_Task();
+        const double took = std::chrono::duration<double>(Clock::now() - t0).count();
+        task_s += took;
+
+        if (Logger_GetStats()->commits != commits) {
+            const uint64_t n = ImageDisk_GetStats()->sectors_written - written;
+            sync.count++;
+            sync.sectors += n;
+            sync.seconds += took;
+            if (n > sync.max_sectors) sync.max_sectors = n;
+            if (took > sync.max_seconds) sync.max_seconds = took;
+        }
+    }
+
+    const double run_s = std::chrono::duration<double>(Clock::now() - run_start).count();
+    const LogStats_t *ls = Logger_GetStats();
+    const LogWriterStats_t *ws = LogWriter_GetStats();
+    const ImageDiskStats_t *ds = ImageDisk_GetStats();
+    const uint64_t vitals = ws->vitals_raw_bytes / sizeof(LogVitalsRecord_t);
+    const uint64_t records = ws->steps + vitals + ws->rollups;
+    const uint64_t run_sectors = ds->sectors_written - open_disk.sectors_written;
+
+    std::printf("mode            %s, session %u, image %s (%u MB)\n",
+                Logger_IsRaw(LOG_STREAM_RECORDS) ? "raw contiguous" : "FatFs append",
+                Logger_Session(LOG_STREAM_RECORDS), image.c_str(), size_mb);
+    std::printf("open            %.3f ms, %llu sectors read, %llu written, %llu trimmed\n", open_s * 1e3,
+                (unsigned long long)open_disk.sectors_read, (unsigned long long)open_disk.sectors_written,
+                (unsigned long long)open_disk.trimmed_sectors);
+    std::printf("simulated       %.2f h in %.3f s host (%.0fx real time)\n", hours, run_s, hours * 3600 / run_s);
+    std::printf("records         %llu (%u steps, %llu vitals, %u minutes), %.0f records/s host, %.0f/s in logger\n",
+                (unsigned long long)records, ws->steps, (unsigned long long)vitals, ws->rollups,
+                records / run_s, records / task_s);
+    std::printf("packing         steps %u -> %u bytes, vitals %u -> %u bytes\n", ws->step_raw_bytes,
+                ws->step_packed_bytes, ws->vitals_raw_bytes, ws->vitals_packed_bytes);
+    std::printf("sectors         %llu written (%.1f bytes/record), %llu logger, %llu FAT, %llu directory\n",
+                (unsigned long long)run_sectors, records ? run_sectors * 512.0 / records : 0.0,
+                (unsigned long long)(ls->sectors_written + ls->commits),
+                (unsigned long long)(ds->fat_writes - open_disk.fat_writes),
+                (unsigned long long)(ds->meta_writes - open_disk.meta_writes));
+    std::printf("card commands   %llu write commands, %llu stream stops, %llu reads, %llu CTRL_SYNC\n",
+                (unsigned long long)(ds->write_calls - open_disk.write_calls),
+                (unsigned long long)(ds->stream_stops - open_disk.stream_stops),
+                (unsigned long long)(ds->read_calls - open_disk.read_calls),
+                (unsigned long long)(ds->ioctl_syncs - open_disk.ioctl_syncs));
+    std::printf("syncs           %llu, %.2f sectors avg, %llu max, %.1f us avg, %.1f us max host\n",
+                (unsigned long long)sync.count, sync.count ? double(sync.sectors) / sync.count : 0.0,
+                (unsigned long long)sync.max_sectors, sync.count ? sync.seconds / sync.count * 1e6 : 0.0,
+                sync.max_seconds * 1e6);
+    std::printf("losses          %u radio FIFO, %lu RX ring, %lu deferred, %lu write errors, %lu sectors dropped\n",
+                radio_lost, (unsigned long)ls->packets_dropped, (unsigned long)ls->records_deferred,
+                (unsigned long)ls->write_errors, (unsigned long)ls->sectors_dropped);
+
+    char line[128];
+    std::printf("\n");
+    Prof_FormatHeader(line, sizeof(line));
+    std::fputs(line, stdout);
+    for (int i = 0; i < PROF_COUNT; i++) {
+        Prof_FormatLine(ProfProbe_t(i), line, sizeof(line));
+        std::fputs(line, stdout);
+    }
+
+    std::printf("\n");
+    bench::Check("steps packed", ws->step_packed_bytes <= ws->step_raw_bytes, "%u -> %u bytes",
+                 ws->step_raw_bytes, ws->step_packed_bytes);
+    bench::Check("vitals packed", ws->vitals_packed_bytes <= ws->vitals_raw_bytes, "%u -> %u bytes",
+                 ws->vitals_raw_bytes, ws->vitals_packed_bytes);
+
+    f_mount(nullptr, path, 0);
+    ImageDisk_Close();
+    return bench::Summary("check(s)");
+}
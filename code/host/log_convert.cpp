@@ -0,0 +1,558 @@
+/* ========================================
+   File: log_convert.cpp
+   Wrist Binary Log -> CSV / Columnar Converter
+
+   Reads a wlog_s*.bin file from the SD card and
+   writes one CSV per record type, or raw column
+   arrays (one little-endian file per field, ready
+   for numpy.fromfile) with -c. The journal is
+   read up to the first sector that does not belong
+   to it; torn entries and sequence gaps are
+   reported, not fatal. Packed step and vitals
+   blocks are expanded with log_unpack.h. SD
+   health snapshots always go to a CSV, with one
+   column per latency histogram bin.
+
+   With -t SESSION:MINUTE only the rollup of that
+   minute is printed; the sector headers are binary
+   searched, so only a handful of sectors is read.
+
+   Usage: log_convert [-c] [-o PREFIX] LOGFILE
+          log_convert -t SESSION:MINUTE LOGFILE
+   ======================================== */
+
+#include "log_journal.h"
+#include "log_record.h"
+#include "log_rollup.h"
+#include "log_unpack.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct StepRow {
+    uint32_t session;
+    uint32_t step_number;
+    uint32_t time_ms;
+    uint16_t period;
+    uint16_t intensity;
+    uint8_t heart_rate;
+    int16_t temp_centi;
+};
+
+struct RollupRow {
+    uint32_t session;
+    uint32_t minute;
+    uint16_t steps;
+    uint16_t period_mean;
+    uint32_t period_var;
+    uint8_t hr_min;
+    uint8_t hr_mean;
+    uint8_t hr_max;
+    int16_t temp_centi;
+    uint8_t temp_valid;
+};
+
+struct VitalsRow {
+    uint32_t session;
+    uint32_t time_ms;
+    uint8_t heart_rate;
+    uint8_t spo2;
+    uint8_t flags;
+    uint32_t ir;
+    uint32_t red;
+};
+
+struct SdHealthRow {
+    uint32_t session;
+    LogSdHealthRecord_t r;
+};
+
+/* Text output buffered in memory and written in one go */
+class CsvWriter {
+public:
+    void Field(uint32_t v) { Sep(); Append(v); }
+    void Field(int32_t v) { Sep(); Append(v); }
+
+    /* Fixed-point value with two decimals, e.g. 3107 -> 31.07 */
+    void Centi(int32_t v)
+    {
+        Sep();
+        if (v < 0) { buf_ += '-'; v = -v; }
+        Append(v / 100);
+        buf_ += '.';
+        buf_ += char('0' + (v / 10) % 10);
+        buf_ += char('0' + v % 10);
+    }
+
+    void Text(const char *s) { Sep(); buf_ += s; }
+    void End() { buf_ += '\n'; first_ = true; }
+    void Print() const { std::fwrite(buf_.data(), 1, buf_.size(), stdout); }
+
+    bool Save(const std::string &path) const
+    {
+        FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        bool ok = std::fwrite(buf_.data(), 1, buf_.size(), f) == buf_.size();
+        return std::fclose(f) == 0 && ok;
+    }
+
+private:
+    template <typename T> void Append(T v)
+    {
+        char tmp[16];
+        auto res = std::to_chars(tmp, tmp + sizeof(tmp), v);
+        buf_.append(tmp, res.ptr);
+    }
+
+    void Sep()
+    {
+        if (!first_) buf_ += ',';
+        first_ = false;
+    }
+
+    std::string buf_;
+    bool first_ = true;
+};
+
+template <typename Row, typename T>
+bool WriteColumn(const std::string &path, const std::vector<Row> &rows, T Row::*field)
+{
+    std::vector<T> col;
+    col.reserve(rows.size());
+    for (const Row &r : rows) col.push_back(r.*field);
+
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(col.data(), sizeof(T), col.size(), f) == col.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+bool ReadFile(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *f = std::fopen(path, "rb");
+    if (!f) return false;
+    std::fseek(f, 0, SEEK_END);
+    long size = std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+    data.resize(size > 0 ? size_t(size) : 0);
+    bool ok = std::fread(data.data(), 1, data.size(), f) == data.size();
+    std::fclose(f);
+    return ok;
+}
+
+bool CheckHeader(const std::vector<uint8_t> &data)
+{
+    if (data.size() < sizeof(LogFileHeader_t)) {
+        std::fprintf(stderr, "file too short for a header\n");
+        return false;
+    }
+
+    LogFileHeader_t hdr;
+    std::memcpy(&hdr, data.data(), sizeof(hdr));
+    if (std::memcmp(hdr.magic, LOG_MAGIC, sizeof(hdr.magic)) != 0) {
+        std::fprintf(stderr, "not a wrist log (bad magic)\n");
+        return false;
+    }
+    if (hdr.version != LOG_VERSION || hdr.schema_id != LOG_SCHEMA_ID ||
+        hdr.header_size != LOG_HEADER_SIZE || hdr.sector_size != JOURNAL_SECTOR_SIZE) {
+        std::fprintf(stderr, "unsupported log: version %u schema %u header %u sector %u\n",
+                     hdr.version, hdr.schema_id, hdr.header_size, hdr.sector_size);
+        return false;
+    }
+    if (hdr.tick_hz != 1000) {
+        std::fprintf(stderr, "warning: tick rate %u Hz, time columns are in ticks\n", hdr.tick_hz);
+    }
+    return true;
+}
+
+void SdHealthHeader(CsvWriter &w)
+{
+    static const char *const bins[LOG_SD_HIST_BINS] = {
+        "Lt1", "1", "2", "4", "8", "16", "32", "64", "128", "256", "512", "1024"
+    };
+    w.Text("Session"); w.Text("TimeMs");
+    for (const char *prefix : {"Single", "Multi"}) {
+        for (const char *bin : bins) {
+            std::string name = std::string(prefix) + bin + "ms";
+            w.Text(name.c_str());
+        }
+    }
+    w.Text("BusyMs"); w.Text("BusyMaxMs"); w.Text("BusyWaits"); w.Text("BusyTimeouts");
+    w.Text("TokenTimeouts"); w.Text("Rejects"); w.Text("Retries"); w.Text("Failures");
+    w.Text("WorstMs"); w.Text("WorstAtMs");
+    w.End();
+}
+
+void SdHealthLine(CsvWriter &w, const SdHealthRow &row)
+{
+    const LogSdHealthRecord_t &r = row.r;
+    w.Field(row.session); w.Field(r.time_ms);
+    for (uint32_t v : r.single_ms) w.Field(v);
+    for (uint32_t v : r.multi_ms) w.Field(v);
+    w.Field(r.busy_ms); w.Field(r.busy_max_ms); w.Field(r.busy_waits); w.Field(r.busy_timeouts);
+    w.Field(r.token_timeouts); w.Field(r.rejects); w.Field(r.retries); w.Field(r.failures);
+    w.Field(r.worst_ms); w.Field(r.worst_ms_at);
+    w.End();
+}
+
+RollupRow ToRow(uint32_t session, const LogRollupRecord_t &r)
+{
+    return {session, r.minute, r.steps, r.period_mean, r.period_var,
+            r.hr_min, r.hr_mean, r.hr_max, r.temp_centi, r.temp_valid};
+}
+
+void RollupHeader(CsvWriter &w)
+{
+    w.Text("Session"); w.Text("Minute"); w.Text("Steps"); w.Text("PeriodMean"); w.Text("PeriodVar");
+    w.Text("HRMin"); w.Text("HRMean"); w.Text("HRMax"); w.Text("Temperature");
+    w.End();
+}
+
+void RollupLine(CsvWriter &w, const RollupRow &r)
+{
+    w.Field(r.session); w.Field(r.minute); w.Field(uint32_t(r.steps));
+    w.Field(uint32_t(r.period_mean)); w.Field(r.period_var);
+    w.Field(uint32_t(r.hr_min)); w.Field(uint32_t(r.hr_mean)); w.Field(uint32_t(r.hr_max));
+    if (r.temp_valid) w.Centi(r.temp_centi); else w.Text("");
+    w.End();
+}
+
+/* Sector-at-a-time access for seeking without loading the whole log */
+class SectorFile {
+public:
+    explicit SectorFile(const char *path) : f_(std::fopen(path, "rb"))
+    {
+        if (!f_) return;
+        std::fseek(f_, 0, SEEK_END);
+        count_ = uint32_t(std::ftell(f_) / JOURNAL_SECTOR_SIZE);
+    }
+    ~SectorFile() { if (f_) std::fclose(f_); }
+    SectorFile(const SectorFile &) = delete;
+    SectorFile &operator=(const SectorFile &) = delete;
+
+    bool Ok() const { return f_ != nullptr; }
+    uint32_t Count() const { return count_; }
+    uint32_t Reads() const { return reads_; }
+
+    const uint8_t *Read(uint32_t index)
+    {
+        reads_++;
+        if (std::fseek(f_, long(index) * JOURNAL_SECTOR_SIZE, SEEK_SET) != 0 ||
+            std::fread(buf_, 1, sizeof(buf_), f_) != sizeof(buf_)) {
+            return nullptr;
+        }
+        return buf_;
+    }
+
+private:
+    FILE *f_;
+    uint32_t count_ = 0;
+    uint32_t reads_ = 0;
+    uint8_t buf_[JOURNAL_SECTOR_SIZE];
+};
+
+/* Journal sectors are ordered by (session, start tick); invalid ones sort last */
+bool SectorBefore(SectorFile &file, uint32_t index, uint32_t session, uint32_t time_ms)
+{
+    const uint8_t *sector = file.Read(index);
+    if (!sector || !Journal_SectorValid(sector, index)) return false;
+
+    JournalSectorHeader_t hdr;
+    std::memcpy(&hdr, sector, sizeof(hdr));
+    return hdr.session < session || (hdr.session == session && hdr.first_ms <= time_ms);
+}
+
+int QueryMinute(const char *path, uint32_t session, uint32_t minute)
+{
+    SectorFile file(path);
+    if (!file.Ok()) {
+        std::fprintf(stderr, "cannot read %s\n", path);
+        return 1;
+    }
+    std::vector<uint8_t> head(JOURNAL_SECTOR_SIZE);
+    const uint8_t *sector = file.Read(0);
+    if (sector) std::memcpy(head.data(), sector, head.size());
+    if (!sector || !CheckHeader(head)) return 1;
+
+    /* Last sector started at or before the minute; its rollup comes after that */
+    uint32_t lo = 1, hi = file.Count();
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (SectorBefore(file, mid, session, minute * uint32_t(LOG_ROLLUP_MINUTE_MS))) lo = mid + 1; else hi = mid;
+    }
+
+    for (uint32_t i = (lo > 1 ? lo - 1 : 1); i < file.Count(); i++) {
+        sector = file.Read(i);
+        if (!sector || !Journal_SectorValid(sector, i)) break;
+
+        JournalSectorHeader_t hdr;
+        std::memcpy(&hdr, sector, sizeof(hdr));
+        if (hdr.session > session) break;
+
+        uint32_t seq = hdr.first_seq;
+        uint16_t off = JOURNAL_SECTOR_HEADER;
+        JournalEntry_t e;
+        while (true) {
+            uint16_t next = Journal_NextEntry(sector, off, seq++, &e);
+            if (next == JOURNAL_END || next == JOURNAL_CORRUPT) break;
+            off = next;
+            if (hdr.session != session || e.type != LOG_REC_ROLLUP || e.len < sizeof(LogRollupRecord_t)) continue;
+
+            LogRollupRecord_t r;
+            std::memcpy(&r, e.payload, sizeof(r));
+            if (r.minute > minute) break;
+            if (r.minute == minute) {
+                CsvWriter w;
+                RollupHeader(w);
+                RollupLine(w, ToRow(session, r));
+                w.Print();
+                std::fprintf(stderr, "%u of %u sectors read\n", file.Reads(), file.Count());
+                return 0;
+            }
+        }
+    }
+
+    std::fprintf(stderr, "no rollup for session %u minute %u (%u sectors read)\n", session, minute, file.Reads());
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool columnar = false;
+    std::string prefix;
+    const char *input = nullptr;
+    bool query = false;
+    unsigned query_session = 0, query_minute = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-c") == 0) {
+            columnar = true;
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc &&
+                   std::sscanf(argv[i + 1], "%u:%u", &query_session, &query_minute) == 2) {
+            query = true;
+            i++;
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            prefix = argv[++i];
+        } else if (argv[i][0] != '-' && !input) {
+            input = argv[i];
+        } else {
+            input = nullptr;
+            break;
+        }
+    }
+    if (!input) {
+        std::fprintf(stderr, "usage: %s [-c] [-o PREFIX] LOGFILE\n"
+                             "       %s -t SESSION:MINUTE LOGFILE\n", argv[0], argv[0]);
+        return 2;
+    }
+    if (query) return QueryMinute(input, query_session, query_minute);
+    if (prefix.empty()) {
+        prefix = input;
+        size_t dot = prefix.rfind('.');
+        if (dot != std::string::npos && prefix.find('/', dot) == std::string::npos) prefix.resize(dot);
+    }
+
+    std::vector<uint8_t> data;
+    if (!ReadFile(input, data)) {
+        std::fprintf(stderr, "cannot read %s\n", input);
+        return 1;
+    }
+    if (!CheckHeader(data)) return 1;
+
+    std::vector<StepRow> steps;
+    std::vector<VitalsRow> vitals;
+    std::vector<RollupRow> rollups;
+    std::vector<SdHealthRow> health;
+    uint32_t session = 0, boots = 0;
+    size_t entries = 0, unknown = 0, torn = 0, gaps = 0, commits = 0, uncommitted = 0;
+    size_t packed_bytes = 0, packed_records = 0, bad_blocks = 0;
+
+    const LogPackSchema_t step_schema = { LOG_STEP_FIELDS, LOG_STEP_ORDER, LOG_STEP_K0, LOG_STEP_K1 };
+    const LogPackSchema_t vitals_schema = { LOG_VITALS_FIELDS, LOG_VITALS_ORDER, LOG_VITALS_K0, LOG_VITALS_K1 };
+    std::vector<logfmt::PackedRecord> block;
+
+    /* Pre-allocated logs end at the first erased sector */
+    size_t sectors = data.size() / JOURNAL_SECTOR_SIZE;
+    size_t used = 1;
+    uint32_t seq = 0;
+    for (; used < sectors; used++) {
+        const uint8_t *sector = &data[used * JOURNAL_SECTOR_SIZE];
+        if (!Journal_SectorValid(sector, uint32_t(used))) break;
+
+        JournalSectorHeader_t hdr;
+        std::memcpy(&hdr, sector, sizeof(hdr));
+        if (hdr.first_seq != seq) gaps++; /* Entries lost to a torn tail before a reboot */
+        seq = hdr.first_seq;
+        session = hdr.session;
+
+        uint16_t off = JOURNAL_SECTOR_HEADER;
+        JournalEntry_t e;
+        while (true) {
+            uint16_t next = Journal_NextEntry(sector, off, seq, &e);
+            if (next == JOURNAL_END) break;
+            if (next == JOURNAL_CORRUPT) {
+                torn++;
+                break;
+            }
+            off = next;
+            seq++;
+            entries++;
+            uncommitted++;
+
+            switch (e.type) {
+            case LOG_REC_BOOT:
+                boots++;
+                break;
+            case LOG_REC_STEP: {
+                LogStepRecord_t r;
+                if (e.len < sizeof(r)) { unknown++; break; }
+                std::memcpy(&r, e.payload, sizeof(r));
+                steps.push_back({session, r.step_number, r.time_ms, r.period,
+                                 r.intensity, r.heart_rate, r.temp_centi});
+                break;
+            }
+            case LOG_REC_VITALS: {
+                LogVitalsRecord_t r;
+                if (e.len < sizeof(r)) { unknown++; break; }
+                std::memcpy(&r, e.payload, sizeof(r));
+                vitals.push_back({session, r.time_ms, r.heart_rate, r.spo2, r.flags, r.ir, r.red});
+                break;
+            }
+            case LOG_REC_STEP_PACK:
+                block.clear();
+                if (!logfmt::Unpack(step_schema, e.payload, e.len, block)) bad_blocks++;
+                for (const logfmt::PackedRecord &r : block) {
+                    steps.push_back({session, r[0], r[1], uint16_t(r[2]), uint16_t(r[3]),
+                                     uint8_t(r[5]), int16_t(r[4])});
+                }
+                packed_bytes += e.len;
+                packed_records += block.size();
+                break;
+            case LOG_REC_VITALS_PACK:
+                block.clear();
+                if (!logfmt::Unpack(vitals_schema, e.payload, e.len, block)) bad_blocks++;
+                for (const logfmt::PackedRecord &r : block) {
+                    vitals.push_back({session, r[0], uint8_t(r[3]), uint8_t(r[4]), uint8_t(r[5]), r[1], r[2]});
+                }
+                packed_bytes += e.len;
+                packed_records += block.size();
+                break;
+            case LOG_REC_ROLLUP: {
+                LogRollupRecord_t r;
+                if (e.len < sizeof(r)) { unknown++; break; }
+                std::memcpy(&r, e.payload, sizeof(r));
+                rollups.push_back(ToRow(session, r));
+                break;
+            }
+            case LOG_REC_SD_HEALTH: {
+                SdHealthRow row;
+                if (e.len < sizeof(row.r)) { unknown++; break; }
+                row.session = session;
+                std::memcpy(&row.r, e.payload, sizeof(row.r));
+                health.push_back(row);
+                break;
+            }
+            case LOG_REC_COMMIT:
+                commits++;
+                uncommitted = 0;
+                break;
+            default:
+                unknown++;
+                break;
+            }
+        }
+    }
+
+    bool ok = true;
+    if (columnar) {
+        const std::string s = prefix + "_steps.";
+        ok &= WriteColumn(s + "session.u32", steps, &StepRow::session);
+        ok &= WriteColumn(s + "step.u32", steps, &StepRow::step_number);
+        ok &= WriteColumn(s + "time_ms.u32", steps, &StepRow::time_ms);
+        ok &= WriteColumn(s + "period.u16", steps, &StepRow::period);
+        ok &= WriteColumn(s + "intensity.u16", steps, &StepRow::intensity);
+        ok &= WriteColumn(s + "bpm.u8", steps, &StepRow::heart_rate);
+        ok &= WriteColumn(s + "temp_centi.i16", steps, &StepRow::temp_centi);
+
+        const std::string v = prefix + "_vitals.";
+        ok &= WriteColumn(v + "session.u32", vitals, &VitalsRow::session);
+        ok &= WriteColumn(v + "time_ms.u32", vitals, &VitalsRow::time_ms);
+        ok &= WriteColumn(v + "hr.u8", vitals, &VitalsRow::heart_rate);
+        ok &= WriteColumn(v + "spo2.u8", vitals, &VitalsRow::spo2);
+        ok &= WriteColumn(v + "flags.u8", vitals, &VitalsRow::flags);
+        ok &= WriteColumn(v + "ir.u32", vitals, &VitalsRow::ir);
+        ok &= WriteColumn(v + "red.u32", vitals, &VitalsRow::red);
+
+        const std::string m = prefix + "_rollup.";
+        ok &= WriteColumn(m + "session.u32", rollups, &RollupRow::session);
+        ok &= WriteColumn(m + "minute.u32", rollups, &RollupRow::minute);
+        ok &= WriteColumn(m + "steps.u16", rollups, &RollupRow::steps);
+        ok &= WriteColumn(m + "period_mean.u16", rollups, &RollupRow::period_mean);
+        ok &= WriteColumn(m + "period_var.u32", rollups, &RollupRow::period_var);
+        ok &= WriteColumn(m + "hr_min.u8", rollups, &RollupRow::hr_min);
+        ok &= WriteColumn(m + "hr_mean.u8", rollups, &RollupRow::hr_mean);
+        ok &= WriteColumn(m + "hr_max.u8", rollups, &RollupRow::hr_max);
+        ok &= WriteColumn(m + "temp_centi.i16", rollups, &RollupRow::temp_centi);
+        ok &= WriteColumn(m + "temp_valid.u8", rollups, &RollupRow::temp_valid);
+    } else {
+        /* Column names match the old step_hr.csv, so plot_csv.py still works */
+        CsvWriter sc;
+        sc.Text("Session"); sc.Text("Step"); sc.Text("TimeMs"); sc.Text("Period");
+        sc.Text("Intensity"); sc.Text("AvgBPM"); sc.Text("HRValid"); sc.Text("Temperature");
+        sc.End();
+        for (const StepRow &r : steps) {
+            sc.Field(r.session); sc.Field(r.step_number); sc.Field(r.time_ms);
+            sc.Field(uint32_t(r.period)); sc.Field(uint32_t(r.intensity));
+            sc.Field(uint32_t(r.heart_rate)); sc.Field(uint32_t(r.heart_rate != 0));
+            sc.Centi(r.temp_centi);
+            sc.End();
+        }
+        ok &= sc.Save(prefix + "_steps.csv");
+
+        CsvWriter vc;
+        vc.Text("Session"); vc.Text("TimeMs"); vc.Text("HR"); vc.Text("HRValid");
+        vc.Text("SpO2"); vc.Text("SpO2Valid"); vc.Text("IR"); vc.Text("Red");
+        vc.End();
+        for (const VitalsRow &r : vitals) {
+            vc.Field(r.session); vc.Field(r.time_ms);
+            vc.Field(uint32_t(r.heart_rate)); vc.Field(uint32_t((r.flags & LOG_FLAG_HR_VALID) != 0));
+            vc.Field(uint32_t(r.spo2)); vc.Field(uint32_t((r.flags & LOG_FLAG_SPO2_VALID) != 0));
+            vc.Field(r.ir); vc.Field(r.red);
+            vc.End();
+        }
+        ok &= vc.Save(prefix + "_vitals.csv");
+
+        CsvWriter mc;
+        RollupHeader(mc);
+        for (const RollupRow &r : rollups) RollupLine(mc, r);
+        ok &= mc.Save(prefix + "_rollup.csv");
+    }
+
+    CsvWriter hc;
+    SdHealthHeader(hc);
+    for (const SdHealthRow &r : health) SdHealthLine(hc, r);
+    ok &= hc.Save(prefix + "_sd.csv");
+
+    std::fprintf(stderr, "%zu entries in %zu sectors: %zu steps, %zu vitals, %zu minutes, %zu SD health, "
+                 "%u sessions, %zu unknown\n",
+                 entries, used - 1, steps.size(), vitals.size(), rollups.size(), health.size(), boots, unknown);
+    std::fprintf(stderr, "%zu commits, %zu entries after the last one, %zu torn, %zu sequence gaps, "
+                 "%zu unused sectors\n", commits, uncommitted, torn, gaps, sectors - used);
+    if (packed_records > 0) {
+        std::fprintf(stderr, "%zu packed records in %zu bytes (%.2f bytes/record), %zu damaged blocks\n",
+                     packed_records, packed_bytes, double(packed_bytes) / double(packed_records), bad_blocks);
+    }
+    if (!ok) {
+        std::fprintf(stderr, "failed writing output files under %s\n", prefix.c_str());
+        return 1;
+    }
+    return 0;
+}
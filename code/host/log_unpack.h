@@ -0,0 +1,93 @@
+/* ========================================
+   File: log_unpack.h
+   Packed Block Decoder for the Wrist Log
+
+   C++ counterpart of log_pack.c: undoes the Rice
+   coding, zigzag and prediction of one packed
+   journal entry. Decoding stops at the first
+   inconsistency, so a damaged block yields the
+   records before it.
+   ======================================== */
+
+#ifndef LOG_UNPACK_H
+#define LOG_UNPACK_H
+
+#include "log_pack.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace logfmt {
+
+using PackedRecord = std::array<uint32_t, LOG_PACK_FIELDS>;
+
+class BitReader {
+public:
+    BitReader(const uint8_t *data, size_t len) : data_(data), bits_(len * 8) {}
+
+    bool Get(unsigned n, uint32_t &value)
+    {
+        if (pos_ + n > bits_) return false;
+        value = 0;
+        for (unsigned i = 0; i < n; i++, pos_++) {
+            value = (value << 1) | ((data_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1u);
+        }
+        return true;
+    }
+
+private:
+    const uint8_t *data_;
+    size_t bits_;
+    size_t pos_ = 0;
+};
+
+/* Records of one block; false if the block ended early */
+inline bool Unpack(const LogPackSchema_t &schema, const uint8_t *payload, size_t len,
+                   std::vector<PackedRecord> &out)
+{
+    if (len < 1) return false;
+    const unsigned count = payload[0];
+    BitReader in(payload + 1, len - 1);
+
+    PackedRecord prev{}, prev2{};
+    std::array<uint32_t, LOG_PACK_FIELDS> acc{};
+    for (unsigned f = 0; f < schema.fields; f++) acc[f] = 4u << schema.k0[f];
+
+    for (unsigned n = 0; n < count; n++) {
+        PackedRecord rec{};
+        for (unsigned f = 0; f < schema.fields; f++) {
+            uint32_t q = 0, bit = 1, zz;
+            while (q < LOG_PACK_ESCAPE) {
+                if (!in.Get(1, bit)) return false;
+                if (!bit) break;
+                q++;
+            }
+            if (q == LOG_PACK_ESCAPE) {
+                if (!in.Get(32, zz)) return false;
+            } else {
+                const unsigned k = n > 0 ? LogPack_RiceK(acc[f]) : schema.k1[f];
+                uint32_t low;
+                if (!in.Get(k, low)) return false;
+                zz = (q << k) | low;
+            }
+
+            uint32_t pred = 0;
+            if (n > 0) {
+                pred = prev[f];
+                if (schema.order[f] == 2 && n >= 2) pred = prev[f] + (prev[f] - prev2[f]);
+            }
+            rec[f] = pred + ((zz >> 1) ^ (0u - (zz & 1)));
+            if (n > 0) acc[f] = LogPack_Adapt(acc[f], zz);
+        }
+        prev2 = prev;
+        prev = rec;
+        out.push_back(rec);
+    }
+    return true;
+}
+
+} // namespace logfmt
+
+#endif /* LOG_UNPACK_H */
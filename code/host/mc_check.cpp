@@ -0,0 +1,150 @@
+/* ========================================
+   File: mc_check.cpp
+   Motion-Artifact Canceller Checks
+
+   Feeds motion_cancel.c a synthetic wrist PPG at
+   the FIFO rate on Linux: DC, a 72 bpm pulse and
+   an arm-swing tone (fundamental and second
+   harmonic) locked to a 625 ms step cadence, with
+   the steps reported as the ankle would, in
+   blocks like the wrist's PPG batches. Measures
+   each component in the output with a one-bin DFT
+   over the last 20 s. Exits non-zero if any check
+   fails.
+
+   Usage: mc_check
+   ======================================== */
+
+extern "C" {
+#include "motion_cancel.h"
+}
+
+#include "bench_check.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+using bench::Check;
+
+constexpr double kPi = 3.14159265358979;
+constexpr double kFs = MC_SAMPLE_RATE_HZ;
+constexpr uint16_t kStepMs = 625;           // 1.6 Hz cadence
+constexpr double kPulseHz = 1.2;            // 72 bpm
+constexpr double kDc = 120000, kPulse = 400, kSwing = 3000, kSwing2 = 1000;
+constexpr int kSeconds = 60, kWindowS = 20; // Whole cycles of every component in the window
+constexpr size_t kBlock = 4;                // main.h PPG_BATCH
+
+double Input(int n, bool swing)
+{
+    const double t = n / kFs;
+    const double step = 2 * kPi * 1000.0 / kStepMs * t;
+    double x = kDc + kPulse * std::sin(2 * kPi * kPulseHz * t);
+    if (swing) x += kSwing * std::sin(step + 0.7) + kSwing2 * std::cos(2 * step);
+    return x;
+}
+
+// Amplitude of the hz component over the last kWindowS seconds
+double Amplitude(const std::vector<double> &v, double hz)
+{
+    const size_t n = size_t(kWindowS * kFs);
+    double re = 0, im = 0;
+    for (size_t i = v.size() - n; i < v.size(); i++) {
+        re += v[i] * std::cos(2 * kPi * hz * i / kFs);
+        im += v[i] * std::sin(2 * kPi * hz * i / kFs);
+    }
+    return 2 * std::sqrt(re * re + im * im) / n;
+}
+
+// Canceller output for in, appended to out
+void Flush(std::vector<uint32_t> &in, std::vector<double> &out)
+{
+    uint32_t clean[kBlock];
+    MotionCancel_Process(in.data(), clean, uint32_t(in.size()));
+    out.insert(out.end(), clean, clean + in.size());
+    in.clear();
+}
+
+// Output of the canceller; steps reported at the cadence while walking is true.
+// A step ends the block, as a packet event does between PPG batches.
+std::vector<double> Run(bool swing, bool walking)
+{
+    MotionCancel_Init();
+    std::vector<double> out;
+    std::vector<uint32_t> in;
+    uint32_t next_step_ms = 0;
+    for (int n = 0; n < kSeconds * kFs; n++) {
+        const uint32_t ms = uint32_t(n * 1000 / kFs);
+        if (walking && ms >= next_step_ms) {
+            Flush(in, out);
+            MotionCancel_AddStepPeriod(kStepMs);
+            next_step_ms += kStepMs;
+        }
+        in.push_back(uint32_t(Input(n, swing) + 0.5));
+        if (in.size() == kBlock) Flush(in, out);
+    }
+    Flush(in, out);
+    return out;
+}
+
+void Cancel()
+{
+    const double f1 = 1000.0 / kStepMs;
+    std::vector<double> out = Run(true, true);
+    const double swing = Amplitude(out, f1), swing2 = Amplitude(out, 2 * f1);
+    const double pulse = Amplitude(out, kPulseHz);
+
+    Check("fundamental removed", swing < kSwing / 10, "%.0f of %.0f counts left", swing, kSwing);
+    Check("second harmonic removed", swing2 < kSwing2 / 10, "%.0f of %.0f counts left", swing2, kSwing2);
+    Check("pulse kept", std::fabs(pulse - kPulse) < kPulse / 10, "%.0f of %.0f counts", pulse, kPulse);
+    Check("active while walking", MotionCancel_IsActive(), "%d", MotionCancel_IsActive());
+}
+
+void PassThrough()
+{
+    // No steps: the signal comes out as it went in
+    std::vector<double> out = Run(true, false);
+    size_t changed = 0;
+    for (size_t n = 0; n < out.size(); n++) {
+        if (out[n] != uint32_t(Input(int(n), true) + 0.5)) changed++;
+    }
+    Check("no cadence, untouched", changed == 0 && !MotionCancel_IsActive(), "%zu sample(s) changed", changed);
+
+    // Walking without arm swing must leave the pulse alone
+    out = Run(false, true);
+    const double pulse = Amplitude(out, kPulseHz);
+    Check("no swing, pulse kept", std::fabs(pulse - kPulse) < kPulse / 20, "%.0f of %.0f counts", pulse, kPulse);
+}
+
+void Timeout()
+{
+    MotionCancel_Init();
+    MotionCancel_AddStepPeriod(kStepMs);
+    int n = 0;
+    while (MotionCancel_IsActive() && n < 2 * MC_CADENCE_TIMEOUT_S * kFs) {
+        uint32_t x = uint32_t(Input(n++, true));
+        MotionCancel_Process(&x, &x, 1);
+    }
+    Check("cadence timeout", n == MC_CADENCE_TIMEOUT_S * MC_SAMPLE_RATE_HZ + 1, "inactive after %.2f s", n / kFs);
+
+    MotionCancel_Init();
+    MotionCancel_AddStepPeriod(MC_PERIOD_MAX_MS + 1);
+    Check("period out of range", !MotionCancel_IsActive(), "%d", MotionCancel_IsActive());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        std::fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    Cancel();
+    PassThrough();
+    Timeout();
+    return bench::Summary("check(s)");
+}
@@ -0,0 +1,451 @@
+/* ========================================
+   File: sd_emu.cpp
+   SD Driver on an Emulated SPI Card
+
+   Runs the wrist SD driver (fatfs_sd.c) on Linux
+   with its SPI transfers clocked through a byte-
+   level card model (sim/sd_card.c, sim/spi_bus.c).
+   Profiles init and every transfer path on a
+   nominal SDHC card, then replays slow and faulty
+   cards against the driver's retries and timeouts
+   and checks what its health counters recorded
+   and how long it reported the card as working.
+   Exits non-zero if any scenario ends differently
+   from what the driver promises.
+
+   Usage: sd_emu [-n SECTORS]
+   ======================================== */
+
+#include "sd_card.h"
+#include "spi_bus.h"
+
+extern "C" {
+#include "fatfs.h"
+volatile uint32_t sim_tick = 0;
+}
+
+#include "bench_check.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using bench::Check;
+
+constexpr uint32_t kNever = 0xFFFFFFFFUL;
+
+/* Simulated time between SD_ActiveHook(1) and (0), as the wrist charges ENERGY_SD */
+struct {
+    uint8_t on;
+    uint64_t since;
+    uint64_t ns;
+} sd_active;
+
+SdCardConfig_t Card()
+{
+    SdCardConfig_t card;
+    SdCard_DefaultConfig(&card);
+    return card;
+}
+
+/* Fresh card and bus at t = 0 */
+void PowerUp(const SdCardConfig_t &card)
+{
+    SpiBusConfig_t bus;
+    SpiBus_DefaultConfig(&bus);
+    SpiBus_Init(&bus);
+    SdCard_Init(&card);
+}
+
+double Ms(uint64_t ns)
+{
+    return ns / 1e6;
+}
+
+void Fill(uint8_t *buf, uint32_t lba, uint32_t salt)
+{
+    uint32_t x = lba * 2654435761u ^ salt;
+    for (int i = 0; i < SD_CARD_SECTOR; i++) {
+        x = x * 1103515245u + 12345u;
+        buf[i] = uint8_t(x >> 16);
+    }
+}
+
+bool OnCard(uint32_t lba, uint32_t salt)
+{
+    uint8_t expect[SD_CARD_SECTOR];
+    Fill(expect, lba, salt);
+    const uint8_t *block = SdCard_Block(lba);
+    return block && std::memcmp(block, expect, SD_CARD_SECTOR) == 0;
+}
+
+/* Driver health counters accumulate from power-up; scenarios look at their change */
+struct Health {
+    SD_Health_t start = *SD_GetHealth();
+
+    uint32_t Delta(uint32_t SD_Health_t::*field) const { return SD_GetHealth()->*field - start.*field; }
+    uint32_t Single(int bin) const { return SD_GetHealth()->single_ms[bin] - start.single_ms[bin]; }
+    uint32_t Multi(int bin) const { return SD_GetHealth()->multi_ms[bin] - start.multi_ms[bin]; }
+};
+
+void PrintHistogram(const char *name, const uint32_t *bins)
+{
+    static const char *const labels[SD_HIST_BINS] = {
+        "<1", "1", "2", "4", "8", "16", "32", "64", "128", "256", "512", "1024+"
+    };
+    std::printf("%-14s", name);
+    for (int i = 0; i < SD_HIST_BINS; i++) {
+        if (bins[i]) std::printf(" %s ms:%u", labels[i], bins[i]);
+    }
+    std::printf("\n");
+}
+
+/* ---- Profile -------------------------------------------------------------- */
+
+struct Snapshot {
+    uint64_t now;
+    SpiBusStats_t bus;
+    SdCardStats_t card;
+
+    static Snapshot Take()
+    {
+        return { SpiBus_Now(), *SpiBus_GetStats(), *SdCard_GetStats() };
+    }
+};
+
+void Row(const char *name, const Snapshot &a, uint32_t sectors)
+{
+    const Snapshot b = Snapshot::Take();
+    const double ns = double(b.now - a.now);
+    const uint64_t bytes = (b.card.bytes_selected - a.card.bytes_selected) +
+                           (b.card.bytes_deselected - a.card.bytes_deselected);
+    const uint64_t polls = (b.card.busy_bytes - a.card.busy_bytes) + (b.card.latency_bytes - a.card.latency_bytes);
+    const uint64_t calls = (b.bus.calls - a.bus.calls) + (b.bus.dma_transfers - a.bus.dma_transfers);
+    const double payload = double(sectors) * SD_CARD_SECTOR;
+
+    std::printf("%-14s %5u %9.1f %8.0f %8.3f %9.1f %9.1f %5.0f%%\n", name, sectors,
+                ns / 1e3 / sectors, payload / 1024 / (ns / 1e9), bytes / payload,
+                double(calls) / sectors, double(polls) / sectors,
+                100.0 * double(b.bus.overhead_ns - a.bus.overhead_ns) / ns);
+}
+
+void Profile(uint32_t n)
+{
+    std::vector<uint8_t> buf(8 * SD_CARD_SECTOR);
+    bool data_ok = true;
+    const uint32_t base = 4096;
+
+    PowerUp(Card());
+    const uint64_t t0 = SpiBus_Now();
+    const DSTATUS st = SD_disk_initialize(0);
+    const SdCardStats_t *cs = SdCard_GetStats();
+    std::printf("init           %s in %.1f ms, %llu bytes clocked, %u CMD55+ACMD41 polls, %llu HAL calls\n",
+                st == 0 ? "ok" : "FAILED", Ms(SpiBus_Now() - t0),
+                (unsigned long long)(cs->bytes_selected + cs->bytes_deselected), cs->acmd[41],
+                (unsigned long long)SpiBus_GetStats()->calls);
+    if (st != 0) {
+        bench::failures++;
+        return;
+    }
+
+    std::printf("\n%-14s %5s %9s %8s %8s %9s %9s %6s\n", "operation", "secs", "us/sector", "KB/s",
+                "bus B/B", "calls/blk", "polls/blk", "HAL");
+
+    Snapshot s = Snapshot::Take();
+    for (uint32_t i = 0; i < n; i++) {
+        Fill(buf.data(), base + i, 1);
+        data_ok &= SD_disk_write(0, buf.data(), base + i, 1) == RES_OK;
+    }
+    SD_disk_ioctl(0, CTRL_SYNC, nullptr);
+    Row("write CMD24", s, n);
+
+    s = Snapshot::Take();
+    for (uint32_t i = 0; i < n; i += 8) {
+        for (uint32_t k = 0; k < 8; k++) Fill(&buf[k * SD_CARD_SECTOR], base + n + i + k, 2);
+        data_ok &= SD_disk_write(0, buf.data(), base + n + i, 8) == RES_OK;
+    }
+    SD_disk_ioctl(0, CTRL_SYNC, nullptr);
+    Row("write CMD25x8", s, n);
+
+    s = Snapshot::Take();
+    for (uint32_t i = 0; i < n; i++) {
+        Fill(buf.data(), base + 2 * n + i, 3);
+        data_ok &= SD_StreamWrite(base + 2 * n + i, buf.data()) == RES_OK;
+    }
+    data_ok &= SD_StreamStop() == RES_OK;
+    Row("stream CMD25", s, n);
+
+    s = Snapshot::Take();
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t expect[SD_CARD_SECTOR];
+        Fill(expect, base + i, 1);
+        data_ok &= SD_disk_read(0, buf.data(), base + i, 1) == RES_OK &&
+                   std::memcmp(buf.data(), expect, SD_CARD_SECTOR) == 0;
+    }
+    Row("read CMD17", s, n);
+
+    s = Snapshot::Take();
+    for (uint32_t i = 0; i < n; i += 8) {
+        data_ok &= SD_disk_read(0, buf.data(), base + n + i, 8) == RES_OK;
+        for (uint32_t k = 0; k < 8; k++) {
+            uint8_t expect[SD_CARD_SECTOR];
+            Fill(expect, base + n + i + k, 2);
+            data_ok &= std::memcmp(&buf[k * SD_CARD_SECTOR], expect, SD_CARD_SECTOR) == 0;
+        }
+    }
+    Row("read CMD18x8", s, n);
+
+    for (uint32_t i = 0; i < n; i++) data_ok &= OnCard(base + 2 * n + i, 3);
+
+    const SD_Health_t *h = SD_GetHealth();
+    std::printf("\n");
+    PrintHistogram("single writes", h->single_ms);
+    PrintHistogram("multi writes", h->multi_ms);
+    std::printf("busy           %u ms in %u waits, longest %u ms\n\n", h->busy_ms, h->busy_waits, h->busy_max_ms);
+    Check("profile data", data_ok, "%u sectors per path written and read back", n);
+}
+
+/* ---- Scenarios ------------------------------------------------------------ */
+
+/* Init, then a single and a two-block write read back through the driver */
+bool RoundTrip(uint32_t lba)
+{
+    uint8_t buf[2 * SD_CARD_SECTOR];
+    Fill(buf, lba, 7);
+    Fill(buf + SD_CARD_SECTOR, lba + 1, 7);
+    if (SD_disk_write(0, buf, lba, 1) != RES_OK) return false;
+    if (SD_disk_write(0, buf, lba, 2) != RES_OK) return false;
+    std::memset(buf, 0, sizeof(buf));
+    if (SD_disk_read(0, buf, lba, 2) != RES_OK) return false;
+
+    uint8_t expect[SD_CARD_SECTOR];
+    for (uint32_t k = 0; k < 2; k++) {
+        Fill(expect, lba + k, 7);
+        if (std::memcmp(buf + k * SD_CARD_SECTOR, expect, SD_CARD_SECTOR) != 0) return false;
+        if (!OnCard(lba + k, 7)) return false;
+    }
+    return true;
+}
+
+void Identification()
+{
+    SdCardConfig_t card = Card();
+    PowerUp(card);
+    DWORD sectors = 0, block = 0;
+    bool ok = SD_disk_initialize(0) == 0 &&
+              SD_disk_ioctl(0, GET_SECTOR_COUNT, &sectors) == RES_OK &&
+              SD_disk_ioctl(0, GET_BLOCK_SIZE, &block) == RES_OK;
+    Check("SDHC identification", ok && sectors == card.sectors && block == 16UL << card.au_size,
+          "%lu sectors, erase block %lu sectors", (unsigned long)sectors, (unsigned long)block);
+
+    card = Card();
+    card.high_capacity = 0;
+    card.sectors = 2UL * 1024 * 1024;
+    PowerUp(card);
+    ok = SD_disk_initialize(0) == 0 && SD_disk_ioctl(0, GET_SECTOR_COUNT, &sectors) == RES_OK &&
+         sectors == card.sectors && RoundTrip(1000);
+    Check("SDSC v2 byte addressing", ok, "1 GB, CMD16 %u, lba 1000 at byte %u",
+          SdCard_GetStats()->cmd[16], 1000u * SD_CARD_SECTOR);
+
+    card.version = 1;
+    card.sectors = 1024UL * 1024;
+    PowerUp(card);
+    ok = SD_disk_initialize(0) == 0 && SD_disk_ioctl(0, GET_SECTOR_COUNT, &sectors) == RES_OK &&
+         sectors == card.sectors && RoundTrip(77);
+    Check("SDv1 (no CMD8)", ok, "CMD8 rejected %u time(s), %u ACMD41 polls",
+          SdCard_GetStats()->illegal, SdCard_GetStats()->acmd[41]);
+
+    card = Card();
+    card.ncr = 8;
+    PowerUp(card);
+    ok = SD_disk_initialize(0) == 0 && RoundTrip(10);
+    Check("NCR of 8 bytes", ok, "slowest response timing the spec allows");
+}
+
+void SlowInit()
+{
+    SdCardConfig_t card = Card();
+    card.init_us = 900000;
+    PowerUp(card);
+    DSTATUS st = SD_disk_initialize(0);
+    double ms = Ms(SpiBus_Now());
+    Check("ACMD41 takes 900 ms", st == 0 && ms >= 900 && RoundTrip(20), "ready after %.0f ms, %u polls",
+          ms, SdCard_GetStats()->acmd[41]);
+
+    card.init_us = kNever;
+    PowerUp(card);
+    st = SD_disk_initialize(0);
+    ms = Ms(SpiBus_Now());
+    Check("card stuck in idle", st != 0 && (SD_disk_status(0) & STA_NOINIT) && ms < 1100 &&
+          SD_disk_ioctl(0, CTRL_SYNC, nullptr) == RES_NOTRDY,
+          "gave up after %.0f ms", ms);
+
+    card = Card();
+    card.present = 0;
+    PowerUp(card);
+    st = SD_disk_initialize(0);
+    ms = Ms(SpiBus_Now());
+    Check("no card", st != 0 && ms < 20, "gave up after %.1f ms", ms);
+}
+
+void WriteStalls()
+{
+    uint8_t buf[SD_CARD_SECTOR];
+
+    /* Within the driver's busy timeout: slow, never an error */
+    SdCardConfig_t card = Card();
+    card.stall_every = 10;
+    card.stall_us = 300000;
+    PowerUp(card);
+    bool ok = SD_disk_initialize(0) == 0;
+    Health health;
+    uint32_t errors = 0;
+    double worst = 0;
+    for (uint32_t i = 0; ok && i < 45; i++) {
+        Fill(buf, 500 + i, 4);
+        const uint64_t t = SpiBus_Now();
+        if (SD_disk_write(0, buf, 500 + i, 1) != RES_OK) errors++;
+        if (Ms(SpiBus_Now() - t) > worst) worst = Ms(SpiBus_Now() - t);
+    }
+    for (uint32_t i = 0; ok && i < 45; i++) ok &= OnCard(500 + i, 4);
+    /* Each stall shows up in the write after it, in the 256-511 ms bin */
+    const uint32_t stalls = SdCard_GetStats()->stalls;
+    ok = ok && errors == 0 && worst >= 300 && health.Single(9) == stalls &&
+         health.Delta(&SD_Health_t::busy_timeouts) == 0 && SD_GetHealth()->busy_max_ms >= 299;
+    Check("300 ms programming stalls", ok, "%u stalls, %u errors, worst write %.0f ms, %u in the 256 ms bin",
+          stalls, errors, worst, health.Single(9));
+
+    /* Past it: the next command fails once, a retry after the stall succeeds */
+    card.stall_every = 5;
+    card.stall_us = 800000;
+    PowerUp(card);
+    ok = SD_disk_initialize(0) == 0;
+    Health single;
+    errors = 0;
+    for (uint32_t i = 0; ok && i < 8; i++) {
+        Fill(buf, 600 + i, 5);
+        if (SD_disk_write(0, buf, 600 + i, 1) != RES_OK) errors++;
+    }
+    for (uint32_t i = 0; ok && i < 8; i++) ok &= OnCard(600 + i, 5);
+    ok = ok && errors == 0 && single.Delta(&SD_Health_t::busy_timeouts) == 1 &&
+         single.Delta(&SD_Health_t::retries) == 1 && single.Single(10) == 1;
+    Check("800 ms stall, single blocks", ok, "%u busy timeout, %u retry, %u error(s), one write in the 512 ms bin",
+          single.Delta(&SD_Health_t::busy_timeouts), single.Delta(&SD_Health_t::retries), errors);
+
+    /* Same inside an open CMD25 stream */
+    card.stall_every = 20;
+    PowerUp(card);
+    ok = SD_disk_initialize(0) == 0;
+    Health stream;
+    errors = 0;
+    for (uint32_t i = 0; ok && i < 64; i++) {
+        Fill(buf, 2000 + i, 6);
+        if (SD_StreamWrite(2000 + i, buf) != RES_OK) errors++;
+    }
+    ok = ok && SD_StreamStop() == RES_OK;
+    for (uint32_t i = 0; ok && i < 64; i++) ok &= OnCard(2000 + i, 6);
+    ok = ok && errors == 0 && stream.Delta(&SD_Health_t::retries) == SdCard_GetStats()->stalls &&
+         stream.Multi(10) == SdCard_GetStats()->stalls;
+    Check("800 ms stall, CMD25 stream", ok, "%u stalls, %u blocks retried in a new CMD25, %u error(s)",
+          SdCard_GetStats()->stalls, stream.Delta(&SD_Health_t::retries), errors);
+}
+
+void ReadLatency()
+{
+    uint8_t buf[SD_CARD_SECTOR];
+
+    SdCardConfig_t card = Card();
+    card.read_us = 150000;
+    PowerUp(card);
+    bool ok = SD_disk_initialize(0) == 0 && RoundTrip(30);
+    Check("150 ms read latency", ok, "inside the %d ms token timeout", 200);
+
+    card.read_us = 300000;
+    PowerUp(card);
+    ok = SD_disk_initialize(0) == 0;
+    Health health;
+    const uint64_t t = SpiBus_Now();
+    const DRESULT res = SD_disk_read(0, buf, 30, 1);
+    const double ms = Ms(SpiBus_Now() - t);
+    Fill(buf, 31, 8);
+    ok = ok && res == RES_ERROR && SD_disk_write(0, buf, 31, 1) == RES_OK && OnCard(31, 8) &&
+         health.Delta(&SD_Health_t::token_timeouts) == 1;
+    Check("300 ms read latency", ok, "read failed after %.0f ms, next write ok", ms);
+}
+
+void ActiveTime()
+{
+    enum { kSectors = 32, kGapMs = 50 };
+    uint8_t buf[SD_CARD_SECTOR];
+    PowerUp(Card());
+    bool ok = SD_disk_initialize(0) == 0;
+    bool idle_between = true;
+    const uint64_t t0 = SpiBus_Now(), a0 = sd_active.ns;
+
+    // The logger fills the next sector while the CMD25 stays open
+    for (uint32_t i = 0; ok && i < kSectors; i++) {
+        Fill(buf, 300 + i, 10);
+        ok = SD_StreamWrite(300 + i, buf) == RES_OK;
+        idle_between = idle_between && !sd_active.on;
+        SpiBus_Idle(uint64_t(kGapMs) * 1000000);
+    }
+    ok = ok && SD_StreamStop() == RES_OK && !sd_active.on;
+
+    const double active_ms = Ms(sd_active.ns - a0), total_ms = Ms(SpiBus_Now() - t0);
+    Check("active time, open stream", ok && idle_between && active_ms <= total_ms - kSectors * kGapMs,
+          "%.1f ms of %.0f ms charged, %d x %d ms between writes", active_ms, total_ms, int(kSectors), int(kGapMs));
+}
+
+void Trim()
+{
+    uint8_t buf[4 * SD_CARD_SECTOR];
+    PowerUp(Card());
+    bool ok = SD_disk_initialize(0) == 0;
+    for (uint32_t k = 0; k < 4; k++) Fill(buf + k * SD_CARD_SECTOR, 100 + k, 9);
+    ok = ok && SD_disk_write(0, buf, 100, 4) == RES_OK;
+    DWORD range[2] = { 100, 103 };
+    ok = ok && SD_disk_ioctl(0, CTRL_TRIM, range) == RES_OK;
+
+    static const uint8_t zero[SD_CARD_SECTOR] = {};
+    for (uint32_t k = 0; ok && k < 4; k++) ok = std::memcmp(SdCard_Block(100 + k), zero, SD_CARD_SECTOR) == 0;
+    Check("CTRL_TRIM", ok, "CMD32/33/38 erased %u blocks", SdCard_GetStats()->erased_blocks);
+}
+
+}  // namespace
+
+/* Replaces the weak hook in fatfs_sd.c */
+extern "C" void SD_ActiveHook(uint8_t active)
+{
+    const uint64_t now = SpiBus_Now();
+    if (sd_active.on) sd_active.ns += now - sd_active.since;
+    sd_active.on = active;
+    sd_active.since = now;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t sectors = 256;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            sectors = uint32_t(std::strtoul(argv[++i], nullptr, 10) + 7) & ~7u;
+        } else {
+            std::fprintf(stderr, "usage: %s [-n SECTORS]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Profile(sectors);
+    Identification();
+    SlowInit();
+    WriteStalls();
+    ReadLatency();
+    ActiveTime();
+    Trim();
+    SdCard_Free();
+
+    return bench::Summary("scenario(s)");
+}
@@ -0,0 +1,2 @@
+/* Name the CubeMX user_diskio.c glue expects for the SD driver header */
+#include "fatfs.h"
@@ -0,0 +1,53 @@
+/* ========================================
+   File: ffconf.h
+   FatFs R0.12c Configuration for the Host Benchmark
+
+   Matches the wrist build where it matters
+   (512-byte sectors, no LFN, f_expand and TRIM);
+   mkfs is enabled so the benchmark can format its
+   disk image.
+   ======================================== */
+
+#define _FFCONF 68300
+
+/* Function configuration */
+#define _FS_READONLY    0
+#define _FS_MINIMIZE    0
+#define _USE_STRFUNC    0
+#define _USE_FIND       0
+#define _USE_MKFS       1
+#define _USE_FASTSEEK   0
+#define _USE_EXPAND     1
+#define _USE_CHMOD      0
+#define _USE_LABEL      0
+#define _USE_FORWARD    0
+
+/* Locale and namespace */
+#define _CODE_PAGE      437
+#define _USE_LFN        0
+#define _MAX_LFN        255
+#define _LFN_UNICODE    0
+#define _STRF_ENCODE    3
+#define _FS_RPATH       0
+
+/* Drive/volume */
+#define _VOLUMES        1
+#define _STR_VOLUME_ID  0
+#define _VOLUME_STRS    "RAM","NAND","CF","SD","SD2","USB","USB2","USB3"
+#define _MULTI_PARTITION 0
+#define _MIN_SS         512
+#define _MAX_SS         512
+#define _USE_TRIM       1
+#define _FS_NOFSINFO    0
+
+/* System */
+#define _FS_TINY        0
+#define _FS_EXFAT       0
+#define _FS_NORTC       1
+#define _NORTC_MON      1
+#define _NORTC_MDAY     1
+#define _NORTC_YEAR     2025
+#define _FS_LOCK        0
+#define _FS_REENTRANT   0
+#define _FS_TIMEOUT     1000
+#define _SYNC_t         void*
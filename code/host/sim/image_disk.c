@@ -0,0 +1,173 @@
+/* ========================================
+   File: image_disk.c
+   File-Backed SD Card for the Host Benchmark
+   ======================================== */
+
+#define _FILE_OFFSET_BITS 64
+
+#include "image_disk.h"
+#include "fatfs.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SECTOR          512
+
+static FILE *img = NULL;
+static uint32_t sector_count = 0;
+static ImageDiskStats_t stats;
+static uint32_t fat_start, data_start, dir_start, dir_sectors;
+
+int ImageDisk_Open(const char *path, uint32_t sectors, int create)
+{
+    img = fopen(path, create ? "w+b" : "r+b");
+    if (!img) return -1;
+
+    if (create) {
+        /* Sparse file; unwritten sectors read back as zero like a trimmed card */
+        if (ftruncate(fileno(img), (off_t)sectors * SECTOR) != 0) return -1;
+        sector_count = sectors;
+    } else {
+        fseeko(img, 0, SEEK_END);
+        sector_count = (uint32_t)(ftello(img) / SECTOR);
+    }
+    memset(&stats, 0, sizeof(stats));
+    return 0;
+}
+
+void ImageDisk_Close(void)
+{
+    if (img) fclose(img);
+    img = NULL;
+}
+
+void ImageDisk_SetLayout(uint32_t fat, uint32_t data, uint32_t dir, uint32_t dir_len)
+{
+    fat_start = fat;
+    data_start = data;
+    dir_start = dir;
+    dir_sectors = dir_len;
+}
+
+const ImageDiskStats_t *ImageDisk_GetStats(void)
+{
+    return &stats;
+}
+
+static void ImageDisk_Classify(DWORD sector, UINT count)
+{
+    for (UINT i = 0; i < count; i++) {
+        DWORD s = sector + i;
+        if (s >= fat_start && s < data_start) stats.fat_writes++;
+        if (s >= dir_start && s < dir_start + dir_sectors) stats.meta_writes++;
+    }
+}
+
+static DRESULT ImageDisk_Write(const BYTE *buff, DWORD sector, UINT count)
+{
+    if (!img || sector + count > sector_count) return RES_PARERR;
+    if (fseeko(img, (off_t)sector * SECTOR, SEEK_SET) != 0) return RES_ERROR;
+    if (fwrite(buff, SECTOR, count, img) != count) return RES_ERROR;
+    return RES_OK;
+}
+
+DSTATUS SD_disk_initialize(BYTE drv)
+{
+    return (drv == 0 && img) ? 0 : STA_NOINIT;
+}
+
+DSTATUS SD_disk_status(BYTE drv)
+{
+    return (drv == 0 && img) ? 0 : STA_NOINIT;
+}
+
+DRESULT SD_disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+    if (pdrv || !img || sector + count > sector_count) return RES_PARERR;
+    SD_StreamStop();
+
+    stats.read_calls++;
+    stats.sectors_read += count;
+    if (fseeko(img, (off_t)sector * SECTOR, SEEK_SET) != 0) return RES_ERROR;
+    return fread(buff, SECTOR, count, img) == count ? RES_OK : RES_ERROR;
+}
+
+DRESULT SD_disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+    if (pdrv) return RES_PARERR;
+    SD_StreamStop();
+
+    stats.write_calls++;
+    stats.sectors_written += count;
+    ImageDisk_Classify(sector, count);
+    return ImageDisk_Write(buff, sector, count);
+}
+
+DRESULT SD_disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
+{
+    static const BYTE zero[SECTOR];
+
+    if (drv || !img) return RES_PARERR;
+    SD_StreamStop();
+
+    switch (ctrl) {
+    case CTRL_SYNC:
+        stats.ioctl_syncs++;
+        return fflush(img) == 0 ? RES_OK : RES_ERROR;
+    case GET_SECTOR_COUNT:
+        *(DWORD *)buff = sector_count;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *(WORD *)buff = SECTOR;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *(DWORD *)buff = 1;
+        return RES_OK;
+    case CTRL_TRIM: {
+        /* Erased state of the cards the wrist uses (DATA_STAT_AFTER_ERASE = 0) */
+        DWORD *range = (DWORD *)buff;
+        stats.trims++;
+        for (DWORD s = range[0]; s <= range[1]; s++) {
+            if (ImageDisk_Write(zero, s, 1) != RES_OK) return RES_ERROR;
+            stats.trimmed_sectors++;
+        }
+        return RES_OK;
+    }
+    default:
+        return RES_PARERR;
+    }
+}
+
+/* Open multi-block write; only the bookkeeping differs from disk_write here */
+static DWORD stream_next = 0;
+static uint8_t stream_open = 0;
+
+DRESULT SD_StreamWrite(DWORD sector, const BYTE *buff)
+{
+    if (stream_open && sector != stream_next) SD_StreamStop();
+    if (!stream_open) {
+        stats.write_calls++;
+        stream_open = 1;
+    }
+
+    stats.stream_writes++;
+    stats.sectors_written++;
+    ImageDisk_Classify(sector, 1);
+    stream_next = sector + 1;
+    return ImageDisk_Write(buff, sector, 1);
+}
+
+DRESULT SD_StreamStop(void)
+{
+    if (!stream_open) return RES_OK;
+    stream_open = 0;
+    stats.stream_stops++;
+    return RES_OK;
+}
+
+/* An image has no timing; the health record stays zero */
+const SD_Health_t *SD_GetHealth(void)
+{
+    static const SD_Health_t health;
+    return &health;
+}
@@ -0,0 +1,44 @@
+/* ========================================
+   File: image_disk.h
+   File-Backed SD Card for the Host Benchmark
+
+   Implements the fatfs_sd.c interface on a disk
+   image and counts what the logging stack asks of
+   the card. Writes are classified by the FAT
+   layout the benchmark reports after mounting.
+   ======================================== */
+
+#ifndef IMAGE_DISK_H
+#define IMAGE_DISK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint64_t read_calls;
+    uint64_t sectors_read;
+    uint64_t write_calls;       /* disk_write, one CMD24/CMD25 each on the card */
+    uint64_t sectors_written;
+    uint64_t fat_writes;        /* Sectors in the reserved area and FATs */
+    uint64_t meta_writes;       /* Directory sectors */
+    uint64_t stream_writes;     /* Sectors through SD_StreamWrite */
+    uint64_t stream_stops;
+    uint64_t ioctl_syncs;
+    uint64_t trims;
+    uint64_t trimmed_sectors;
+} ImageDiskStats_t;
+
+/* Function prototypes */
+int ImageDisk_Open(const char *path, uint32_t sectors, int create);
+void ImageDisk_Close(void);
+void ImageDisk_SetLayout(uint32_t fat_start, uint32_t data_start, uint32_t dir_start, uint32_t dir_sectors);
+const ImageDiskStats_t *ImageDisk_GetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IMAGE_DISK_H */
@@ -0,0 +1,548 @@
+/* ========================================
+   File: sd_card.c
+   SPI-Mode SD Card Model for Host Tests
+   ======================================== */
+
+#include "sd_card.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* R1 flags */
+#define R1_IDLE                 0x01
+#define R1_ILLEGAL              0x04
+#define R1_CRC                  0x08
+#define R1_ADDRESS              0x20
+#define R1_PARAM                0x40
+
+#define TOKEN_SINGLE            0xFE    /* Read data and CMD24 */
+#define TOKEN_MULTI             0xFC    /* CMD25 block */
+#define TOKEN_STOP              0xFD    /* CMD25 end */
+#define DATA_ACCEPTED           0x05
+#define DATA_WRITE_ERROR        0x0D
+#define ERROR_OUT_OF_RANGE      0x08    /* Data error token */
+
+#define US                      1000ULL
+
+typedef enum {
+    PHASE_COMMAND = 0,
+    PHASE_READ,
+    PHASE_READ_MULTI,
+    PHASE_WRITE_TOKEN,
+    PHASE_WRITE_DATA
+} Phase_t;
+
+static SdCardConfig_t cfg;
+static SdCardStats_t stats;
+static uint8_t **blocks = NULL;
+static uint8_t selected = 0;
+
+static uint8_t idle = 1;
+static uint8_t app = 0;
+static uint8_t ccs = 0;
+static uint8_t init_started = 0;
+static uint64_t init_start_ns;
+
+static uint8_t cmd_buf[6];
+static uint8_t cmd_len = 0;
+
+/* Output: the response first, then a data packet no earlier than data_at_ns */
+static uint8_t resp[16];
+static uint8_t resp_len = 0, resp_pos = 0;
+static uint8_t data[1 + SD_CARD_SECTOR + 2];
+static uint16_t data_len = 0, data_pos = 0;
+static uint8_t data_is_block = 0;
+static uint64_t data_at_ns;
+static uint64_t busy_after_ns = 0;      /* Starts once the response is out */
+static uint64_t busy_until_ns = 0;
+
+static Phase_t phase = PHASE_COMMAND;
+static uint8_t write_multi;
+static uint32_t lba;
+static uint8_t rx_buf[SD_CARD_SECTOR + 2];
+static uint16_t rx_count;
+static uint32_t erase_start, erase_end;
+static uint32_t write_count;
+
+static uint8_t SdCard_Crc7(const uint8_t *p, uint16_t len)
+{
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t b = *p++;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc <<= 1;
+            if ((b ^ crc) & 0x80) crc ^= 0x09;
+            b <<= 1;
+        }
+    }
+    return crc & 0x7F;
+}
+
+static uint16_t SdCard_Crc16(const uint8_t *p, uint16_t len)
+{
+    uint16_t crc = 0;
+    while (len--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (uint8_t i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void SdCard_DefaultConfig(SdCardConfig_t *config)
+{
+    /* A typical 4 GB class 10 SDHC card */
+    memset(config, 0, sizeof(*config));
+    config->present = 1;
+    config->version = 2;
+    config->high_capacity = 1;
+    config->sectors = 8UL * 1024 * 1024;
+    config->ncr = 1;
+    config->au_size = 9;
+    config->init_us = 300000;
+    config->read_us = 250;
+    config->write_us = 700;
+    config->multi_write_us = 250;
+    config->stop_us = 500;
+    config->erase_us = 20000;
+}
+
+int SdCard_Init(const SdCardConfig_t *config)
+{
+    SdCard_Free();
+    cfg = *config;
+    if (!cfg.high_capacity && cfg.sectors > (4096UL << 9)) cfg.sectors = 4096UL << 9;
+    blocks = (uint8_t **)calloc(cfg.sectors, sizeof(uint8_t *));
+    if (!blocks) return -1;
+
+    selected = 0;
+    idle = 1;
+    app = 0;
+    ccs = 0;
+    init_started = 0;
+    cmd_len = 0;
+    resp_len = resp_pos = 0;
+    data_len = data_pos = 0;
+    busy_after_ns = 0;
+    busy_until_ns = 0;
+    phase = PHASE_COMMAND;
+    write_count = 0;
+    memset(&stats, 0, sizeof(stats));
+    return 0;
+}
+
+void SdCard_Free(void)
+{
+    if (!blocks) return;
+    for (uint32_t i = 0; i < cfg.sectors; i++) free(blocks[i]);
+    free(blocks);
+    blocks = NULL;
+}
+
+const uint8_t *SdCard_Block(uint32_t n)
+{
+    static const uint8_t erased[SD_CARD_SECTOR];
+    if (n >= cfg.sectors) return NULL;
+    return blocks[n] ? blocks[n] : erased;
+}
+
+const SdCardStats_t *SdCard_GetStats(void)
+{
+    return &stats;
+}
+
+void SdCard_ResetStats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint8_t SdCard_Busy(uint64_t now_ns)
+{
+    return now_ns < busy_until_ns;
+}
+
+static void SdCard_R1(uint8_t flags)
+{
+    resp[resp_len++] = flags | (idle ? R1_IDLE : 0);
+}
+
+static void SdCard_Illegal(void)
+{
+    stats.illegal++;
+    SdCard_R1(R1_ILLEGAL);
+}
+
+/* Queue a data packet: start token, payload, CRC-16 */
+static void SdCard_QueuePacket(const uint8_t *payload, uint16_t len, uint64_t at_ns, uint8_t is_block)
+{
+    data[0] = TOKEN_SINGLE;
+    memcpy(&data[1], payload, len);
+    uint16_t crc = SdCard_Crc16(payload, len);
+    data[1 + len] = (uint8_t)(crc >> 8);
+    data[2 + len] = (uint8_t)crc;
+    data_len = len + 3;
+    data_pos = 0;
+    data_at_ns = at_ns;
+    data_is_block = is_block;
+}
+
+static void SdCard_QueueBlock(uint64_t at_ns)
+{
+    if (lba >= cfg.sectors) {
+        /* Multi-block read ran off the end: error token instead of data */
+        data[0] = ERROR_OUT_OF_RANGE;
+        data_len = 1;
+        data_pos = 0;
+        data_at_ns = at_ns;
+        data_is_block = 0;
+        phase = PHASE_COMMAND;
+        return;
+    }
+    SdCard_QueuePacket(SdCard_Block(lba), SD_CARD_SECTOR, at_ns, 1);
+}
+
+static void SdCard_QueueCsd(void)
+{
+    uint8_t csd[16];
+    memset(csd, 0, sizeof(csd));
+    csd[1] = 0x0E;                      /* TAAC */
+    csd[3] = 0x32;                      /* TRAN_SPEED 25 MHz */
+    csd[4] = 0x5B;                      /* CCC */
+    csd[5] = 0x59;                      /* CCC, READ_BL_LEN = 9 */
+    csd[10] = 0x40 | 0x3F;              /* ERASE_BLK_EN, SECTOR_SIZE = 127 */
+    csd[11] = 0x80;
+    csd[12] = 0x02;                     /* WRITE_BL_LEN = 9 */
+    csd[13] = 0x40;
+
+    if (cfg.high_capacity) {
+        uint32_t c_size = cfg.sectors / 1024 - 1;
+        csd[0] = 0x40;                  /* CSD v2 */
+        csd[7] = (uint8_t)((c_size >> 16) & 0x3F);
+        csd[8] = (uint8_t)(c_size >> 8);
+        csd[9] = (uint8_t)c_size;
+    } else {
+        /* (C_SIZE + 1) << (C_SIZE_MULT + 2) blocks of 512 */
+        uint32_t c_size = cfg.sectors / 512 - 1;
+        uint8_t mult = 7;
+        csd[6] = (uint8_t)((c_size >> 10) & 0x03);
+        csd[7] = (uint8_t)(c_size >> 2);
+        csd[8] = (uint8_t)((c_size & 0x03) << 6);
+        csd[9] = (uint8_t)(mult >> 1);
+        csd[10] |= (uint8_t)((mult & 1) << 7);
+    }
+    csd[15] = (uint8_t)((SdCard_Crc7(csd, 15) << 1) | 1);
+    SdCard_QueuePacket(csd, sizeof(csd), 0, 0);
+}
+
+static void SdCard_InitStep(uint64_t now_ns, uint8_t hcs)
+{
+    if (!init_started) {
+        init_started = 1;
+        init_start_ns = now_ns;
+    }
+    if (cfg.init_us == 0xFFFFFFFFUL || now_ns - init_start_ns < cfg.init_us * US) return;
+    if (cfg.high_capacity && !hcs) return; /* SDHC stays idle without HCS */
+    idle = 0;
+    ccs = cfg.high_capacity;
+}
+
+/* Block number from a command argument; 0 on error with R1 queued */
+static uint8_t SdCard_Address(uint32_t arg)
+{
+    if (cfg.high_capacity) {
+        lba = arg;
+    } else if (arg % SD_CARD_SECTOR) {
+        stats.address_errors++;
+        SdCard_R1(R1_ADDRESS);
+        return 0;
+    } else {
+        lba = arg / SD_CARD_SECTOR;
+    }
+    if (lba >= cfg.sectors) {
+        stats.address_errors++;
+        SdCard_R1(R1_PARAM);
+        return 0;
+    }
+    return 1;
+}
+
+static void SdCard_Command(uint64_t now_ns)
+{
+    uint8_t cmd = cmd_buf[0] & 0x3F;
+    uint32_t arg = ((uint32_t)cmd_buf[1] << 24) | ((uint32_t)cmd_buf[2] << 16) |
+                   ((uint32_t)cmd_buf[3] << 8) | cmd_buf[4];
+    uint8_t is_app = app;
+    app = 0;
+
+    /* A new command cancels whatever was still queued */
+    resp_len = resp_pos = 0;
+    busy_after_ns = 0;
+    if (cmd == 12 && phase == PHASE_READ_MULTI) resp[resp_len++] = 0xFF; /* Stuff byte */
+    data_len = data_pos = 0;
+    if (phase == PHASE_READ || phase == PHASE_READ_MULTI) phase = PHASE_COMMAND;
+    for (uint8_t n = 0; n < cfg.ncr; n++) resp[resp_len++] = 0xFF;
+
+    /* CRC is off in SPI mode except for these two */
+    if ((cmd == 0 || cmd == 8) && cmd_buf[5] != (uint8_t)((SdCard_Crc7(cmd_buf, 5) << 1) | 1)) {
+        stats.crc_errors++;
+        SdCard_R1(R1_CRC);
+        return;
+    }
+
+    switch (cmd) {
+    case 0:     /* GO_IDLE_STATE */
+        idle = 1;
+        ccs = 0;
+        init_started = 0;
+        phase = PHASE_COMMAND;
+        SdCard_R1(0);
+        break;
+
+    case 1:     /* SEND_OP_COND */
+        SdCard_InitStep(now_ns, 0);
+        SdCard_R1(0);
+        break;
+
+    case 8:     /* SEND_IF_COND, R7 */
+        if (cfg.version < 2) {
+            SdCard_Illegal();
+            return;
+        }
+        SdCard_R1(0);
+        resp[resp_len++] = 0x00;
+        resp[resp_len++] = 0x00;
+        resp[resp_len++] = (uint8_t)((arg >> 8) & 0x0F);
+        resp[resp_len++] = (uint8_t)arg;
+        break;
+
+    case 41:    /* SD_SEND_OP_COND, only as ACMD41 */
+        if (!is_app) {
+            SdCard_Illegal();
+            return;
+        }
+        SdCard_InitStep(now_ns, (arg >> 30) & 1);
+        SdCard_R1(0);
+        break;
+
+    case 55:    /* APP_CMD */
+        app = 1;
+        SdCard_R1(0);
+        break;
+
+    case 58:    /* READ_OCR, R3 */
+        SdCard_R1(0);
+        resp[resp_len++] = (idle ? 0x00 : 0x80) | ((!idle && ccs) ? 0x40 : 0x00);
+        resp[resp_len++] = 0xFF;
+        resp[resp_len++] = 0x80;
+        resp[resp_len++] = 0x00;
+        break;
+
+    case 59:    /* CRC_ON_OFF */
+        SdCard_R1(0);
+        break;
+
+    default:
+        if (idle) {
+            /* Only the identification commands work before ACMD41 completes */
+            SdCard_Illegal();
+            return;
+        }
+        switch (cmd) {
+        case 9:     /* SEND_CSD */
+            SdCard_R1(0);
+            SdCard_QueueCsd();
+            break;
+
+        case 12:    /* STOP_TRANSMISSION, R1b */
+            SdCard_R1(0);
+            break;
+
+        case 13:    /* SEND_STATUS / ACMD13 SD_STATUS, R2 */
+            SdCard_R1(0);
+            resp[resp_len++] = 0x00;
+            if (is_app) {
+                uint8_t status[64];
+                memset(status, 0, sizeof(status));
+                status[10] = (uint8_t)(cfg.au_size << 4);
+                SdCard_QueuePacket(status, sizeof(status), 0, 0);
+            }
+            break;
+
+        case 16:    /* SET_BLOCKLEN */
+            SdCard_R1((cfg.high_capacity || arg == SD_CARD_SECTOR) ? 0 : R1_PARAM);
+            break;
+
+        case 17:    /* READ_SINGLE_BLOCK */
+        case 18:    /* READ_MULTIPLE_BLOCK */
+            if (!SdCard_Address(arg)) return;
+            SdCard_R1(0);
+            phase = (cmd == 18) ? PHASE_READ_MULTI : PHASE_READ;
+            SdCard_QueueBlock(now_ns + cfg.read_us * US);
+            break;
+
+        case 23:    /* SET_BLOCK_COUNT / ACMD23 pre-erase count */
+            SdCard_R1(0);
+            break;
+
+        case 24:    /* WRITE_BLOCK */
+        case 25:    /* WRITE_MULTIPLE_BLOCK */
+            if (!SdCard_Address(arg)) return;
+            SdCard_R1(0);
+            write_multi = (cmd == 25);
+            phase = PHASE_WRITE_TOKEN;
+            break;
+
+        case 32:    /* ERASE_WR_BLK_START */
+        case 33:    /* ERASE_WR_BLK_END */
+            if (!SdCard_Address(arg)) return;
+            if (cmd == 32) erase_start = lba; else erase_end = lba;
+            SdCard_R1(0);
+            break;
+
+        case 38:    /* ERASE, R1b */
+            for (uint32_t n = erase_start; n <= erase_end && n < cfg.sectors; n++) {
+                free(blocks[n]);
+                blocks[n] = NULL;
+                stats.erased_blocks++;
+            }
+            SdCard_R1(0);
+            busy_after_ns = cfg.erase_us * US;
+            break;
+
+        default:
+            SdCard_Illegal();
+            return;
+        }
+    }
+
+    if (is_app) stats.acmd[cmd]++; else stats.cmd[cmd]++;
+}
+
+static void SdCard_WriteBlock(void)
+{
+    resp_len = resp_pos = 0;
+    stats.data_in += SD_CARD_SECTOR;
+
+    if (lba >= cfg.sectors) {
+        resp[resp_len++] = DATA_WRITE_ERROR;
+        phase = PHASE_COMMAND;
+        return;
+    }
+    if (!blocks[lba]) blocks[lba] = (uint8_t *)malloc(SD_CARD_SECTOR);
+    memcpy(blocks[lba], rx_buf, SD_CARD_SECTOR);
+    lba++;
+    stats.blocks_written++;
+
+    uint32_t busy = write_multi ? cfg.multi_write_us : cfg.write_us;
+    write_count++;
+    if (cfg.stall_every && write_count % cfg.stall_every == 0) {
+        busy = cfg.stall_us;
+        stats.stalls++;
+    }
+    resp[resp_len++] = DATA_ACCEPTED;
+    busy_after_ns = busy * US;
+    phase = write_multi ? PHASE_WRITE_TOKEN : PHASE_COMMAND;
+}
+
+/* What the card drives on MISO for this byte */
+static uint8_t SdCard_Output(uint64_t now_ns)
+{
+    if (now_ns < busy_until_ns) {
+        stats.busy_bytes++;
+        return 0x00;
+    }
+    if (resp_pos < resp_len) {
+        uint8_t b = resp[resp_pos++];
+        if (resp_pos == resp_len && data_pos == data_len && busy_after_ns) {
+            busy_until_ns = now_ns + busy_after_ns;
+            busy_after_ns = 0;
+        }
+        return b;
+    }
+    if (data_pos < data_len) {
+        if (now_ns < data_at_ns) {
+            stats.latency_bytes++;
+            return 0xFF;
+        }
+        uint8_t b = data[data_pos++];
+        if (data_pos == data_len) {
+            if (data_is_block) {
+                stats.data_out += SD_CARD_SECTOR;
+                stats.blocks_read++;
+            }
+            if (phase == PHASE_READ_MULTI && data_is_block) {
+                lba++;
+                SdCard_QueueBlock(now_ns + cfg.read_us * US);
+            } else if (phase == PHASE_READ) {
+                phase = PHASE_COMMAND;
+            }
+        }
+        return b;
+    }
+    return 0xFF;
+}
+
+/* What the host drives on MOSI for this byte */
+static void SdCard_Input(uint8_t tx, uint64_t now_ns)
+{
+    if (phase == PHASE_WRITE_DATA) {
+        rx_buf[rx_count++] = tx;
+        if (rx_count == sizeof(rx_buf)) SdCard_WriteBlock();
+        return;
+    }
+    if (phase == PHASE_WRITE_TOKEN && cmd_len == 0) {
+        if (tx == (write_multi ? TOKEN_MULTI : TOKEN_SINGLE)) {
+            phase = PHASE_WRITE_DATA;
+            rx_count = 0;
+            return;
+        }
+        if (write_multi && tx == TOKEN_STOP) {
+            resp_len = resp_pos = 0;
+            resp[resp_len++] = 0xFF;
+            busy_after_ns = cfg.stop_us * US;
+            phase = PHASE_COMMAND;
+            return;
+        }
+    }
+
+    if (cmd_len == 0) {
+        /* Start bit 0, transmission bit 1; ignored while programming */
+        if ((tx & 0xC0) != 0x40 || now_ns < busy_until_ns) return;
+    }
+    cmd_buf[cmd_len++] = tx;
+    if (cmd_len == sizeof(cmd_buf)) {
+        cmd_len = 0;
+        if (phase == PHASE_WRITE_TOKEN) phase = PHASE_COMMAND;
+        SdCard_Command(now_ns);
+    }
+}
+
+void SdCard_Select(uint8_t sel, uint64_t now_ns)
+{
+    if (selected && !sel) {
+        /* Deselecting abandons a command and any read still in flight */
+        cmd_len = 0;
+        if (phase == PHASE_READ || phase == PHASE_READ_MULTI) phase = PHASE_COMMAND;
+        data_len = data_pos = 0;
+        resp_len = resp_pos = 0;
+        if (busy_after_ns) {
+            busy_until_ns = now_ns + busy_after_ns;
+            busy_after_ns = 0;
+        }
+    }
+    selected = sel;
+}
+
+uint8_t SdCard_Exchange(uint8_t tx, uint64_t now_ns)
+{
+    if (!cfg.present) return 0xFF;
+    if (!selected) {
+        stats.bytes_deselected++;
+        return 0xFF;
+    }
+    stats.bytes_selected++;
+
+    uint8_t rx = SdCard_Output(now_ns);
+    SdCard_Input(tx, now_ns);
+    return rx;
+}
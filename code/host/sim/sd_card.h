@@ -0,0 +1,78 @@
+/* ========================================
+   File: sd_card.h
+   SPI-Mode SD Card Model for Host Tests
+
+   Byte-level model of an SD card in SPI mode:
+   command framing and CRC7 on CMD0/CMD8, the
+   idle state and ACMD41 initialisation, R1/R1b/
+   R2/R3/R7 responses, single and multi-block
+   reads and writes with tokens and data responses,
+   CSD/SD status, erase, and time-based read
+   latency and programming busy. Time comes from
+   the caller (spi_bus.c) so the card can be slow
+   in simulated milliseconds while the host runs
+   at full speed.
+   ======================================== */
+
+#ifndef SD_CARD_H
+#define SD_CARD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SD_CARD_SECTOR          512
+
+typedef struct {
+    uint8_t present;            /* 0: nothing on the bus, MISO floats high */
+    uint8_t version;            /* 1: SDv1 (no CMD8), 2: SDv2 */
+    uint8_t high_capacity;      /* SDHC/SDXC: block addressing, CSD v2 */
+    uint32_t sectors;
+    uint8_t ncr;                /* 0xFF bytes before each response (1..8 on real cards) */
+    uint8_t au_size;            /* SD status AU_SIZE code, 9 = 4 MB */
+    uint32_t init_us;           /* Time ACMD41 keeps reporting idle; 0xFFFFFFFF never leaves */
+    uint32_t read_us;           /* Command to data token (NAC) */
+    uint32_t write_us;          /* Programming busy after a CMD24 block */
+    uint32_t multi_write_us;    /* Busy after each CMD25 block */
+    uint32_t stop_us;           /* Busy after the CMD25 stop token */
+    uint32_t erase_us;          /* Busy after CMD38 */
+    uint32_t stall_every;       /* Every Nth written block is slow, 0 = never */
+    uint32_t stall_us;          /* Busy of those blocks instead of the normal one */
+} SdCardConfig_t;
+
+typedef struct {
+    uint32_t cmd[64];           /* Commands accepted, by index */
+    uint32_t acmd[64];          /* Application commands (after CMD55) */
+    uint32_t illegal;           /* Illegal command in the current state */
+    uint32_t crc_errors;
+    uint32_t address_errors;
+    uint64_t bytes_selected;    /* Bytes clocked with CS low */
+    uint64_t bytes_deselected;
+    uint64_t busy_bytes;        /* Clocked while programming (card drives 0x00) */
+    uint64_t latency_bytes;     /* Clocked while a data token was pending */
+    uint64_t data_in;           /* Block payload bytes received */
+    uint64_t data_out;          /* Block payload bytes sent */
+    uint32_t blocks_written;
+    uint32_t blocks_read;
+    uint32_t stalls;
+    uint32_t erased_blocks;
+} SdCardStats_t;
+
+/* Function prototypes */
+void SdCard_DefaultConfig(SdCardConfig_t *config);
+int SdCard_Init(const SdCardConfig_t *config);
+void SdCard_Free(void);
+void SdCard_Select(uint8_t selected, uint64_t now_ns);
+uint8_t SdCard_Exchange(uint8_t tx, uint64_t now_ns);
+uint8_t SdCard_Busy(uint64_t now_ns);
+const uint8_t *SdCard_Block(uint32_t lba);
+const SdCardStats_t *SdCard_GetStats(void);
+void SdCard_ResetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SD_CARD_H */
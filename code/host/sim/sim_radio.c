@@ -0,0 +1,38 @@
+/* ========================================
+   File: sim_radio.c
+   Simulated nRF24 RX FIFO for the Host Benchmark
+
+   Same depth as the real chip, so a stalled
+   logger loses packets the same way.
+   ======================================== */
+
+#include "sim_radio.h"
+#include "nrf24.h"
+#include <string.h>
+
+static sentData_t fifo[SIM_RADIO_FIFO];
+static uint8_t head = 0;
+static uint8_t count = 0;
+
+/* Returns 1 if the FIFO was full and the packet was lost */
+uint8_t SimRadio_Push(const sentData_t *packet)
+{
+    if (count == SIM_RADIO_FIFO) return 1;
+    fifo[(head + count) % SIM_RADIO_FIFO] = *packet;
+    count++;
+    return 0;
+}
+
+uint8_t nRF24_RxFifoEmpty(void)
+{
+    return count == 0;
+}
+
+void nRF24_ReadPayload(uint8_t *data, uint8_t length)
+{
+    if (count == 0) return;
+    if (length > sizeof(sentData_t)) length = sizeof(sentData_t);
+    memcpy(data, &fifo[head], length);
+    head = (head + 1) % SIM_RADIO_FIFO;
+    count--;
+}
@@ -0,0 +1,24 @@
+/* ========================================
+   File: sim_radio.h
+   Simulated nRF24 RX FIFO for the Host Benchmark
+   ======================================== */
+
+#ifndef SIM_RADIO_H
+#define SIM_RADIO_H
+
+#include "main.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIM_RADIO_FIFO          3
+
+/* Function prototypes */
+uint8_t SimRadio_Push(const sentData_t *packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_RADIO_H */
@@ -0,0 +1,133 @@
+/* ========================================
+   File: spi_bus.c
+   SPI2 and SD Chip Select Mock for Host Tests
+   ======================================== */
+
+#include "spi_bus.h"
+#include "sd_card.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+static SPI_TypeDef sim_spi2;
+SPI_HandleTypeDef hspi2 = { &sim_spi2, { SPI_BAUDRATEPRESCALER_2 } };
+GPIO_TypeDef sim_gpiob;
+
+static SpiBusConfig_t cfg;
+static SpiBusStats_t stats;
+static uint64_t now_ns = 0;
+
+void SpiBus_DefaultConfig(SpiBusConfig_t *config)
+{
+    /* F446 at 180 MHz: APB1 45 MHz, a HAL call is ~250 cycles */
+    config->pclk_hz = 45000000;
+    config->call_ns = 1400;
+    config->dma_ns = 3000;
+    config->gpio_ns = 100;
+}
+
+void SpiBus_Init(const SpiBusConfig_t *config)
+{
+    cfg = *config;
+    now_ns = 0;
+    sim_tick = 0;
+    sim_spi2.CR1 = 0;
+    hspi2.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_2;
+    sim_gpiob.ODR = GPIO_PIN_12;
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint64_t SpiBus_Now(void)
+{
+    return now_ns;
+}
+
+static void SpiBus_Advance(uint64_t ns)
+{
+    now_ns += ns;
+    sim_tick = (uint32_t)(now_ns / 1000000);
+}
+
+void SpiBus_Idle(uint64_t ns)
+{
+    stats.idle_ns += ns;
+    SpiBus_Advance(ns);
+}
+
+const SpiBusStats_t *SpiBus_GetStats(void)
+{
+    return &stats;
+}
+
+void SpiBus_ResetStats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+static void SpiBus_Overhead(uint32_t ns)
+{
+    stats.overhead_ns += ns;
+    SpiBus_Advance(ns);
+}
+
+/* BR[2:0] selects pclk / 2^(BR+1) */
+static uint64_t SpiBus_ByteNs(SPI_HandleTypeDef *hspi)
+{
+    uint32_t div = 2U << ((hspi->Instance->CR1 & SPI_CR1_BR) >> 3);
+    return 8ULL * div * 1000000000ULL / cfg.pclk_hz;
+}
+
+static void SpiBus_Clock(SPI_HandleTypeDef *hspi, const uint8_t *tx, uint8_t *rx, uint16_t size)
+{
+    uint64_t byte_ns = SpiBus_ByteNs(hspi);
+    hspi->Instance->CR1 |= SPI_CR1_SPE;
+    for (uint16_t i = 0; i < size; i++) {
+        uint8_t b = SdCard_Exchange(tx ? tx[i] : 0xFF, now_ns);
+        if (rx) rx[i] = b;
+        stats.wire_ns += byte_ns;
+        SpiBus_Advance(byte_ns);
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout)
+{
+    (void)Timeout;
+    stats.calls++;
+    stats.call_bytes += Size;
+    SpiBus_Overhead(cfg.call_ns);
+    SpiBus_Clock(hspi, pTxData, pRxData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+    stats.dma_transfers++;
+    stats.dma_bytes += Size;
+    SpiBus_Overhead(cfg.dma_ns);
+    SpiBus_Clock(hspi, pData, NULL, Size);
+    HAL_SPI_TxCpltCallback(hspi);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size)
+{
+    stats.dma_transfers++;
+    stats.dma_bytes += Size;
+    SpiBus_Overhead(cfg.dma_ns);
+    SpiBus_Clock(hspi, pTxData, pRxData, Size);
+    HAL_SPI_TxRxCpltCallback(hspi);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    return HAL_OK;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    stats.cs_writes++;
+    SpiBus_Overhead(cfg.gpio_ns);
+    if (PinState == GPIO_PIN_SET) GPIOx->ODR |= GPIO_Pin; else GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    if (GPIOx == GPIOB && GPIO_Pin == GPIO_PIN_12) SdCard_Select(PinState == GPIO_PIN_RESET, now_ns);
+}
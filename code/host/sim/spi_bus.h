@@ -0,0 +1,53 @@
+/* ========================================
+   File: spi_bus.h
+   SPI2 and SD Chip Select Mock for Host Tests
+
+   Implements the HAL_SPI_* and HAL_GPIO_WritePin
+   calls fatfs_sd.c makes, clocking every byte
+   through the card model (sd_card.c). Owns the
+   simulation clock: each byte costs its wire time
+   at the prescaler the driver selected, and each
+   HAL call a fixed CPU overhead, so HAL_GetTick()
+   timeouts in the driver run in simulated time.
+   ======================================== */
+
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t pclk_hz;           /* SPI2 kernel clock (APB1) */
+    uint32_t call_ns;           /* CPU cost of one blocking HAL_SPI_TransmitReceive */
+    uint32_t dma_ns;            /* DMA setup plus the completion interrupt */
+    uint32_t gpio_ns;           /* HAL_GPIO_WritePin */
+} SpiBusConfig_t;
+
+typedef struct {
+    uint64_t calls;             /* Blocking transfers */
+    uint64_t call_bytes;
+    uint64_t dma_transfers;
+    uint64_t dma_bytes;
+    uint64_t cs_writes;
+    uint64_t wire_ns;           /* Bytes on the wire */
+    uint64_t overhead_ns;       /* HAL call, DMA and GPIO cost */
+    uint64_t idle_ns;           /* SpiBus_Idle, time the caller spent elsewhere */
+} SpiBusStats_t;
+
+/* Function prototypes */
+void SpiBus_DefaultConfig(SpiBusConfig_t *config);
+void SpiBus_Init(const SpiBusConfig_t *config);
+uint64_t SpiBus_Now(void);
+void SpiBus_Idle(uint64_t ns);
+const SpiBusStats_t *SpiBus_GetStats(void);
+void SpiBus_ResetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPI_BUS_H */
@@ -0,0 +1,96 @@
+/* ========================================
+   File: stm32f4xx_hal.h
+   Host Stand-In for the STM32 HAL
+
+   Just enough of the HAL for the wrist logging
+   sources and fatfs_sd.c to build on Linux. The
+   tick is the simulation clock, advanced by the
+   benchmark or by the SPI bus model (spi_bus.c).
+   ======================================== */
+
+#ifndef SIM_STM32F4XX_HAL_H
+#define SIM_STM32F4XX_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __weak
+#define __weak __attribute__((weak))
+#endif
+
+#define UNUSED(X) (void)X
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+#define MODIFY_REG(reg, clear, set) ((reg) = ((reg) & ~(clear)) | (set))
+#define __WFI() ((void)0)
+
+extern volatile uint32_t sim_tick;
+
+static inline uint32_t HAL_GetTick(void) { return sim_tick; }
+
+/* GPIO: only chip selects are modelled */
+typedef struct {
+    uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef sim_gpiob;
+#define GPIOB                   (&sim_gpiob)
+#define GPIO_PIN_12             ((uint16_t)0x1000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+
+/* SPI: transfers complete immediately, DMA callbacks included */
+typedef struct {
+    uint32_t CR1;
+} SPI_TypeDef;
+
+typedef struct {
+    uint32_t BaudRatePrescaler;
+} SPI_InitTypeDef;
+
+typedef struct {
+    SPI_TypeDef *Instance;
+    SPI_InitTypeDef Init;
+} SPI_HandleTypeDef;
+
+#define SPI_CR1_SPE             0x0040U
+#define SPI_CR1_BR              0x0038U
+#define SPI_BAUDRATEPRESCALER_2     0x0000U
+#define SPI_BAUDRATEPRESCALER_4     0x0008U
+#define SPI_BAUDRATEPRESCALER_8     0x0010U
+#define SPI_BAUDRATEPRESCALER_16    0x0018U
+#define SPI_BAUDRATEPRESCALER_32    0x0020U
+#define SPI_BAUDRATEPRESCALER_64    0x0028U
+#define SPI_BAUDRATEPRESCALER_128   0x0030U
+#define SPI_BAUDRATEPRESCALER_256   0x0038U
+
+#define __HAL_SPI_DISABLE(h)    ((h)->Instance->CR1 &= ~SPI_CR1_SPE)
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_STM32F4XX_HAL_H */
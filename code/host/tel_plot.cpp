@@ -0,0 +1,322 @@
+/* ========================================
+   File: tel_plot.cpp
+   Ankle Telemetry Decoder and Plotter
+
+   Reads the ankle's USART2 stream (telemetry.h
+   frames) from a serial port, a capture file or
+   stdin. Text, step and radio frames are printed
+   as lines; gyro samples are drawn as a terminal
+   plot of diff against the step threshold (-p)
+   and/or written to a CSV (-c). Energy frames
+   print charge and battery life, and can be saved
+   as a trace for energy_est (-e), followed by the
+   scheduler's dispatch stats: how long sampling
+   waited behind other handlers. Unframed text,
+   such as the setup messages before the first
+   delimiter, is passed through. Frame counts, CRC
+   failures and sequence gaps are printed at the
+   end of the stream or on Ctrl-C.
+
+   Usage: tel_plot [-b BAUD] [-p] [-c CSV] [-e TRACE] [-q] [DEVICE|FILE|-]
+     -b  serial speed when reading a tty (default 115200)
+     -p  plot every sample
+     -e  append energy trace lines to TRACE
+     -q  no text, step, radio, energy or scheduler lines
+   ======================================== */
+
+extern "C" {
+#include "telemetry.h"
+}
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int kPlotWidth = 64;
+constexpr size_t kMaxBlock = 4096;      // Longer runs without a delimiter are line noise
+
+// The ankle's EV_ order in main.c; unused slots are skipped
+const char *const kEventNames[TEL_SCHED_EVENTS] = { "sample", "sample_done", "detect", "batch",
+                                                    "radio", "energy", "profile", nullptr };
+
+volatile std::sig_atomic_t stop = 0;
+
+struct Stats {
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t per_channel[8] = {};
+    uint64_t bad = 0;           // COBS or CRC failures
+    uint64_t lost = 0;          // Sequence gaps
+    uint64_t unframed = 0;      // Printable blocks passed through
+};
+
+struct Decoder {
+    bool plot = false;
+    bool quiet = false;
+    FILE *csv = nullptr;
+    FILE *trace = nullptr;
+    Stats stats;
+    bool synced = false;
+    uint8_t next_seq = 0;
+    TelConfig_t config = { 20, 5731, 3275 };    // Firmware defaults until a config frame arrives
+
+    double Dps(int32_t raw) const { return raw * 100.0 / config.lsb_per_dps_x100; }
+
+    void Line(const char *text, size_t len)
+    {
+        while (len > 0 && (text[len - 1] == '\r' || text[len - 1] == '\n')) len--;
+        std::printf("%.*s\n", int(len), text);
+    }
+
+    void Plot(const TelSample_t &s)
+    {
+        const double full = Dps(config.threshold) * 2;
+        const double diff = Dps(s.diff);
+        const int at = std::min(kPlotWidth - 1, int(diff / full * kPlotWidth));
+        const int th = kPlotWidth / 2;
+        char bar[kPlotWidth + 1];
+
+        for (int i = 0; i < kPlotWidth; i++) bar[i] = i < at ? (s.diff >= config.threshold ? '#' : '=') : ' ';
+        if (bar[th] == ' ') bar[th] = '|';
+        bar[kPlotWidth] = 0;
+        std::printf("%12.3f %7.1f %s\n", s.time_us / 1000.0, diff, bar);
+    }
+
+    void Frame(const uint8_t *frame, int32_t len)
+    {
+        const uint8_t channel = frame[0];
+        const uint8_t seq = frame[1];
+        const uint8_t *p = frame + TEL_HEADER;
+
+        if (synced) stats.lost += uint8_t(seq - next_seq);
+        synced = true;
+        next_seq = uint8_t(seq + 1);
+        stats.frames++;
+        stats.per_channel[channel & 7]++;
+
+        switch (channel) {
+        case TEL_CH_TEXT:
+            if (!quiet) Line(reinterpret_cast<const char *>(p), size_t(len));
+            break;
+        case TEL_CH_CONFIG:
+            if (len == sizeof(TelConfig_t)) std::memcpy(&config, p, sizeof(config));
+            break;
+        case TEL_CH_SAMPLE: {
+            if (len != sizeof(TelSample_t)) break;
+            TelSample_t s;
+            std::memcpy(&s, p, sizeof(s));
+            if (plot) Plot(s);
+            if (csv) {
+                std::fprintf(csv, "%.3f,%.2f,%.2f,%.2f,%.2f\n", s.time_us / 1000.0, Dps(s.gy), Dps(s.gz), Dps(s.diff),
+                             Dps(config.threshold));
+            }
+            break;
+        }
+        case TEL_CH_STEP: {
+            if (len != sizeof(TelStep_t) || quiet) break;
+            TelStep_t s;
+            std::memcpy(&s, p, sizeof(s));
+            std::printf("step %u at %.3f ms: period %.3f ms, intensity %u dps\n", s.count, s.time_us / 1000.0,
+                        s.period_us / 1000.0, s.intensity);
+            break;
+        }
+        case TEL_CH_RADIO: {
+            if (len != sizeof(TelRadio_t) || quiet) break;
+            TelRadio_t r;
+            std::memcpy(&r, p, sizeof(r));
+            std::printf(">> %s from step %u: %s\n", r.partial ? "TIMEOUT FLUSH" : "FULL BATCH", r.step_initial_count,
+                        r.ok ? "OK" : "FAILED, retrying in 5 s");
+            break;
+        }
+        case TEL_CH_ENERGY: {
+            if (len != sizeof(TelEnergy_t)) break;
+            TelEnergy_t t;
+            EnergyReport_t r = {};
+            char line[256];
+            std::memcpy(&t, p, sizeof(t));
+            r.uptime_ms = t.uptime_ms;
+            r.base_ua = t.base_ua;
+            r.battery_uah = t.battery_uah;
+            std::memcpy(r.state_ms, t.state_ms, sizeof(r.state_ms));
+            std::memcpy(r.state_ua, t.state_ua, sizeof(r.state_ua));
+            Energy_Estimate(&r);
+            if (!quiet) Line(line, size_t(Energy_FormatSummary(&r, line, sizeof(line))));
+            if (trace) {
+                const int n = Energy_FormatTrace(&r, line, sizeof(line));
+                std::fprintf(trace, "%.*s\n", n - 2, line);
+                std::fflush(trace);
+            }
+            break;
+        }
+        case TEL_CH_SCHED: {
+            if (len != sizeof(TelSched_t) || quiet) break;
+            TelSched_t t;
+            std::memcpy(&t, p, sizeof(t));
+            std::printf("sched: sample waited up to %u ms (%u runs, %u overruns), %u sleeps\n",
+                        t.event[0].max_wait_ms, t.event[0].runs, t.event[0].overruns, t.sleeps);
+            for (int i = 1; i < TEL_SCHED_EVENTS; i++) {
+                const TelSchedEvent_t &e = t.event[i];
+                if (!kEventNames[i] || e.runs == 0) continue;
+                std::printf("  %-12s %8u runs, %u overruns, wait max %u ms, run max %u ms\n", kEventNames[i], e.runs,
+                            e.overruns, e.max_wait_ms, e.max_run_ms);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // One block between delimiters
+    void Block(const std::vector<uint8_t> &block)
+    {
+        if (block.empty()) return;
+
+        uint8_t frame[TEL_MAX_FRAME];
+        if (block.size() < sizeof(frame)) {
+            const int32_t len = Tel_Unframe(block.data(), uint16_t(block.size()), frame);
+            if (len >= 0) {
+                Frame(frame, len);
+                return;
+            }
+        }
+
+        const bool printable = std::all_of(block.begin(), block.end(), [](uint8_t c) {
+            return c == '\r' || c == '\n' || (c >= 0x20 && c < 0x7F);
+        });
+        if (printable) {
+            stats.unframed++;
+            if (!quiet) std::fwrite(block.data(), 1, block.size(), stdout);
+        } else {
+            stats.bad++;
+        }
+    }
+};
+
+speed_t Baud(long baud)
+{
+    switch (baud) {
+    case 9600: return B9600;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B0;
+    }
+}
+
+bool ConfigureTty(int fd, long baud)
+{
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0) return false;
+    cfmakeraw(&tio);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    return cfsetspeed(&tio, Baud(baud)) == 0 && tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+void OnSignal(int)
+{
+    stop = 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Decoder dec;
+    const char *path = "-";
+    const char *csv_path = nullptr;
+    const char *trace_path = nullptr;
+    long baud = 115200;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            baud = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "-p") == 0) {
+            dec.plot = true;
+        } else if (std::strcmp(argv[i], "-q") == 0) {
+            dec.quiet = true;
+        } else if (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0) {
+            path = argv[i];
+        } else {
+            std::fprintf(stderr, "usage: %s [-b BAUD] [-p] [-c CSV] [-e TRACE] [-q] [DEVICE|FILE|-]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const int fd = std::strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        std::fprintf(stderr, "cannot open %s\n", path);
+        return 1;
+    }
+    if (isatty(fd) && !ConfigureTty(fd, baud)) {
+        std::fprintf(stderr, "cannot set %s to %ld baud\n", path, baud);
+        return 1;
+    }
+    if (csv_path) {
+        dec.csv = std::fopen(csv_path, "w");
+        if (!dec.csv) {
+            std::fprintf(stderr, "cannot create %s\n", csv_path);
+            return 1;
+        }
+        std::fprintf(dec.csv, "time_ms,gy_dps,gz_dps,diff_dps,threshold_dps\n");
+    }
+    if (trace_path) {
+        dec.trace = std::fopen(trace_path, "a");
+        if (!dec.trace) {
+            std::fprintf(stderr, "cannot open %s\n", trace_path);
+            return 1;
+        }
+    }
+
+    struct sigaction sa = {};
+    sa.sa_handler = OnSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    std::vector<uint8_t> block;
+    uint8_t buf[4096];
+    while (!stop) {
+        const ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        dec.stats.bytes += uint64_t(n);
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] == 0) {
+                dec.Block(block);
+                block.clear();
+            } else if (block.size() < kMaxBlock) {
+                block.push_back(buf[i]);
+            }
+        }
+        std::fflush(stdout);
+    }
+    dec.Block(block);
+
+    if (dec.csv) std::fclose(dec.csv);
+    if (dec.trace) std::fclose(dec.trace);
+    const Stats &st = dec.stats;
+    std::fprintf(stderr, "\n%llu bytes, %llu frames (%llu text, %llu sample, %llu step, %llu radio, %llu energy, "
+                 "%llu sched), %llu lost, %llu bad, %llu unframed\n",
+                 (unsigned long long)st.bytes, (unsigned long long)st.frames,
+                 (unsigned long long)st.per_channel[TEL_CH_TEXT], (unsigned long long)st.per_channel[TEL_CH_SAMPLE],
+                 (unsigned long long)st.per_channel[TEL_CH_STEP], (unsigned long long)st.per_channel[TEL_CH_RADIO],
+                 (unsigned long long)st.per_channel[TEL_CH_ENERGY], (unsigned long long)st.per_channel[TEL_CH_SCHED],
+                 (unsigned long long)st.lost, (unsigned long long)st.bad, (unsigned long long)st.unframed);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* ========================================
+   File: FreeRTOSConfig.h
+   FreeRTOS Configuration for the Wrist Node
+
+   Kernel: FreeRTOS V10 from STM32CubeF4
+   (Middlewares/Third_Party/FreeRTOS/Source with
+   portable/GCC/ARM_CM4F). Everything is allocated
+   statically, so no heap_x.c is linked. SysTick
+   stays the HAL timebase and also drives the
+   kernel tick; HAL_GetTick follows the kernel
+   once it runs (rtos_support.c), so tickless idle
+   does not lose time. The FREERTOS middleware
+   entry in wrist_rx.ioc carries the same values;
+   change both together.
+   ======================================== */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+#include <stdint.h>
+extern uint32_t SystemCoreClock;
+uint32_t Rtos_RunTimeCounter(void);
+void Rtos_RunTimeInit(void);
+#endif
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 1
+#define configUSE_TICKLESS_IDLE                 1
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+#define configCPU_CLOCK_HZ                      (SystemCoreClock)
+#define configTICK_RATE_HZ                      ((TickType_t)1000)
+#define configMAX_PRIORITIES                    7
+#define configMINIMAL_STACK_SIZE                ((uint16_t)128)
+#define configMAX_TASK_NAME_LEN                 8
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             0
+#define configUSE_COUNTING_SEMAPHORES           0
+#define configQUEUE_REGISTRY_SIZE               0
+#define configUSE_QUEUE_SETS                    0
+#define configUSE_TIME_SLICING                  0
+#define configUSE_NEWLIB_REENTRANT              1
+#define configENABLE_BACKWARD_COMPATIBILITY     0
+
+/* Memory: static only */
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        0
+
+/* Hooks */
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configCHECK_FOR_STACK_OVERFLOW          2
+
+/* Run-time and task stats: DWT cycle counter, see rtos_support.c */
+#define configGENERATE_RUN_TIME_STATS           1
+#define configUSE_TRACE_FACILITY                1
+#define configUSE_STATS_FORMATTING_FUNCTIONS    0
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() Rtos_RunTimeInit()
+#define portGET_RUN_TIME_COUNTER_VALUE()        Rtos_RunTimeCounter()
+
+/* No co-routines, no software timers */
+#define configUSE_CO_ROUTINES                   0
+#define configUSE_TIMERS                        0
+
+/* Optional functions */
+#define INCLUDE_vTaskPrioritySet                0
+#define INCLUDE_uxTaskPriorityGet               0
+#define INCLUDE_vTaskDelete                     0
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_vTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+
+/* Cortex-M interrupt priorities (4 bits on STM32F4) */
+#ifdef __NVIC_PRIO_BITS
+#define configPRIO_BITS                         __NVIC_PRIO_BITS
+#else
+#define configPRIO_BITS                         4
+#endif
+
+/* Lowest priority, for SysTick and PendSV */
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY         15
+
+/* Interrupts that call FromISR functions must be at this level or lower
+   urgency (numerically >= 5): the SPI2 DMA streams and USART2 */
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY    5
+
+#define configKERNEL_INTERRUPT_PRIORITY         (configLIBRARY_LOWEST_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY    (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+
+#define configASSERT(x) if ((x) == 0) { taskDISABLE_INTERRUPTS(); for (;;); }
+
+/* SVC and PendSV go straight to the port; SysTick_Handler in stm32f4xx_it.c
+   also advances the HAL tick, so it calls xPortSysTickHandler itself */
+#define vPortSVCHandler     SVC_Handler
+#define xPortPendSVHandler  PendSV_Handler
+
+#endif /* FREERTOS_CONFIG_H */
@@ -17,6 +17,7 @@
 #define MAX30102_INT_ENABLE_1   0x02
 #define MAX30102_INT_ENABLE_2   0x03
 #define MAX30102_FIFO_WR_PTR    0x04
+#define MAX30102_FIFO_OVF_CNT   0x05
 #define MAX30102_FIFO_RD_PTR    0x06
 #define MAX30102_FIFO_DATA      0x07
 #define MAX30102_FIFO_CONFIG    0x08
@@ -26,14 +27,21 @@
 #define MAX30102_LED2_PA        0x0D
 #define MAX30102_TEMP_INT       0x1F
 #define MAX30102_TEMP_FRAC      0x20
+#define MAX30102_TEMP_CONFIG    0x21
 #define MAX30102_REV_ID         0xFE
 #define MAX30102_PART_ID        0xFF
 
+/* FIFO output: 100 sps (SPO2_CONFIG 0x27) averaged 4 to 1 (FIFO_CONFIG 0x4F) */
+#define MAX30102_SAMPLE_HZ      25
+#define MAX30102_FIFO_DEPTH     32
+
 /* Function prototypes */
 uint8_t MAX30102_Init(I2C_HandleTypeDef *hi2c);
-uint8_t MAX30102_ReadFIFO(uint32_t *ir_value, uint32_t *red_value);
-float MAX30102_ReadTemperature(void);
-void MAX30102_CalculateHeartRate(uint32_t ir_value, int32_t *heart_rate, uint8_t *valid);
+uint8_t MAX30102_ReadFIFO(uint32_t *ir_values, uint32_t *red_values, uint8_t max);
+uint8_t MAX30102_IsOnWrist(void);
+void MAX30102_StartTemperature(void);
+uint8_t MAX30102_GetTemperature(float *temperature);
+void MAX30102_CalculateHeartRate(const uint32_t *ir, uint8_t n, uint32_t first_us, int32_t *heart_rate, uint8_t *valid);
 void MAX30102_CalculateSpO2(uint32_t ir_value, uint32_t red_value, int32_t *spo2, uint8_t *valid);
 
 #endif
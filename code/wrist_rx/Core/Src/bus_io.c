@@ -0,0 +1,137 @@
+/* ========================================
+   File: bus_io.c
+   Interrupt-driven I2C Transfers
+   ======================================== */
+
+#include "bus_io.h"
+#include "rtos_support.h"
+#include "energy.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+typedef struct {
+    I2C_HandleTypeDef *hi2c;
+    TaskHandle_t waiter;        /* NULL: caller sleeps in WFI */
+    volatile uint8_t done;
+    volatile uint8_t error;
+} BusWait_t;
+
+static BusWait_t waits[BUS_MAX_HANDLES];
+static BusStats_t stats;
+
+/* Slots are bound on first use, which happens in main() before any interrupt can look them up */
+static BusWait_t *Bus_Find(I2C_HandleTypeDef *hi2c, uint8_t bind)
+{
+    for (uint8_t i = 0; i < BUS_MAX_HANDLES; i++) {
+        if (waits[i].hi2c == hi2c) return &waits[i];
+        if (waits[i].hi2c == NULL && bind) {
+            waits[i].hi2c = hi2c;
+            return &waits[i];
+        }
+    }
+    return NULL;
+}
+
+static BusWait_t *Bus_Arm(I2C_HandleTypeDef *hi2c)
+{
+    BusWait_t *w = Bus_Find(hi2c, 1);
+    if (w == NULL) Error_Handler();
+
+    w->done = 0;
+    w->error = 0;
+    w->waiter = Rtos_InTask() ? xTaskGetCurrentTaskHandle() : NULL;
+    Energy_On(ENERGY_I2C);
+    return w;
+}
+
+/* The bus counts as busy until the waiter sees the end, wakeup included */
+static HAL_StatusTypeDef Bus_Finish(BusWait_t *w, HAL_StatusTypeDef result)
+{
+    w->waiter = NULL;
+    Energy_Off(ENERGY_I2C);
+    return result;
+}
+
+static HAL_StatusTypeDef Bus_Wait(BusWait_t *w, HAL_StatusTypeDef started, uint32_t timeout_ms)
+{
+    uint32_t start = HAL_GetTick();
+
+    stats.transfers++;
+    if (started != HAL_OK) {
+        stats.errors++;
+        return Bus_Finish(w, started);
+    }
+
+    /* A notification left over from an earlier timeout only costs one extra pass */
+    while (!w->done) {
+        uint32_t waited = HAL_GetTick() - start;
+        if (waited >= timeout_ms) {
+            /* A stuck slave or lost callback: restart the peripheral so the next transfer starts clean */
+            w->waiter = NULL;
+            HAL_I2C_DeInit(w->hi2c);
+            HAL_I2C_Init(w->hi2c);
+            stats.timeouts++;
+            return Bus_Finish(w, HAL_TIMEOUT);
+        }
+        if (w->waiter != NULL) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms - waited));
+        } else {
+            __WFI();
+        }
+    }
+
+    if (w->error) {
+        stats.errors++;
+        return Bus_Finish(w, HAL_ERROR);
+    }
+    return Bus_Finish(w, HAL_OK);
+}
+
+static void Bus_Resume(I2C_HandleTypeDef *hi2c, uint8_t error)
+{
+    BusWait_t *w = Bus_Find(hi2c, 0);
+    BaseType_t woken = pdFALSE;
+
+    if (w == NULL) return;
+    w->error = error;
+    w->done = 1;
+    if (w->waiter != NULL) {
+        vTaskNotifyGiveFromISR(w->waiter, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+HAL_StatusTypeDef Bus_I2C_MemRead(I2C_HandleTypeDef *hi2c, uint16_t addr, uint8_t reg, uint8_t *data, uint16_t len,
+                                  uint32_t timeout_ms)
+{
+    BusWait_t *w = Bus_Arm(hi2c);
+    return Bus_Wait(w, HAL_I2C_Mem_Read_IT(hi2c, addr, reg, I2C_MEMADD_SIZE_8BIT, data, len), timeout_ms);
+}
+
+HAL_StatusTypeDef Bus_I2C_MemWrite(I2C_HandleTypeDef *hi2c, uint16_t addr, uint8_t reg, uint8_t *data, uint16_t len,
+                                   uint32_t timeout_ms)
+{
+    BusWait_t *w = Bus_Arm(hi2c);
+    return Bus_Wait(w, HAL_I2C_Mem_Write_IT(hi2c, addr, reg, I2C_MEMADD_SIZE_8BIT, data, len), timeout_ms);
+}
+
+const BusStats_t *Bus_GetStats(void)
+{
+    return &stats;
+}
+
+/* HAL completion callbacks, I2C interrupt context */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    Bus_Resume(hi2c, 0);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    Bus_Resume(hi2c, 0);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    Bus_Resume(hi2c, 1);
+}
@@ -0,0 +1,34 @@
+/* ========================================
+   File: bus_io.h
+   Interrupt-driven I2C Transfers
+
+   Each call starts the transfer in interrupt mode
+   and blocks the calling task, not the CPU: the
+   HAL completion callback wakes it, and other tasks
+   (or tickless idle) run meanwhile. Before the
+   scheduler starts the caller sleeps in WFI
+   instead. One task per bus.
+   ======================================== */
+
+#ifndef BUS_IO_H
+#define BUS_IO_H
+
+#include "main.h"
+
+/* I2C handles that can have a transfer in flight */
+#define BUS_MAX_HANDLES         2
+
+typedef struct {
+    uint32_t transfers;
+    uint32_t errors;            /* NACK, arbitration loss, bus error */
+    uint32_t timeouts;          /* No completion callback in time; transfer aborted */
+} BusStats_t;
+
+/* Function prototypes */
+HAL_StatusTypeDef Bus_I2C_MemRead(I2C_HandleTypeDef *hi2c, uint16_t addr, uint8_t reg, uint8_t *data, uint16_t len,
+                                  uint32_t timeout_ms);
+HAL_StatusTypeDef Bus_I2C_MemWrite(I2C_HandleTypeDef *hi2c, uint16_t addr, uint8_t reg, uint8_t *data, uint16_t len,
+                                   uint32_t timeout_ms);
+const BusStats_t *Bus_GetStats(void);
+
+#endif /* BUS_IO_H */
@@ -0,0 +1,73 @@
+/* ========================================
+   File: energy.h
+   Power-state Accounting Shared by Ankle and Wrist Nodes
+
+   The core is in exactly one of sleep, stop or
+   active; peripheral states (I2C busy, radio TX/RX,
+   SD busy, LED on) overlap it and each other and
+   are timed while switched on. Active time is the
+   DWT cycle count, which only runs while the core
+   is clocked; sleep is the rest of the TIM2 time
+   (timebase.h). Charge is the node's base current for the whole
+   uptime plus each state's extra current for its
+   time, from the node's energy_table.h (currents
+   at the 5 V input, as in the power spreadsheet).
+   Reports and trace lines also build on the host.
+   Keep both node copies of energy.h/energy.c identical.
+   ======================================== */
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+
+/* X(id, name): core states first, then peripheral states; names go into trace lines */
+#define ENERGY_STATES(X) \
+    X(ENERGY_SLEEP,    "sleep")    /* Core in WFI, clocks running */ \
+    X(ENERGY_STOP,     "stop")     /* Core in STOP, reported through Energy_Stopped */ \
+    X(ENERGY_ACTIVE,   "active")   /* Core executing */ \
+    X(ENERGY_I2C,      "i2c")      /* Transfer in flight on the sensor bus */ \
+    X(ENERGY_RADIO_TX, "radio_tx") /* nRF24 transmitting or waiting for the ACK */ \
+    X(ENERGY_RADIO_RX, "radio_rx") /* nRF24 listening */ \
+    X(ENERGY_SD,       "sd")       /* SD driver working the card */ \
+    X(ENERGY_LED,      "led")      /* Status LED lit */
+
+typedef enum {
+#define ENERGY_ENUM(id, name) id,
+    ENERGY_STATES(ENERGY_ENUM)
+#undef ENERGY_ENUM
+    ENERGY_COUNT
+} EnergyState_t;
+
+/* States from here on overlap the core states */
+#define ENERGY_FIRST_PERIPHERAL ENERGY_I2C
+
+typedef struct {
+    uint32_t uptime_ms;
+    uint32_t base_ua;
+    uint32_t battery_uah;
+    uint32_t state_ms[ENERGY_COUNT];
+    uint32_t state_ua[ENERGY_COUNT];
+    /* Filled in by Energy_Estimate */
+    uint32_t charge_uah;
+    uint32_t avg_ua;
+    uint32_t runtime_min;       /* Battery left at avg_ua */
+} EnergyReport_t;
+
+/* Function prototypes */
+const char *Energy_Name(EnergyState_t state);
+void Energy_Estimate(EnergyReport_t *r);
+int Energy_FormatTrace(const EnergyReport_t *r, char *buf, int size);
+int Energy_FormatSummary(const EnergyReport_t *r, char *buf, int size);
+
+#if defined(__arm__)
+void Energy_Init(void);
+void Energy_On(EnergyState_t state);
+void Energy_Off(EnergyState_t state);
+void Energy_Set(EnergyState_t state, uint8_t on);
+void Energy_Stopped(uint32_t us);
+void Energy_Update(void);
+void Energy_Report(EnergyReport_t *r);
+#endif
+
+#endif /* ENERGY_H */
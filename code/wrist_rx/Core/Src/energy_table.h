@@ -0,0 +1,33 @@
+/* ========================================
+   File: energy_table.h
+   Wrist Node Current Table
+
+   uA at the 5 V input for energy.c. Base and
+   active come from the power spreadsheet
+   (documents/POWER_CONS & SIZE_DATA.xlsx); the
+   rest are datasheet typicals until measured.
+   ======================================== */
+
+#ifndef ENERGY_TABLE_H
+#define ENERGY_TABLE_H
+
+/* Always drawn: MAX30102 module 2 mA, SD module regulator and card standby */
+#define ENERGY_BASE_UA          3500
+
+/* 850 mAh cell at 3.2 V behind the 5 V boost, counted as the spreadsheet
+   does (850 * 3.2 / 5) */
+#define ENERGY_BATTERY_UAH      544000
+
+/* Added on top of the base while in each state */
+#define ENERGY_CURRENTS_UA { \
+    [ENERGY_SLEEP]    = 20000, /* F446 at 180 MHz in WFI, peripherals clocked */ \
+    [ENERGY_STOP]     = 600,   /* Not entered yet */ \
+    [ENERGY_ACTIVE]   = 55000, /* Spreadsheet, MCU without low-power delay */ \
+    [ENERGY_I2C]      = 700,   /* 4.7 k pull-ups at 3.3 V, each line low about half the time */ \
+    [ENERGY_RADIO_TX] = 11300, /* nRF24 TX at 0 dBm; auto-ACKs are not timed */ \
+    [ENERGY_RADIO_RX] = 12600, /* nRF24 RX at 250 kbps, on whenever listening */ \
+    [ENERGY_SD]       = 20000, /* Card read/write/programming while the driver works it */ \
+    [ENERGY_LED]      = 2000,  /* Nucleo LD2 */ \
+}
+
+#endif /* ENERGY_TABLE_H */
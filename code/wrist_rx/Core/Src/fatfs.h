@@ -12,4 +12,40 @@ DRESULT SD_disk_read (BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
 DRESULT SD_disk_write (BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
 DRESULT SD_disk_ioctl (BYTE pdrv, BYTE cmd, void* buff);
 
+// Raw sequential writes to known LBAs (pre-allocated files)
+DRESULT SD_StreamWrite (DWORD sector, const BYTE* buff);
+DRESULT SD_StreamStop (void);
+
+// Called repeatedly while the card is busy or a read has not started; override to give up the CPU
+void SD_IdleHook (uint32_t waited_ms);
+
+// Waiting for a sector DMA: sleep until the completion interrupt, which calls SD_DMA_Done
+void SD_DMA_Sleep (void);
+void SD_DMA_Done (void);
+
+// Driver working the card (1) or back to the caller (0); override to account for the card's active current.
+// Covers commands, DMA and busy waits; an open CMD25 stream between SD_StreamWrite calls counts as idle.
+void SD_ActiveHook (uint8_t active);
+
+// Write latency and card health since power-up.
+// Histogram bin 0 counts writes under 1 ms, bin n counts 2^(n-1)..2^n-1 ms, the last bin everything longer.
+#define SD_HIST_BINS 12
+
+typedef struct {
+    uint32_t single_ms[SD_HIST_BINS]; // CMD24: one-sector disk_write
+    uint32_t multi_ms[SD_HIST_BINS];  // CMD25: multi-sector disk_write or one streamed sector
+    uint32_t busy_ms;                 // Total time the card held MISO low while programming
+    uint32_t busy_max_ms;             // Longest single busy period
+    uint32_t busy_waits;              // Waits that found the card busy
+    uint32_t busy_timeouts;
+    uint32_t token_timeouts;          // Read data that never started
+    uint32_t rejects;                 // Data responses other than "accepted"
+    uint32_t retries;                 // Write attempts repeated after a failure
+    uint32_t failures;                // Writes that failed every attempt
+    uint32_t worst_ms;                // Slowest write, retries included
+    uint32_t worst_tick;              // HAL tick when it completed
+} SD_Health_t;
+
+const SD_Health_t *SD_GetHealth (void);
+
 #endif
@@ -1,4 +1,5 @@
 #include "fatfs.h"
+#include <string.h>
 
 // Define the SPI Handle - Must match the one in main.c
 extern SPI_HandleTypeDef hspi2;
@@ -11,13 +12,17 @@ extern SPI_HandleTypeDef hspi2;
 #define CMD9     (0x40+9)     /* SEND_CSD */
 #define CMD10    (0x40+10)    /* SEND_CID */
 #define CMD12    (0x40+12)    /* STOP_TRANSMISSION */
+#define ACMD13   (0xC0+13)    /* SD_STATUS (SDC) */
 #define CMD16    (0x40+16)    /* SET_BLOCKLEN */
 #define CMD17    (0x40+17)    /* READ_SINGLE_BLOCK */
 #define CMD18    (0x40+18)    /* READ_MULTIPLE_BLOCK */
 #define CMD23    (0x40+23)    /* SET_BLOCK_COUNT */
 #define CMD24    (0x40+24)    /* WRITE_BLOCK */
 #define CMD25    (0x40+25)    /* WRITE_MULTIPLE_BLOCK */
-#define CMD41    (0x40+41)    /* SEND_OP_COND (ACMD) */
+#define CMD32    (0x40+32)    /* ERASE_WR_BLK_START */
+#define CMD33    (0x40+33)    /* ERASE_WR_BLK_END */
+#define CMD38    (0x40+38)    /* ERASE */
+#define ACMD41   (0xC0+41)    /* SD_SEND_OP_COND (SDC) */
 #define CMD55    (0x40+55)    /* APP_CMD */
 #define CMD58    (0x40+58)    /* READ_OCR */
 
@@ -28,9 +33,32 @@ extern SPI_HandleTypeDef hspi2;
 #define SD_CS_LOW()  HAL_GPIO_WritePin(SD_CS_PORT, SD_CS_PIN, GPIO_PIN_RESET)
 #define SD_CS_HIGH() HAL_GPIO_WritePin(SD_CS_PORT, SD_CS_PIN, GPIO_PIN_SET)
 
+// SPI2 runs from APB1 (45 MHz): ~350 kHz for identification, 22.5 MHz after
+#define SD_SPI_SLOW  SPI_BAUDRATEPRESCALER_128
+#define SD_SPI_FAST  SPI_BAUDRATEPRESCALER_2
+
+#define SD_SECTOR_SIZE      512
+#define SD_DMA_TIMEOUT_MS   100
+#define SD_TOKEN_TIMEOUT_MS 200
+#define SD_BUSY_TIMEOUT_MS  500
+#define SD_ERASE_TIMEOUT_MS 30000
+#define SD_INIT_TIMEOUT_MS  1000 // ACMD41 until the card leaves idle
+#define SD_WRITE_RETRIES    1    // A stall past the busy timeout usually ends before the retry's
+
 static volatile DSTATUS Stat = STA_NOINIT;
 static uint8_t CardType;
 
+// Open CMD25 kept across SD_StreamWrite calls
+static uint8_t sd_streaming = 0;
+static DWORD sd_stream_next;
+
+// DMA sector transfers
+static volatile uint8_t sd_dma_done;
+static volatile uint8_t sd_dma_error;
+static uint8_t sd_dma_fill[SD_SECTOR_SIZE]; // 0xFF clocked out while reading
+
+static SD_Health_t sd_health;
+
 // SPI Helper Functions
 static uint8_t SPI_RxByte(void) {
     uint8_t dummy, data;
@@ -44,21 +72,139 @@ static void SPI_TxByte(uint8_t data) {
     HAL_SPI_TransmitReceive(HSPI_SD, &data, &dummy, 1, 10);
 }
 
+static void SD_SetClock(uint32_t prescaler) {
+    // HAL re-enables SPE on the next transfer
+    __HAL_SPI_DISABLE(HSPI_SD);
+    MODIFY_REG(hspi2.Instance->CR1, SPI_CR1_BR, prescaler);
+    hspi2.Init.BaudRatePrescaler = prescaler;
+}
+
+__weak void SD_IdleHook(uint32_t waited_ms) {
+    UNUSED(waited_ms);
+}
+
+__weak void SD_DMA_Sleep(void) {
+    __WFI();
+}
+
+__weak void SD_DMA_Done(void) {
+}
+
+__weak void SD_ActiveHook(uint8_t active) {
+    UNUSED(active);
+}
+
+static DRESULT SD_StreamClose(void);
+
+// Sleep until the DMA completion callback fires
+static uint8_t SD_DMA_Wait(void) {
+    uint32_t start = HAL_GetTick();
+    while (!sd_dma_done) {
+        if (HAL_GetTick() - start > SD_DMA_TIMEOUT_MS) {
+            HAL_SPI_Abort(HSPI_SD);
+            return 1;
+        }
+        SD_DMA_Sleep();
+    }
+    return sd_dma_error;
+}
+
+static uint8_t SD_RxBlock(uint8_t *buff) {
+    sd_dma_done = 0;
+    sd_dma_error = 0;
+    if (HAL_SPI_TransmitReceive_DMA(HSPI_SD, sd_dma_fill, buff, SD_SECTOR_SIZE) != HAL_OK) return 1;
+    return SD_DMA_Wait();
+}
+
+static uint8_t SD_TxBlock(const uint8_t *buff) {
+    sd_dma_done = 0;
+    sd_dma_error = 0;
+    if (HAL_SPI_Transmit_DMA(HSPI_SD, (uint8_t *)buff, SD_SECTOR_SIZE) != HAL_OK) return 1;
+    return SD_DMA_Wait();
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi == HSPI_SD) {
+        sd_dma_done = 1;
+        SD_DMA_Done();
+    }
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi == HSPI_SD) {
+        sd_dma_done = 1;
+        SD_DMA_Done();
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+    if (hspi == HSPI_SD) {
+        sd_dma_error = 1;
+        sd_dma_done = 1;
+        SD_DMA_Done();
+    }
+}
+
 // SD Helper Functions
-static uint8_t SD_ReadyWait(void) {
+static uint8_t SD_WaitToken(uint8_t token) {
+    uint8_t res;
+    uint32_t start = HAL_GetTick();
+    do {
+        res = SPI_RxByte();
+        if (res == token) return 1;
+        SD_IdleHook(HAL_GetTick() - start);
+    } while (res == 0xFF && HAL_GetTick() - start < SD_TOKEN_TIMEOUT_MS);
+    sd_health.token_timeouts++;
+    return 0;
+}
+
+static uint8_t SD_BusyWait(uint32_t timeout_ms) {
     uint8_t res;
-    uint16_t timer = 500; // Timeout
+    uint8_t waited = 0;
+    uint32_t start = HAL_GetTick();
     SPI_RxByte();
     do {
         res = SPI_RxByte();
-        if (res == 0xFF) return 0xFF; // Ready
-    } while (timer--);
-    return 0x00; // Busy
+        if (res == 0xFF) break; // Ready
+        waited = 1;
+        SD_IdleHook(HAL_GetTick() - start); // Card is programming, can take hundreds of ms
+    } while (HAL_GetTick() - start < timeout_ms);
+
+    if (waited) {
+        uint32_t took = HAL_GetTick() - start;
+        sd_health.busy_waits++;
+        sd_health.busy_ms += took;
+        if (took > sd_health.busy_max_ms) sd_health.busy_max_ms = took;
+        if (res != 0xFF) sd_health.busy_timeouts++;
+    }
+    return (res == 0xFF) ? 0xFF : 0x00; // Ready or still busy
+}
+
+// Data response token: xxx0 0101 is accepted, CRC or write errors otherwise
+static uint8_t SD_DataAccepted(void) {
+    if ((SPI_RxByte() & 0x1F) == 0x05) return 1;
+    sd_health.rejects++;
+    return 0;
+}
+
+static void SD_RecordWrite(uint32_t *hist, uint32_t start, DRESULT res) {
+    uint32_t now = HAL_GetTick();
+    uint32_t took = now - start;
+    uint8_t bin = 0;
+    for (uint32_t ms = took; ms && bin < SD_HIST_BINS - 1; ms >>= 1) bin++;
+    hist[bin]++;
+    if (took > sd_health.worst_ms) {
+        sd_health.worst_ms = took;
+        sd_health.worst_tick = now;
+    }
+    if (res != RES_OK) sd_health.failures++;
+}
+
+static uint8_t SD_ReadyWait(void) {
+    return SD_BusyWait(SD_BUSY_TIMEOUT_MS);
 }
 
 static void SD_PowerOn(void) {
-    uint8_t cmd_arg[6];
-    uint32_t count = 0x1FFF;
     SD_CS_HIGH();
     for(int i = 0; i < 10; i++) SPI_TxByte(0xFF); // 80 dummy clocks
     SD_CS_LOW();
@@ -92,6 +238,8 @@ static uint8_t SD_SendCmd(uint8_t cmd, uint32_t arg) {
     if (cmd == CMD8) crc = 0x87;
     SPI_TxByte(crc);
 
+    if (cmd == CMD12) SPI_RxByte(); // Stuff byte, may be leftover read data
+
     uint8_t n = 10;
     do {
         res = SPI_RxByte();
@@ -106,35 +254,52 @@ DSTATUS SD_disk_initialize(BYTE drv) {
     uint8_t n, type, ocr[4];
     if (drv) return STA_NOINIT;
 
+    SD_ActiveHook(1);
+    memset(sd_dma_fill, 0xFF, sizeof(sd_dma_fill));
+    SD_SetClock(SD_SPI_SLOW); // Identification must run below 400 kHz
     SD_PowerOn(); // Wake up
 
     type = 0;
     if (SD_SendCmd(CMD0, 0) == 1) { // Enter Idle state
+        uint32_t start = HAL_GetTick();
+        uint8_t res = 0xFF;
         if (SD_SendCmd(CMD8, 0x1AA) == 1) { // SDv2
             for (n = 0; n < 4; n++) ocr[n] = SPI_RxByte();
             if (ocr[2] == 0x01 && ocr[3] == 0xAA) {
-                if (SD_SendCmd(CMD58, 0) == 0) { // Check voltage range
-                     for (n = 0; n < 4; n++) ocr[n] = SPI_RxByte();
-                     type = (ocr[1] & 0x40) ? 6 : 12; // SDv2 (Block or Byte address)
-                }
-                // Wait for initialization
-                uint16_t tmr = 1000;
-                while (tmr-- && SD_SendCmd(CMD41, 1UL << 30));
-                if (tmr && SD_SendCmd(CMD58, 0) == 0) {
+                // Wait for initialization; a bare CMD41 is illegal on SD cards
+                do {
+                    res = SD_SendCmd(ACMD41, 1UL << 30); // HCS: host supports SDHC
+                } while (res && HAL_GetTick() - start < SD_INIT_TIMEOUT_MS);
+                if (res == 0 && SD_SendCmd(CMD58, 0) == 0) {
                      for (n = 0; n < 4; n++) ocr[n] = SPI_RxByte();
                      type = (ocr[0] & 0x40) ? 6 : 2; // Check CCS bit
                 }
             }
         } else { // SDv1 or MMC
-            type = (SD_SendCmd(CMD55, 0) <= 1 && SD_SendCmd(CMD41, 0) <= 1) ? 2 : 1;
-            if (type == 1) {
-                if (SD_SendCmd(CMD1, 0) > 1) type = 0;
+            uint8_t cmd = CMD1;
+            type = 1;
+            if (SD_SendCmd(ACMD41, 0) <= 1) {
+                type = 2;
+                cmd = ACMD41;
             }
+            do {
+                res = SD_SendCmd(cmd, 0);
+            } while (res && HAL_GetTick() - start < SD_INIT_TIMEOUT_MS);
+            if (res != 0) type = 0;
         }
+        // Byte-addressed cards may power up with another block length
+        if (type && !(type & 4) && SD_SendCmd(CMD16, SD_SECTOR_SIZE) != 0) type = 0;
     }
     CardType = type;
     SD_CS_HIGH();
     SPI_RxByte(); // Idle
+    if (type) {
+        SD_SetClock(SD_SPI_FAST); // Card identified, data transfer at full speed
+        Stat &= ~STA_NOINIT;
+    } else {
+        Stat |= STA_NOINIT; // Re-init after a card swap must not keep the old state
+    }
+    SD_ActiveHook(0);
     return type ? 0 : STA_NOINIT;
 }
 
@@ -145,20 +310,23 @@ DSTATUS SD_disk_status(BYTE drv) {
 
 DRESULT SD_disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
     if (pdrv || !count) return RES_PARERR;
+    SD_ActiveHook(1);
+    SD_StreamClose(); // Commands cannot interleave with an open CMD25
     if (!(CardType & 4)) sector *= 512; // Convert to byte address if needed
 
     SD_CS_LOW();
     if (count == 1) { // Single Block
-        if ((SD_SendCmd(CMD17, sector) == 0) && (SPI_RxByte() == 0xFE)) { // Start Token
-             for(int i=0; i<512; i++) *buff++ = SPI_RxByte();
-             SPI_RxByte(); SPI_RxByte(); // CRC
-             count = 0;
+        if ((SD_SendCmd(CMD17, sector) == 0) && SD_WaitToken(0xFE)) { // Start Token
+             if (SD_RxBlock(buff) == 0) {
+                 SPI_RxByte(); SPI_RxByte(); // CRC
+                 count = 0;
+             }
         }
     } else { // Multiple Block
         if (SD_SendCmd(CMD18, sector) == 0) {
             do {
-                if (SPI_RxByte() == 0xFE) {
-                     for(int i=0; i<512; i++) *buff++ = SPI_RxByte();
+                if (SD_WaitToken(0xFE) && SD_RxBlock(buff) == 0) {
+                     buff += SD_SECTOR_SIZE;
                      SPI_RxByte(); SPI_RxByte();
                 } else {
                      break;
@@ -169,20 +337,21 @@ DRESULT SD_disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
     }
     SD_CS_HIGH();
     SPI_RxByte();
+    SD_ActiveHook(0);
     return count ? RES_ERROR : RES_OK;
 }
 
-DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
-    if (pdrv || !count) return RES_PARERR;
+static DRESULT SD_WriteBlocks(const BYTE* buff, DWORD sector, UINT count) {
     if (!(CardType & 4)) sector *= 512;
 
     SD_CS_LOW();
     if (count == 1) { // Single Block
         if (SD_SendCmd(CMD24, sector) == 0) {
             SPI_TxByte(0xFE); // Start Token
-            for(int i=0; i<512; i++) SPI_TxByte(*buff++);
-            SPI_TxByte(0xFF); SPI_TxByte(0xFF); // Dummy CRC
-            if ((SPI_RxByte() & 0x1F) != 0x05) count = 1; // Error
+            if (SD_TxBlock(buff) == 0) {
+                SPI_TxByte(0xFF); SPI_TxByte(0xFF); // Dummy CRC
+                if (SD_DataAccepted()) count = 0;
+            }
         }
     } else { // Multiple Block
         if (CardType & 2) {
@@ -191,9 +360,11 @@ DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
         if (SD_SendCmd(CMD25, sector) == 0) {
             do {
                 SPI_TxByte(0xFC); // Start Token Multi
-                for(int i=0; i<512; i++) SPI_TxByte(*buff++);
+                if (SD_TxBlock(buff) != 0) break;
+                buff += SD_SECTOR_SIZE;
                 SPI_TxByte(0xFF); SPI_TxByte(0xFF);
-                if ((SPI_RxByte() & 0x1F) != 0x05) break;
+                if (!SD_DataAccepted()) break;
+                SD_ReadyWait(); // Card programs the block before the next token
             } while (--count);
             SPI_TxByte(0xFD); // Stop Token
         }
@@ -203,10 +374,186 @@ DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
     return count ? RES_ERROR : RES_OK;
 }
 
+DRESULT SD_disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
+    if (pdrv || !count) return RES_PARERR;
+    SD_ActiveHook(1);
+    SD_StreamClose();
+
+    uint32_t start = HAL_GetTick();
+    DRESULT res = SD_WriteBlocks(buff, sector, count);
+    for (uint8_t n = 0; res != RES_OK && n < SD_WRITE_RETRIES; n++) {
+        sd_health.retries++;
+        res = SD_WriteBlocks(buff, sector, count);
+    }
+    SD_RecordWrite(count == 1 ? sd_health.single_ms : sd_health.multi_ms, start, res);
+    SD_ActiveHook(0);
+    return res;
+}
+
+// Read the 16-byte CSD register
+static uint8_t SD_ReadCSD(uint8_t *csd) {
+    if (SD_SendCmd(CMD9, 0) != 0 || !SD_WaitToken(0xFE)) return 1;
+    for (int i = 0; i < 16; i++) csd[i] = SPI_RxByte();
+    SPI_RxByte(); SPI_RxByte(); // CRC
+    return 0;
+}
+
 DRESULT SD_disk_ioctl(BYTE pdrv, BYTE cmd, void* buff) {
     DRESULT res = RES_ERROR;
+    uint8_t csd[16];
+    DWORD csize, st, ed;
+    uint8_t n;
+
     if (pdrv) return RES_PARERR;
-    // Simplified IOCTL (Just return OK for sync)
-    if (cmd == CTRL_SYNC) res = RES_OK;
+    if (Stat & STA_NOINIT) return RES_NOTRDY;
+    SD_ActiveHook(1);
+    SD_StreamClose();
+
+    SD_CS_LOW();
+    switch (cmd) {
+    case CTRL_SYNC: // Card finished programming
+        if (SD_ReadyWait() == 0xFF) res = RES_OK;
+        break;
+
+    case GET_SECTOR_COUNT:
+        if (SD_ReadCSD(csd) == 0) {
+            if ((csd[0] >> 6) == 1) { // CSD v2 (SDHC/SDXC)
+                csize = csd[9] + ((DWORD)csd[8] << 8) + ((DWORD)(csd[7] & 63) << 16) + 1;
+                *(DWORD*)buff = csize << 10;
+            } else { // CSD v1 (SDv1, byte-addressed SDv2, MMC)
+                n = (csd[5] & 15) + ((csd[10] & 128) >> 7) + ((csd[9] & 3) << 1) + 2;
+                csize = (csd[8] >> 6) + ((DWORD)csd[7] << 2) + ((DWORD)(csd[6] & 3) << 10) + 1;
+                *(DWORD*)buff = csize << (n - 9);
+            }
+            res = RES_OK;
+        }
+        break;
+
+    case GET_SECTOR_SIZE:
+        *(WORD*)buff = SD_SECTOR_SIZE;
+        res = RES_OK;
+        break;
+
+    case GET_BLOCK_SIZE: // Erase block size in sectors
+        if (SD_ReadCSD(csd) != 0) break;
+        if ((csd[0] >> 6) == 1) { // Allocation unit from the 64-byte SD status
+            if (SD_SendCmd(ACMD13, 0) == 0) {
+                SPI_RxByte(); // Second byte of R2
+                if (SD_WaitToken(0xFE)) {
+                    for (n = 0; n < 16; n++) csd[n] = SPI_RxByte();
+                    for (n = 0; n < 64 - 16 + 2; n++) SPI_RxByte(); // Rest + CRC
+                    *(DWORD*)buff = 16UL << (csd[10] >> 4);
+                    res = RES_OK;
+                }
+            }
+        } else if (CardType & 2) { // SDv1
+            *(DWORD*)buff = (((csd[10] & 63) << 1) + ((csd[11] & 128) >> 7) + 1) << ((csd[13] >> 6) - 1);
+            res = RES_OK;
+        } else { // MMC
+            *(DWORD*)buff = (((csd[10] & 124) >> 2) + 1) * (((csd[11] & 3) << 3) + ((csd[11] & 224) >> 5) + 1);
+            res = RES_OK;
+        }
+        break;
+
+    case CTRL_TRIM: // Erase sectors buff[0]..buff[1]
+        if (!(CardType & 2)) break; // SD cards only
+        if (SD_ReadCSD(csd) != 0) break;
+        if (!(csd[0] >> 6) && !(csd[10] & 0x40)) break; // Card cannot erase single blocks
+        st = ((DWORD*)buff)[0];
+        ed = ((DWORD*)buff)[1];
+        if (!(CardType & 4)) { st *= 512; ed *= 512; }
+        if (SD_SendCmd(CMD32, st) == 0 && SD_SendCmd(CMD33, ed) == 0 &&
+            SD_SendCmd(CMD38, 0) == 0 && SD_BusyWait(SD_ERASE_TIMEOUT_MS) == 0xFF) {
+            res = RES_OK;
+        }
+        break;
+
+    default:
+        res = RES_PARERR;
+        break;
+    }
+    SD_CS_HIGH();
+    SPI_RxByte();
+    SD_ActiveHook(0);
     return res;
 }
+
+// --- RAW STREAMING ---
+// Sequential sectors go out as one open CMD25, bypassing FatFs.
+// The card programs each block while the caller fills the next one.
+// An open stream keeps CS low but the card idles once programmed, so
+// SD_ActiveHook only covers the calls, not the time between them.
+
+static DRESULT SD_StreamBlock(DWORD sector, const BYTE* buff) {
+    if (sd_streaming && sector != sd_stream_next) SD_StreamClose();
+
+    if (!sd_streaming) {
+        // ACMD23 only pre-erases a known count; the stream length is open-ended
+        if (SD_SendCmd(CMD25, (CardType & 4) ? sector : sector * 512) != 0) {
+            SD_CS_HIGH();
+            SPI_RxByte();
+            return RES_ERROR;
+        }
+        sd_streaming = 1;
+        sd_stream_next = sector;
+    } else if (SD_ReadyWait() != 0xFF) { // Previous block still programming
+        SD_StreamClose();
+        return RES_ERROR;
+    }
+
+    SPI_TxByte(0xFC); // Start Token Multi
+    if (SD_TxBlock(buff) != 0) {
+        SD_StreamClose();
+        return RES_ERROR;
+    }
+    SPI_TxByte(0xFF); SPI_TxByte(0xFF);
+    if (!SD_DataAccepted()) {
+        SD_StreamClose();
+        return RES_ERROR;
+    }
+    sd_stream_next++;
+    return RES_OK;
+}
+
+// A failed block closes the stream; the retry opens a new CMD25 at that sector
+DRESULT SD_StreamWrite(DWORD sector, const BYTE* buff) {
+    if (Stat & STA_NOINIT) return RES_NOTRDY;
+
+    SD_ActiveHook(1);
+    uint32_t start = HAL_GetTick();
+    DRESULT res = SD_StreamBlock(sector, buff);
+    for (uint8_t n = 0; res != RES_OK && n < SD_WRITE_RETRIES; n++) {
+        sd_health.retries++;
+        res = SD_StreamBlock(sector, buff);
+    }
+    SD_RecordWrite(sd_health.multi_ms, start, res);
+    SD_ActiveHook(0);
+    return res;
+}
+
+// End the open CMD25 and wait until the card has committed every block
+static DRESULT SD_StreamClose(void) {
+    DRESULT res = RES_OK;
+    if (!sd_streaming) return RES_OK;
+    sd_streaming = 0;
+
+    if (SD_ReadyWait() != 0xFF) res = RES_ERROR;
+    SPI_TxByte(0xFD); // Stop Token
+    SPI_RxByte();
+    if (SD_ReadyWait() != 0xFF) res = RES_ERROR;
+    SD_CS_HIGH();
+    SPI_RxByte();
+    return res;
+}
+
+DRESULT SD_StreamStop(void) {
+    if (!sd_streaming) return RES_OK;
+    SD_ActiveHook(1);
+    DRESULT res = SD_StreamClose();
+    SD_ActiveHook(0);
+    return res;
+}
+
+const SD_Health_t *SD_GetHealth(void) {
+    return &sd_health;
+}
@@ -0,0 +1,52 @@
+/* ========================================
+   File: fmt.h
+   Text Formatting Shared by Ankle and Wrist Nodes
+
+   Appends integers, fixed-point decimals and
+   strings to a caller's buffer: no format string,
+   no heap, no newlib printf. Each value has its
+   own typed call, and Fmt_Num picks one from the
+   argument's type at compile time (floats have no
+   entry there; they need Fmt_Float with a digit
+   count). Output past the buffer is cut off and
+   flagged, and the text is always terminated.
+   Keep both node copies of this file identical.
+   ======================================== */
+
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+/* Fractional digits Fmt_Fixed and Fmt_Float accept */
+#define FMT_MAX_DECIMALS        6
+
+typedef struct {
+    char *buf;
+    uint16_t size;
+    uint16_t len;
+    uint8_t truncated;
+} Fmt_t;
+
+/* Function prototypes */
+void Fmt_Init(Fmt_t *f, char *buf, uint16_t size);
+void Fmt_Char(Fmt_t *f, char c);
+void Fmt_Str(Fmt_t *f, const char *s);
+void Fmt_U32(Fmt_t *f, uint32_t value);
+void Fmt_I32(Fmt_t *f, int32_t value);
+void Fmt_U64(Fmt_t *f, uint64_t value);
+void Fmt_I64(Fmt_t *f, int64_t value);
+void Fmt_Hex(Fmt_t *f, uint32_t value, uint8_t digits);
+void Fmt_Fixed(Fmt_t *f, int32_t value, uint8_t decimals);
+void Fmt_Float(Fmt_t *f, float value, uint8_t decimals);
+void Fmt_Right(Fmt_t *f, uint16_t start, uint8_t width);
+void Fmt_Left(Fmt_t *f, uint16_t start, uint8_t width);
+uint16_t Fmt_End(Fmt_t *f);
+
+/* Integer of any width; anything else fails to compile */
+#define Fmt_Num(f, x) _Generic((x), \
+    signed char: Fmt_I32, short: Fmt_I32, int: Fmt_I32, long: Fmt_I64, long long: Fmt_I64, \
+    unsigned char: Fmt_U32, unsigned short: Fmt_U32, unsigned int: Fmt_U32, \
+    unsigned long: Fmt_U64, unsigned long long: Fmt_U64)((f), (x))
+
+#endif /* FMT_H */
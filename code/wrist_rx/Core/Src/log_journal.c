@@ -0,0 +1,81 @@
+/* ========================================
+   File: log_journal.c
+   Append-Only Journal Framing for the SD Log
+   ======================================== */
+
+#include "log_journal.h"
+#include <string.h>
+
+/* CRC-16/CCITT-FALSE; bitwise is plenty at a few entries per second */
+uint16_t Journal_Crc16(const uint8_t *data, uint16_t len, uint16_t crc)
+{
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+void Journal_InitSector(uint8_t *sector, uint16_t session, uint32_t sector_seq, uint32_t first_seq, uint32_t first_ms)
+{
+    JournalSectorHeader_t hdr;
+    hdr.magic = JOURNAL_MAGIC;
+    hdr.session = session;
+    hdr.sector_seq = sector_seq;
+    hdr.first_seq = first_seq;
+    hdr.first_ms = first_ms;
+
+    memset(sector, 0, JOURNAL_SECTOR_SIZE);
+    memcpy(sector, &hdr, sizeof(hdr));
+}
+
+/* A sector belongs to the journal only at the position it was written for */
+uint8_t Journal_SectorValid(const uint8_t *sector, uint32_t sector_seq)
+{
+    JournalSectorHeader_t hdr;
+    memcpy(&hdr, sector, sizeof(hdr));
+    return hdr.magic == JOURNAL_MAGIC && hdr.sector_seq == sector_seq;
+}
+
+uint16_t Journal_Encode(uint8_t *dst, uint8_t type, uint32_t seq, const void *payload, uint8_t len)
+{
+    JournalEntryHeader_t hdr;
+    hdr.type = type;
+    hdr.len = len;
+    hdr.seq = (uint16_t)seq;
+
+    memcpy(dst, &hdr, sizeof(hdr));
+    memcpy(dst + sizeof(hdr), payload, len);
+
+    uint16_t crc = Journal_Crc16(dst, sizeof(hdr) + len, 0xFFFF);
+    dst[sizeof(hdr) + len] = (uint8_t)crc;
+    dst[sizeof(hdr) + len + 1] = (uint8_t)(crc >> 8);
+    return JOURNAL_ENTRY_SIZE(len);
+}
+
+/* Decode the entry at offset; returns the offset after it */
+uint16_t Journal_NextEntry(const uint8_t *sector, uint16_t offset, uint32_t expect_seq, JournalEntry_t *entry)
+{
+    JournalEntryHeader_t hdr;
+
+    if (offset + JOURNAL_ENTRY_SIZE(0) > JOURNAL_SECTOR_SIZE) return JOURNAL_END;
+    memcpy(&hdr, &sector[offset], sizeof(hdr));
+    if (hdr.type == 0) return JOURNAL_END;
+
+    uint16_t size = JOURNAL_ENTRY_SIZE(hdr.len);
+    if (offset + size > JOURNAL_SECTOR_SIZE) return JOURNAL_CORRUPT;
+    if (hdr.seq != (uint16_t)expect_seq) return JOURNAL_CORRUPT;
+
+    uint16_t crc = Journal_Crc16(&sector[offset], sizeof(hdr) + hdr.len, 0xFFFF);
+    if (sector[offset + size - 2] != (uint8_t)crc || sector[offset + size - 1] != (uint8_t)(crc >> 8)) {
+        return JOURNAL_CORRUPT;
+    }
+
+    entry->type = hdr.type;
+    entry->len = hdr.len;
+    entry->seq = expect_seq;
+    entry->payload = &sector[offset + sizeof(hdr)];
+    return offset + size;
+}
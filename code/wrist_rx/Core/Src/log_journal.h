@@ -0,0 +1,71 @@
+/* ========================================
+   File: log_journal.h
+   Append-Only Journal Framing for the SD Log
+
+   Every 512-byte sector starts with a header
+   carrying its position in the file, the sequence
+   number of its first entry and the boot session
+   and tick it was started at. Sectors are ordered
+   by (session, tick), so the headers double as a
+   sparse time index that a binary search can seek
+   in. Entries are type, length, 16-bit sequence,
+   payload and a CRC-16, and never straddle a
+   sector; the unused tail of a sector stays zero.
+   Plain C without HAL so the host converter links
+   the same code.
+   ======================================== */
+
+#ifndef LOG_JOURNAL_H
+#define LOG_JOURNAL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JOURNAL_SECTOR_SIZE     512
+#define JOURNAL_MAGIC           0x4A57  /* "WJ" */
+
+#define JOURNAL_SECTOR_HEADER   16
+#define JOURNAL_ENTRY_HEADER    4
+#define JOURNAL_ENTRY_CRC       2
+#define JOURNAL_ENTRY_SIZE(len) (JOURNAL_ENTRY_HEADER + (len) + JOURNAL_ENTRY_CRC)
+
+/* Journal_NextEntry results besides a valid offset */
+#define JOURNAL_END             0       /* Zero padding: no more entries */
+#define JOURNAL_CORRUPT         0xFFFF  /* Torn or stale entry */
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint16_t session;           /* Boot count; each session starts a new sector */
+    uint32_t sector_seq;        /* Sector index within the file */
+    uint32_t first_seq;         /* Sequence number of the first entry */
+    uint32_t first_ms;          /* Tick when the sector was started */
+} JournalSectorHeader_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;               /* 0 is padding */
+    uint8_t len;
+    uint16_t seq;               /* Low bits of the running entry number */
+} JournalEntryHeader_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t len;
+    uint32_t seq;               /* Extended with the sector's first_seq */
+    const uint8_t *payload;
+} JournalEntry_t;
+
+/* Function prototypes */
+uint16_t Journal_Crc16(const uint8_t *data, uint16_t len, uint16_t crc);
+void Journal_InitSector(uint8_t *sector, uint16_t session, uint32_t sector_seq, uint32_t first_seq, uint32_t first_ms);
+uint8_t Journal_SectorValid(const uint8_t *sector, uint32_t sector_seq);
+uint16_t Journal_Encode(uint8_t *dst, uint8_t type, uint32_t seq, const void *payload, uint8_t len);
+uint16_t Journal_NextEntry(const uint8_t *sector, uint16_t offset, uint32_t expect_seq, JournalEntry_t *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_JOURNAL_H */
@@ -0,0 +1,127 @@
+/* ========================================
+   File: log_pack.c
+   Streaming Record Compressor for the SD Log
+   ======================================== */
+
+#include "log_pack.h"
+#include <string.h>
+
+void LogPack_Init(LogPack_t *pack, const LogPackSchema_t *schema)
+{
+    memset(pack, 0, sizeof(*pack));
+    pack->schema = schema;
+    LogPack_Begin(pack, LOG_PACK_BYTES);
+}
+
+/* Fresh block; limit is the payload the caller expects to have room for */
+void LogPack_Begin(LogPack_t *pack, uint16_t limit)
+{
+    const LogPackSchema_t *schema = pack->schema;
+
+    if (limit < LOG_PACK_MIN || limit > LOG_PACK_BYTES) limit = LOG_PACK_BYTES;
+    pack->limit = limit;
+
+    memset(&pack->st, 0, sizeof(pack->st));
+    for (uint8_t f = 0; f < schema->fields; f++) {
+        pack->st.acc[f] = 4UL << schema->k0[f];
+    }
+    memset(pack->buf, 0, sizeof(pack->buf));
+}
+
+uint32_t LogPack_Predict(const LogPackSchema_t *schema, const LogPackState_t *st, uint8_t field)
+{
+    if (st->count == 0) return 0;
+    if (schema->order[field] == 2 && st->count >= 2) {
+        return st->prev[field] + (st->prev[field] - st->prev2[field]);
+    }
+    return st->prev[field];
+}
+
+uint8_t LogPack_RiceK(uint32_t acc)
+{
+    uint32_t mean = acc >> 2;
+    uint8_t k = 0;
+    while (k < 24 && (2UL << k) <= mean) k++;
+    return k;
+}
+
+uint32_t LogPack_Adapt(uint32_t acc, uint32_t zz)
+{
+    if (zz > (1UL << 24)) zz = 1UL << 24;
+    return acc - (acc >> 2) + zz;
+}
+
+static uint8_t LogPack_PutBits(LogPack_t *pack, uint32_t value, uint8_t n)
+{
+    uint16_t end = (uint16_t)(8 * (pack->limit - 1));
+
+    if (pack->st.bits + n > end) return 1;
+    while (n--) {
+        if ((value >> n) & 1) {
+            pack->buf[1 + (pack->st.bits >> 3)] |= (uint8_t)(0x80 >> (pack->st.bits & 7));
+        }
+        pack->st.bits++;
+    }
+    return 0;
+}
+
+static uint8_t LogPack_PutRice(LogPack_t *pack, uint32_t zz, uint8_t k)
+{
+    uint32_t q = zz >> k;
+
+    if (q >= LOG_PACK_ESCAPE) {
+        return LogPack_PutBits(pack, (1UL << LOG_PACK_ESCAPE) - 1, LOG_PACK_ESCAPE) ||
+               LogPack_PutBits(pack, zz, 32);
+    }
+    /* q ones, a zero, then the k low bits */
+    return LogPack_PutBits(pack, ((1UL << q) - 1) << 1, (uint8_t)(q + 1)) ||
+           LogPack_PutBits(pack, zz & ((1UL << k) - 1), k);
+}
+
+/* Returns 1 with the block untouched if the record does not fit */
+uint8_t LogPack_Add(LogPack_t *pack, const uint32_t *values, uint16_t raw_len)
+{
+    const LogPackSchema_t *schema = pack->schema;
+    LogPackState_t saved = pack->st;
+
+    if (pack->st.count == 255) return 1;
+
+    for (uint8_t f = 0; f < schema->fields; f++) {
+        int32_t residual = (int32_t)(values[f] - LogPack_Predict(schema, &pack->st, f));
+        uint32_t zz = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+        uint8_t k = pack->st.count ? LogPack_RiceK(pack->st.acc[f]) : schema->k1[f];
+
+        if (LogPack_PutRice(pack, zz, k) != 0) {
+            /* Clear the partial record so the next block starts from zeros */
+            uint16_t from = saved.bits;
+            if (from & 7) {
+                pack->buf[1 + (from >> 3)] &= (uint8_t)(0xFF << (8 - (from & 7)));
+                from = (uint16_t)((from + 7) & ~7u);
+            }
+            memset(&pack->buf[1 + (from >> 3)], 0, sizeof(pack->buf) - 1 - (from >> 3));
+            pack->st = saved;
+            return 1;
+        }
+        /* First record is absolute and says nothing about residual size */
+        if (pack->st.count > 0) pack->st.acc[f] = LogPack_Adapt(pack->st.acc[f], zz);
+    }
+
+    for (uint8_t f = 0; f < schema->fields; f++) {
+        pack->st.prev2[f] = pack->st.prev[f];
+        pack->st.prev[f] = values[f];
+    }
+    pack->st.count++;
+    pack->raw_bytes += raw_len;
+    return 0;
+}
+
+/* Payload length of the finished block, 0 if it is empty */
+uint8_t LogPack_Finish(LogPack_t *pack)
+{
+    if (pack->st.count == 0) return 0;
+
+    uint8_t len = (uint8_t)(1 + (pack->st.bits + 7) / 8);
+    pack->buf[0] = pack->st.count;
+    pack->packed_bytes += len;
+    return len;
+}
@@ -0,0 +1,71 @@
+/* ========================================
+   File: log_pack.h
+   Streaming Record Compressor for the SD Log
+
+   Records of one type are packed into blocks of
+   up to LOG_PACK_BYTES. Each field is predicted
+   from the previous record (or the last two for
+   counters and timestamps), and the zigzag of the
+   residual is Rice coded with a per-field
+   parameter that follows the recent residual size.
+   A block's first record has nothing to predict
+   from; it is coded against zero with a parameter
+   spanning the field's range, about its raw width.
+   Blocks are independent, so a torn journal entry
+   never affects the blocks before it. Plain C
+   without HAL; the host decoder follows the same
+   rules (code/host/log_unpack.h).
+   ======================================== */
+
+#ifndef LOG_PACK_H
+#define LOG_PACK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_PACK_FIELDS         6
+#define LOG_PACK_BYTES          240     /* Largest block payload, count byte included */
+#define LOG_PACK_MIN            64      /* Sector remainders below this are not targeted */
+#define LOG_PACK_ESCAPE         16      /* Unary quotient that switches to 32 raw bits */
+
+typedef struct {
+    uint8_t fields;
+    uint8_t order[LOG_PACK_FIELDS];     /* 1: previous value, 2: linear from the last two */
+    uint8_t k0[LOG_PACK_FIELDS];        /* Rice parameter before any residual is seen */
+    uint8_t k1[LOG_PACK_FIELDS];        /* Rice parameter of a block's first record, up to 31 */
+} LogPackSchema_t;
+
+typedef struct {
+    uint32_t prev[LOG_PACK_FIELDS];
+    uint32_t prev2[LOG_PACK_FIELDS];
+    uint32_t acc[LOG_PACK_FIELDS];      /* About 4x the mean recent residual */
+    uint16_t bits;                      /* Bits written after the count byte */
+    uint8_t count;
+} LogPackState_t;
+
+typedef struct {
+    const LogPackSchema_t *schema;
+    LogPackState_t st;
+    uint16_t limit;                     /* Block size this block is aiming for */
+    uint32_t raw_bytes;                 /* Totals for the compression ratio */
+    uint32_t packed_bytes;
+    uint8_t buf[LOG_PACK_BYTES];
+} LogPack_t;
+
+/* Function prototypes */
+void LogPack_Init(LogPack_t *pack, const LogPackSchema_t *schema);
+void LogPack_Begin(LogPack_t *pack, uint16_t limit);
+uint8_t LogPack_Add(LogPack_t *pack, const uint32_t *values, uint16_t raw_len);
+uint8_t LogPack_Finish(LogPack_t *pack);
+uint32_t LogPack_Predict(const LogPackSchema_t *schema, const LogPackState_t *st, uint8_t field);
+uint8_t LogPack_RiceK(uint32_t acc);
+uint32_t LogPack_Adapt(uint32_t acc, uint32_t zz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_PACK_H */
@@ -0,0 +1,132 @@
+/* ========================================
+   File: log_record.h
+   Binary SD Log Format
+
+   Sector 0 holds LogFileHeader_t, zero padded.
+   Every following sector is a journal sector (see
+   log_journal.h) whose entries carry the payloads
+   below, all little-endian. Steps and vitals are
+   normally written as packed blocks (log_pack.h)
+   of the fields listed with their schemas. Any
+   change to a payload layout needs a new
+   LOG_SCHEMA_ID; the file name carries it so old
+   logs are never appended to. Also included by
+   the host converter (code/host).
+   ======================================== */
+
+#ifndef LOG_RECORD_H
+#define LOG_RECORD_H
+
+#include <stdint.h>
+
+#define LOG_MAGIC               "WLOG"
+#define LOG_VERSION             5
+#define LOG_SCHEMA_ID           5
+#define LOG_FILE_NAME           "wlog_s5.bin"
+
+#define LOG_HEADER_SIZE         32
+
+/* Entry types */
+#define LOG_REC_BOOT            0x01
+#define LOG_REC_STEP            0x02
+#define LOG_REC_VITALS          0x03
+#define LOG_REC_COMMIT          0x04
+#define LOG_REC_STEP_PACK       0x05
+#define LOG_REC_VITALS_PACK     0x06
+#define LOG_REC_ROLLUP          0x07
+#define LOG_REC_SD_HEALTH       0x08
+
+/* Packed block fields: predictor order, starting Rice parameter and the
+   first record's parameter (about the bits of the field's usual range) */
+#define LOG_STEP_FIELDS         6       /* step_number, time_ms, period, intensity, temp_centi, heart_rate */
+#define LOG_STEP_ORDER          { 2, 2, 1, 1, 1, 1 }
+#define LOG_STEP_K0             { 0, 5, 4, 5, 1, 2 }
+#define LOG_STEP_K1             { 16, 31, 12, 11, 13, 8 }
+#define LOG_VITALS_FIELDS       6       /* time_ms, ir, red, heart_rate, spo2, flags */
+#define LOG_VITALS_ORDER        { 2, 1, 1, 1, 1, 1 }
+#define LOG_VITALS_K0           { 8, 10, 10, 2, 1, 0 }
+#define LOG_VITALS_K1           { 31, 18, 18, 8, 7, 2 }
+
+/* Vitals flags */
+#define LOG_FLAG_HR_VALID       0x01
+#define LOG_FLAG_SPO2_VALID     0x02
+
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version;
+    uint16_t schema_id;
+    uint16_t header_size;
+    uint16_t sector_size;       /* Journal sector size */
+    uint32_t tick_hz;           /* Unit of every time_ms field */
+    uint8_t reserved[16];
+} LogFileHeader_t;
+
+/* Start of a session; time_ms restarts from here */
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;
+    uint8_t reset_flags;        /* RCC_CSR[31:24] */
+} LogBootRecord_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t step_number;
+    uint32_t time_ms;           /* Wrist tick at which the step happened */
+    uint16_t period;
+    uint16_t intensity;
+    int16_t temp_centi;         /* Ankle temperature, 0.01 C */
+    uint8_t heart_rate;         /* bpm at the step, 0 if no valid estimate */
+} LogStepRecord_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;           /* Wrist tick of the ankle packet */
+    uint32_t ir;
+    uint32_t red;
+    uint8_t heart_rate;
+    uint8_t spo2;
+    uint8_t flags;
+} LogVitalsRecord_t;
+
+/* One minute of the session, written shortly after the minute ends */
+typedef struct __attribute__((packed)) {
+    uint32_t minute;            /* time_ms / 60000 */
+    uint16_t steps;
+    uint16_t period_mean;
+    uint32_t period_var;        /* Population variance of the step period */
+    uint8_t hr_min;             /* bpm over valid estimates, all 0 if none */
+    uint8_t hr_mean;
+    uint8_t hr_max;
+    int16_t temp_centi;         /* Mean ankle temperature, 0.01 C */
+    uint8_t temp_valid;
+} LogRollupRecord_t;
+
+/* SD driver counters since power-up (fatfs.h SD_Health_t), once a minute.
+   Bin 0 of a histogram is under 1 ms, bin n 2^(n-1)..2^n-1 ms. */
+#define LOG_SD_HIST_BINS        12
+
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;
+    uint32_t single_ms[LOG_SD_HIST_BINS];   /* One-sector writes */
+    uint32_t multi_ms[LOG_SD_HIST_BINS];    /* Multi-sector or streamed writes */
+    uint32_t busy_ms;
+    uint32_t busy_max_ms;
+    uint32_t busy_waits;
+    uint32_t busy_timeouts;
+    uint32_t token_timeouts;
+    uint32_t rejects;
+    uint32_t retries;
+    uint32_t failures;
+    uint32_t worst_ms;
+    uint32_t worst_ms_at;       /* Tick of the slowest write */
+} LogSdHealthRecord_t;
+
+/* Everything up to and including this entry had reached the card */
+typedef struct __attribute__((packed)) {
+    uint32_t time_ms;
+} LogCommitRecord_t;
+
+#ifdef __cplusplus
+static_assert(sizeof(LogFileHeader_t) == LOG_HEADER_SIZE, "log header size");
+#else
+_Static_assert(sizeof(LogFileHeader_t) == LOG_HEADER_SIZE, "log header size");
+#endif
+
+#endif /* LOG_RECORD_H */
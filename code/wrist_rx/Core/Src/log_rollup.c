@@ -0,0 +1,99 @@
+/* ========================================
+   File: log_rollup.c
+   Per-Minute Rollups for the SD Log
+   ======================================== */
+
+#include "log_rollup.h"
+#include <string.h>
+
+typedef struct {
+    uint16_t steps;
+    uint32_t period_sum;
+    uint64_t period_sq;
+    uint16_t hr_count;
+    uint32_t hr_sum;
+    uint8_t hr_min;
+    uint8_t hr_max;
+    uint16_t temp_count;
+    int32_t temp_sum;
+} RollupAcc_t;
+
+/* The minute waiting for its grace period and the one after it */
+static RollupAcc_t acc[2];
+static uint32_t oldest = 0;
+
+void Rollup_Init(void)
+{
+    memset(acc, 0, sizeof(acc));
+    oldest = 0;
+}
+
+/* Late samples go to the oldest open minute, early ones to the newest */
+static RollupAcc_t *Rollup_Slot(uint32_t time_ms)
+{
+    uint32_t minute = time_ms / LOG_ROLLUP_MINUTE_MS;
+    if (minute < oldest) minute = oldest;
+    if (minute > oldest + 1) minute = oldest + 1;
+    return &acc[minute & 1];
+}
+
+void Rollup_AddStep(uint32_t time_ms, uint16_t period)
+{
+    RollupAcc_t *a = Rollup_Slot(time_ms);
+    if (a->steps == 0xFFFF) return;
+    a->steps++;
+    a->period_sum += period;
+    a->period_sq += (uint32_t)period * period;
+}
+
+void Rollup_AddHeartRate(int32_t bpm, uint32_t time_ms)
+{
+    RollupAcc_t *a = Rollup_Slot(time_ms);
+    if (bpm <= 0 || bpm > 255 || a->hr_count == 0xFFFF) return;
+
+    if (a->hr_count == 0 || bpm < a->hr_min) a->hr_min = (uint8_t)bpm;
+    if (a->hr_count == 0 || bpm > a->hr_max) a->hr_max = (uint8_t)bpm;
+    a->hr_count++;
+    a->hr_sum += (uint32_t)bpm;
+}
+
+void Rollup_AddTemperature(int16_t temp_centi, uint32_t time_ms)
+{
+    RollupAcc_t *a = Rollup_Slot(time_ms);
+    if (a->temp_count == 0xFFFF) return;
+    a->temp_count++;
+    a->temp_sum += temp_centi;
+}
+
+/* Next finished minute with any data; returns 1 if none is ready */
+uint8_t Rollup_Get(LogRollupRecord_t *record, uint32_t now)
+{
+    while (now >= (oldest + 1) * LOG_ROLLUP_MINUTE_MS + LOG_ROLLUP_GRACE_MS) {
+        RollupAcc_t *a = &acc[oldest & 1];
+        uint8_t empty = (a->steps == 0 && a->hr_count == 0 && a->temp_count == 0);
+
+        memset(record, 0, sizeof(*record));
+        record->minute = oldest;
+        record->steps = a->steps;
+        if (a->steps > 0) {
+            /* n*sum(x^2) - sum(x)^2 keeps the variance exact in integers */
+            uint64_t n = a->steps;
+            record->period_mean = (uint16_t)((a->period_sum + n / 2) / n);
+            record->period_var = (uint32_t)((a->period_sq * n - (uint64_t)a->period_sum * a->period_sum) / (n * n));
+        }
+        if (a->hr_count > 0) {
+            record->hr_min = a->hr_min;
+            record->hr_mean = (uint8_t)((a->hr_sum + a->hr_count / 2) / a->hr_count);
+            record->hr_max = a->hr_max;
+        }
+        if (a->temp_count > 0) {
+            record->temp_centi = (int16_t)(a->temp_sum / a->temp_count);
+            record->temp_valid = 1;
+        }
+
+        memset(a, 0, sizeof(*a));
+        oldest++;
+        if (!empty) return 0;
+    }
+    return 1;
+}
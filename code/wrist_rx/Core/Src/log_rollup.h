@@ -0,0 +1,30 @@
+/* ========================================
+   File: log_rollup.h
+   Per-Minute Rollups for the SD Log
+
+   Steps, heart rate and ankle temperature are
+   summed per minute of wrist time. A minute is
+   released once the clock is LOG_ROLLUP_GRACE_MS
+   past its end, so steps the aligner delivers late
+   still land in the right minute.
+   ======================================== */
+
+#ifndef LOG_ROLLUP_H
+#define LOG_ROLLUP_H
+
+#include <stdint.h>
+#include "log_record.h"
+
+#define LOG_ROLLUP_MINUTE_MS    60000
+
+/* Longer than the aligner's worst case (ALIGN_MAX_WAIT_MS plus a batch) */
+#define LOG_ROLLUP_GRACE_MS     10000
+
+/* Function prototypes */
+void Rollup_Init(void);
+void Rollup_AddStep(uint32_t time_ms, uint16_t period);
+void Rollup_AddHeartRate(int32_t bpm, uint32_t time_ms);
+void Rollup_AddTemperature(int16_t temp_centi, uint32_t time_ms);
+uint8_t Rollup_Get(LogRollupRecord_t *record, uint32_t now);
+
+#endif /* LOG_ROLLUP_H */
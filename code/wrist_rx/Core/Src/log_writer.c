@@ -0,0 +1,224 @@
+/* ========================================
+   File: log_writer.c
+   Record Front End of the SD Log
+
+   Turns radio packets and heart-rate estimates
+   into journal entries: steps are aligned with HR,
+   steps and vitals are packed into blocks and every
+   minute is rolled up, along with the SD driver's
+   health counters. Shared by the firmware and
+   the host benchmark (code/host), so both exercise
+   the same path into sd_logger.c.
+   ======================================== */
+
+#include "log_writer.h"
+#include "log_record.h"
+#include "log_pack.h"
+#include "log_rollup.h"
+#include "step_align.h"
+#include "fatfs.h"
+#include "prof.h"
+#include <string.h>
+
+/* SD health snapshot period */
+#define LOG_HEALTH_MS           60000
+
+_Static_assert(LOG_SD_HIST_BINS == SD_HIST_BINS, "SD health record out of step with fatfs.h");
+
+static const LogPackSchema_t step_schema = { LOG_STEP_FIELDS, LOG_STEP_ORDER, LOG_STEP_K0, LOG_STEP_K1 };
+static const LogPackSchema_t vitals_schema = { LOG_VITALS_FIELDS, LOG_VITALS_ORDER, LOG_VITALS_K0, LOG_VITALS_K1 };
+static LogPack_t step_pack;
+static LogPack_t vitals_pack;
+static LogWriterStats_t stats;
+static uint32_t last_health;
+
+void LogWriter_Init(void)
+{
+    Logger_Init();
+    Align_Init();
+    Rollup_Init();
+    LogPack_Init(&step_pack, &step_schema);
+    LogPack_Init(&vitals_pack, &vitals_schema);
+    memset(&stats, 0, sizeof(stats));
+    last_health = 0;
+}
+
+/* Needs a mounted volume; returns 0 once the log is open and the boot entry queued */
+uint8_t LogWriter_Open(uint8_t reset_flags)
+{
+    /* The file stays open; the logger writes whole sectors */
+    LogFileHeader_t header = {0};
+    memcpy(header.magic, LOG_MAGIC, sizeof(header.magic));
+    header.version = LOG_VERSION;
+    header.schema_id = LOG_SCHEMA_ID;
+    header.header_size = LOG_HEADER_SIZE;
+    header.sector_size = LOG_SECTOR_SIZE;
+    header.tick_hz = 1000;
+
+    /* Prefer the pre-allocated raw log; plain FatFs appends otherwise */
+    uint8_t result = Logger_OpenContiguous(LOG_STREAM_RECORDS, LOG_FILE_NAME, LOG_PREALLOC_BYTES,
+                                           &header, sizeof(header));
+    if (result != 0) {
+        result = Logger_Open(LOG_STREAM_RECORDS, LOG_FILE_NAME, &header, sizeof(header));
+    }
+    if (result != 0) return result;
+
+    /* Mark the session start; ticks restart from zero on every boot */
+    LogBootRecord_t boot;
+    boot.reset_flags = reset_flags;
+    boot.time_ms = HAL_GetTick();
+    Logger_Append(LOG_STREAM_RECORDS, LOG_REC_BOOT, &boot, sizeof(boot));
+    return 0;
+}
+
+/* Room for the largest entry; callers leave packets in the ring otherwise */
+uint8_t LogWriter_Ready(void)
+{
+    return Logger_Free(LOG_STREAM_RECORDS) >= LOG_ENTRY_MAX;
+}
+
+/* Ankle temperature in 0.01 C, rounded */
+static int16_t Temp_To_Centi(float temp)
+{
+    return (int16_t)(temp * 100.0f + (temp < 0 ? -0.5f : 0.5f));
+}
+
+static uint8_t Clamp_U8(int32_t value)
+{
+    if (value < 0) return 0;
+    if (value > 255) return 255;
+    return (uint8_t)value;
+}
+
+/* Close the block and start the next one sized to the current sector's remainder */
+static void Flush_Pack(LogPack_t *pack, uint8_t type)
+{
+    uint8_t len = LogPack_Finish(pack);
+    if (len > 0) {
+        Logger_Append(LOG_STREAM_RECORDS, type, pack->buf, len);
+    }
+    LogPack_Begin(pack, Logger_Room(LOG_STREAM_RECORDS));
+}
+
+/* Callers check LogWriter_Ready, so a flush here always fits */
+static void Pack_Record(LogPack_t *pack, uint8_t type, const uint32_t *values, uint16_t raw_len)
+{
+    if (LogPack_Add(pack, values, raw_len) != 0) {
+        Flush_Pack(pack, type);
+        LogPack_Add(pack, values, raw_len);
+    }
+}
+
+void LogWriter_HeartRate(int32_t bpm, uint32_t tick)
+{
+    Align_AddHeartRate(bpm, tick);
+    Rollup_AddHeartRate(bpm, tick);
+}
+
+/* Wrist vitals at the time of the ankle packet; its steps come out of the aligner */
+void LogWriter_Packet(const LogPacket_t *packet, uint32_t ir, uint32_t red,
+                      int32_t heart_rate, int32_t spo2, uint8_t flags)
+{
+    PROF_SCOPE(PROF_LOG_PACKET);
+    Align_AddBatch(&packet->data, packet->rx_tick);
+    Rollup_AddTemperature(Temp_To_Centi(packet->data.temp), packet->rx_tick);
+
+    uint32_t values[LOG_VITALS_FIELDS];
+    values[0] = packet->rx_tick;
+    values[1] = ir;
+    values[2] = red;
+    values[3] = Clamp_U8(heart_rate);
+    values[4] = Clamp_U8(spo2);
+    values[5] = flags;
+    Pack_Record(&vitals_pack, LOG_REC_VITALS_PACK, values, sizeof(LogVitalsRecord_t));
+}
+
+static void LogWriter_Steps(void)
+{
+    AlignedStep_t step;
+    uint32_t values[LOG_STEP_FIELDS];
+
+    /* Steps wait in the aligner while the sector buffers are full */
+    while (LogWriter_Ready() && Align_GetRecord(&step, HAL_GetTick()) == 0) {
+        values[0] = step.step_number;
+        values[1] = step.time_ms;
+        values[2] = step.period;
+        values[3] = step.intensity;
+        values[4] = (uint32_t)(int32_t)Temp_To_Centi(step.temp);
+        values[5] = step.hr_valid ? Clamp_U8(step.heart_rate) : 0;
+        Pack_Record(&step_pack, LOG_REC_STEP_PACK, values, sizeof(LogStepRecord_t));
+        Rollup_AddStep(step.time_ms, step.period);
+        stats.steps++;
+    }
+}
+
+/* Open blocks go into the sector just before the commit that makes it durable;
+   until then they grow, and a full block flushes itself on the sector boundary */
+static void LogWriter_FlushPacks(void)
+{
+    if (!Logger_SyncDue(LOG_STREAM_RECORDS)) return;
+
+    if (step_pack.st.count > 0 && LogWriter_Ready()) {
+        Flush_Pack(&step_pack, LOG_REC_STEP_PACK);
+    }
+    if (vitals_pack.st.count > 0 && LogWriter_Ready()) {
+        Flush_Pack(&vitals_pack, LOG_REC_VITALS_PACK);
+    }
+}
+
+static void LogWriter_Rollups(void)
+{
+    LogRollupRecord_t rollup;
+
+    while (LogWriter_Ready() && Rollup_Get(&rollup, HAL_GetTick()) == 0) {
+        Logger_Append(LOG_STREAM_RECORDS, LOG_REC_ROLLUP, &rollup, sizeof(rollup));
+        stats.rollups++;
+    }
+}
+
+static void LogWriter_Health(void)
+{
+    uint32_t now = HAL_GetTick();
+    if (!LogWriter_Ready() || now - last_health < LOG_HEALTH_MS) return;
+
+    const SD_Health_t *h = SD_GetHealth();
+    LogSdHealthRecord_t rec;
+    rec.time_ms = now;
+    memcpy(rec.single_ms, h->single_ms, sizeof(rec.single_ms));
+    memcpy(rec.multi_ms, h->multi_ms, sizeof(rec.multi_ms));
+    rec.busy_ms = h->busy_ms;
+    rec.busy_max_ms = h->busy_max_ms;
+    rec.busy_waits = h->busy_waits;
+    rec.busy_timeouts = h->busy_timeouts;
+    rec.token_timeouts = h->token_timeouts;
+    rec.rejects = h->rejects;
+    rec.retries = h->retries;
+    rec.failures = h->failures;
+    rec.worst_ms = h->worst_ms;
+    rec.worst_ms_at = h->worst_tick;
+
+    if (Logger_Append(LOG_STREAM_RECORDS, LOG_REC_SD_HEALTH, &rec, sizeof(rec)) == 0) {
+        stats.health_records++;
+    }
+    last_health = now;
+}
+
+/* One superloop pass: format what is due, then at most one card operation */
+void LogWriter_Task(void)
+{
+    PROF_SCOPE(PROF_LOG_TASK);
+    LogWriter_Steps();
+    LogWriter_FlushPacks();
+    LogWriter_Rollups();
+    LogWriter_Health();
+    Logger_Task();
+}
+
+const LogWriterStats_t *LogWriter_GetStats(void)
+{
+    stats.step_raw_bytes = step_pack.raw_bytes;
+    stats.step_packed_bytes = step_pack.packed_bytes;
+    stats.vitals_raw_bytes = vitals_pack.raw_bytes;
+    stats.vitals_packed_bytes = vitals_pack.packed_bytes;
+    return &stats;
+}
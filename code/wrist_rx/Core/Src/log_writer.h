@@ -0,0 +1,31 @@
+/* ========================================
+   File: log_writer.h
+   Record Front End of the SD Log
+   ======================================== */
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include "sd_logger.h"
+
+typedef struct {
+    uint32_t step_raw_bytes;    /* Step records before packing */
+    uint32_t step_packed_bytes;
+    uint32_t vitals_raw_bytes;
+    uint32_t vitals_packed_bytes;
+    uint32_t steps;
+    uint32_t rollups;
+    uint32_t health_records;
+} LogWriterStats_t;
+
+/* Function prototypes */
+void LogWriter_Init(void);
+uint8_t LogWriter_Open(uint8_t reset_flags);
+uint8_t LogWriter_Ready(void);
+void LogWriter_HeartRate(int32_t bpm, uint32_t tick);
+void LogWriter_Packet(const LogPacket_t *packet, uint32_t ir, uint32_t red,
+                      int32_t heart_rate, int32_t spo2, uint8_t flags);
+void LogWriter_Task(void);
+const LogWriterStats_t *LogWriter_GetStats(void);
+
+#endif /* LOG_WRITER_H */
@@ -1,58 +1,190 @@
 /* ========================================
    File: main.c
    STM32F446RE Data Logger - Main Program
+
+   FreeRTOS tasks, highest priority first:
+   radio (nRF24 FIFO every 10 ms), sensor
+   (MAX30102 every 100 ms), compute (motion
+   cancelling, HR/SpO2, packet vitals) and log
+   (SD journal); console output leaves USART2 by
+   DMA without a task of its own. Stages hand data
+   on through static queues, so a card that stays
+   busy for hundreds of ms only holds up the log
+   task.
    ======================================== */
 
 #include "main.h"
 #include "nrf24.h"
 #include "max30102.h"
+#include "motion_cancel.h"
+#include "sd_logger.h"
+#include "log_writer.h"
+#include "log_record.h"
 #include "fatfs.h"
+#include "bus_io.h"
+#include "rtos_support.h"
+#include "prof.h"
+#include "fmt.h"
+#include "energy.h"
+#include "timebase.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
 #include <stdio.h>
 #include <string.h>
 
+/* Task priorities, configMAX_PRIORITIES is 7 */
+#define PRIO_RADIO          5
+#define PRIO_SENSOR         4
+#define PRIO_COMPUTE        3
+#define PRIO_LOG            2
+
+/* Stacks in words. Tasks format through fmt.c; printf is left only in main before
+   the scheduler starts, on the main stack. Deepest paths, with a 104-byte FPU
+   exception frame: log, a FatFs write down to the SD driver or the minute report
+   with its 256-byte energy line, about 1 KB; compute, the 384-byte packet report,
+   about 0.8 KB. Rtos_PrintTaskStats flags LOW below RTOS_STACK_LOW_BYTES free. */
+#define STACK_RADIO         256
+#define STACK_SENSOR        256
+#define STACK_COMPUTE       384
+#define STACK_LOG           512
+
+#define RADIO_POLL_MS       10
+#define SENSOR_PERIOD_MS    100
+#define TEMP_PERIOD_MS      10000
+#define LOG_TASK_MS         20
+#define STATS_PERIOD_MS     60000
+
+#define COMPUTE_QUEUE_LEN   16
+#define PPG_BATCH           4   /* FIFO samples per compute event, 2-3 arrive per sensor pass */
+#define LOG_QUEUE_LEN       48
+#define LOG_QUEUE_RESERVE   16  /* Slots kept for packets; heart-rate events give way first */
+
+#define PPG_SAMPLE_US       (1000000u / MAX30102_SAMPLE_HZ)
+#define PPG_SAMPLE_MS       (1000u / MAX30102_SAMPLE_HZ)
+
+_Static_assert(MC_SAMPLE_RATE_HZ == MAX30102_SAMPLE_HZ, "motion canceller not at the FIFO rate");
+
+enum {
+    EV_PPG,
+    EV_PACKET,
+    EV_HEART_RATE,
+    EV_OFF_WRIST        /* Sensor shut down: no samples until it is worn again */
+};
+
+/* Radio and sensor tasks to the compute task */
+typedef struct {
+    uint8_t type;
+    union {
+        struct {
+            uint32_t ir[PPG_BATCH];
+            uint32_t red[PPG_BATCH];
+            uint32_t tick;      /* Oldest sample of the batch; the rest follow a sample period apart */
+            uint32_t time_us;   /* Same, counted in samples from the sensor start, for peak intervals */
+            float die_temp;
+            uint8_t count;
+        } ppg;
+        LogPacket_t packet;
+    };
+} ComputeEvent_t;
+
+/* Compute task to the log task */
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    int32_t heart_rate;
+    int32_t spo2;
+    uint32_t ir;
+    uint32_t red;
+    uint32_t tick;          /* Heart-rate estimate time */
+    LogPacket_t packet;
+} LogEvent_t;
+
+typedef struct {
+    uint32_t radio_packets;
+    uint32_t radio_dropped;     /* Compute queue full */
+    uint32_t ppg_dropped;
+    uint32_t log_dropped;       /* Log queue full: the card stalled longer than the queue lasts */
+    uint32_t hr_dropped;
+    uint32_t log_queue_peak;
+} WristStats_t;
+
 /* Peripheral handles */
 SPI_HandleTypeDef hspi1;  // nRF24L01
-SPI_HandleTypeDef hspi3;  // SD Card
+SPI_HandleTypeDef hspi2;  // SD Card
+DMA_HandleTypeDef hdma_spi2_rx;
+DMA_HandleTypeDef hdma_spi2_tx;
 I2C_HandleTypeDef hi2c1;  // MAX30102
 UART_HandleTypeDef huart2; // USB Serial (ST-Link)
+DMA_HandleTypeDef hdma_usart2_tx;
 
 /* Application variables */
 sentData_t received_data;
-uint8_t nrf_data_ready = 0;
 
 /* MAX30102 data */
 uint32_t ir_value = 0;
 uint32_t red_value = 0;
+uint32_t ir_clean = 0;
 int32_t heart_rate = 0;
 int32_t spo2 = 0;
 uint8_t valid_heart_rate = 0;
 uint8_t valid_spo2 = 0;
+float wrist_temp = 0.0f;
 
 /* SD Card */
 FATFS FatFs;
-FIL Fil;
 FRESULT fres;
 
+/* Tasks and queues, all static */
+static StaticTask_t radio_tcb, sensor_tcb, compute_tcb, log_tcb;
+static StackType_t radio_stack[STACK_RADIO];
+static StackType_t sensor_stack[STACK_SENSOR];
+static StackType_t compute_stack[STACK_COMPUTE];
+static StackType_t log_stack[STACK_LOG];
+
+static StaticQueue_t compute_queue_cb, log_queue_cb;
+static uint8_t compute_queue_buf[COMPUTE_QUEUE_LEN * sizeof(ComputeEvent_t)];
+static uint8_t log_queue_buf[LOG_QUEUE_LEN * sizeof(LogEvent_t)];
+static QueueHandle_t compute_queue;
+static QueueHandle_t log_queue;
+
+/* Each counter has a single writer task */
+static WristStats_t wrist_stats;
+
 /* Function prototypes */
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
 static void MX_SPI1_Init(void);
-static void MX_SPI3_Init(void);
+static void MX_DMA_Init(void);
+static void MX_SPI2_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_USART2_UART_Init(void);
-void Read_MAX30102_Data(void);
-void Save_Combined_Data_To_SD(void);
+static void Radio_Task(void *argument);
+static void Sensor_Task(void *argument);
+static void Compute_Task(void *argument);
+static void Log_Task(void *argument);
+void Process_Vitals(const uint32_t *ir, const uint32_t *red, uint8_t n, uint32_t tick, uint32_t time_us, float die_temp);
+void Process_Packet(const LogPacket_t *packet);
+void Clear_Vitals(void);
+void Log_Mount(void);
 void Print_Received_Data(void);
+void Print_Logger_Stats(void);
+void Print_Profile(void);
+void Print_Energy(void);
+static void Console_Write(Fmt_t *f);
+static void Console_Text(const char *text);
 
 int main(void)
 {
     HAL_Init();
     SystemClock_Config();
+    Time_Init();
     
     /* Initialize peripherals */
     MX_GPIO_Init();
     MX_SPI1_Init();
-    MX_SPI3_Init();
+    MX_DMA_Init();
+    MX_SPI2_Init();
     MX_I2C1_Init();
     MX_USART2_UART_Init();
     MX_FATFS_Init();
@@ -70,6 +202,10 @@ int main(void)
         printf("MAX30102 initialization FAILED!\r\n");
         printf("Check I2C connections and pull-up resistors\r\n");
     }
+    MotionCancel_Init();
+    Prof_Init();
+    Energy_Init();
+    LogWriter_Init();
     
     /* Initialize nRF24L01 */
     printf("Initializing nRF24L01...\r\n");
@@ -81,147 +217,519 @@ int main(void)
     nRF24_SetRXAddress(0, (uint8_t *)"Node1");
     nRF24_SetPayloadSize(sizeof(sentData_t));
     nRF24_RXMode();
+    Energy_On(ENERGY_RADIO_RX);
     printf("nRF24L01 initialized! Payload size: %d bytes\r\n", sizeof(sentData_t));
     
-    /* Mount SD Card */
-    printf("Mounting SD Card...\r\n");
-    fres = f_mount(&FatFs, "", 1);
-    if (fres != FR_OK) {
-        printf("SD Card mount FAILED! Error: %d\r\n", fres);
-        printf("Continuing without SD card logging...\r\n");
-    } else {
-        printf("SD Card mounted successfully!\r\n");
+    /* The log task mounts the card, so a slow card cannot delay reception */
+    compute_queue = xQueueCreateStatic(COMPUTE_QUEUE_LEN, sizeof(ComputeEvent_t), compute_queue_buf, &compute_queue_cb);
+    log_queue = xQueueCreateStatic(LOG_QUEUE_LEN, sizeof(LogEvent_t), log_queue_buf, &log_queue_cb);
+    Rtos_ConsoleInit();
+    xTaskCreateStatic(Radio_Task, "radio", STACK_RADIO, NULL, PRIO_RADIO, radio_stack, &radio_tcb);
+    xTaskCreateStatic(Sensor_Task, "sensor", STACK_SENSOR, NULL, PRIO_SENSOR, sensor_stack, &sensor_tcb);
+    xTaskCreateStatic(Compute_Task, "compute", STACK_COMPUTE, NULL, PRIO_COMPUTE, compute_stack, &compute_tcb);
+    xTaskCreateStatic(Log_Task, "log", STACK_LOG, NULL, PRIO_LOG, log_stack, &log_tcb);
+    
+    printf("\r\nStarting tasks...\r\n");
+    Rtos_Start();
+    
+    /* Only reached if the scheduler could not start */
+    Error_Handler();
+}
+
+/* The IRQ line is not routed; the RX FIFO holds three payloads, one per 5 steps */
+static void Radio_Task(void *argument)
+{
+    ComputeEvent_t ev;
+    TickType_t wake = xTaskGetTickCount();
+    
+    ev.type = EV_PACKET;
+    for (;;) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(RADIO_POLL_MS));
+        PROF_SCOPE(PROF_RADIO_RX);
         
-        /* Create CSV header if file is new */
-        fres = f_open(&Fil, "sensor_data.csv", FA_WRITE | FA_OPEN_APPEND);
-        if (fres == FR_OK) {
-            if (f_size(&Fil) == 0) {
-                UINT bw;
-                const char *header = "Timestamp,HR,SpO2,IR,Red,StepInitial,";
-                f_write(&Fil, header, strlen(header), &bw);
-                
-                for (int i = 0; i < 5; i++) {
-                    char step_header[32];
-                    sprintf(step_header, "Step%d_Period,Step%d_Intensity,", i+1, i+1);
-                    f_write(&Fil, step_header, strlen(step_header), &bw);
-                }
-                f_write(&Fil, "Temperature\r\n", 13, &bw);
+        while (!nRF24_RxFifoEmpty()) {
+            nRF24_ReadPayload((uint8_t *)&ev.packet.data, sizeof(sentData_t));
+            ev.packet.rx_tick = HAL_GetTick();
+            wrist_stats.radio_packets++;
+            if (xQueueSend(compute_queue, &ev, 0) != pdPASS) {
+                wrist_stats.radio_dropped++;
             }
-            f_close(&Fil);
-            printf("CSV file ready\r\n");
         }
     }
-    
-    printf("\r\nSystem Ready! Waiting for data...\r\n");
-    printf("Place finger on MAX30102 sensor\r\n\r\n");
-    
-    uint32_t last_max30102_read = 0;
-    uint32_t last_save_time = 0;
+}
+
+static void Sensor_Task(void *argument)
+{
+    ComputeEvent_t ev;
+    uint32_t last_temp_start = 0;
     uint32_t led_toggle = 0;
+    uint8_t was_on_wrist = 1;
+    uint8_t anchored = 0;
+    uint32_t first_us = 0, index = 0;
+    TickType_t wake = xTaskGetTickCount();
     
-    while (1)
-    {
+    ev.type = EV_PPG;
+    for (;;) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(SENSOR_PERIOD_MS));
+        
+        /* Die temperature: trigger every 10 s, collect whenever it is ready */
+        if (HAL_GetTick() - last_temp_start >= TEMP_PERIOD_MS) {
+            MAX30102_StartTemperature();
+            last_temp_start = HAL_GetTick();
+        }
+        MAX30102_GetTemperature(&wrist_temp);
+        
+        /* Drain the whole FIFO: without rollover a full one stops taking new samples */
+        static uint32_t ir[MAX30102_FIFO_DEPTH], red[MAX30102_FIFO_DEPTH];
+        uint8_t n;
+        {
+            PROF_SCOPE(PROF_PPG_READ);
+            n = MAX30102_ReadFIFO(ir, red, MAX30102_FIFO_DEPTH);
+        }
+        
+        /* Peak intervals use the sample index at the sensor's rate, not when the drain ran;
+           it is anchored to the newest sample whenever the sensor (re)starts. Log ticks
+           stay on the HAL clock the steps use, counted back from this drain. */
+        if (n > 0 && !anchored) {
+            first_us = Time_NowUs() - (uint32_t)(n - 1) * PPG_SAMPLE_US;
+            index = 0;
+            anchored = 1;
+        }
+        uint32_t now = HAL_GetTick();
+        ev.ppg.die_temp = wrist_temp;
+        for (uint8_t i = 0; i < n; i += ev.ppg.count) {
+            ev.ppg.count = (n - i < PPG_BATCH) ? n - i : PPG_BATCH;
+            memcpy(ev.ppg.ir, &ir[i], ev.ppg.count * sizeof(uint32_t));
+            memcpy(ev.ppg.red, &red[i], ev.ppg.count * sizeof(uint32_t));
+            ev.ppg.time_us = first_us + (index + i) * PPG_SAMPLE_US;
+            ev.ppg.tick = now - (uint32_t)(n - 1 - i) * PPG_SAMPLE_MS;
+            if (xQueueSend(compute_queue, &ev, 0) != pdPASS) {
+                wrist_stats.ppg_dropped += ev.ppg.count;
+            }
+        }
+        index += n;
+        
+        /* Off the wrist no samples arrive, so the last vitals would stand: clear them once */
+        uint8_t on_wrist = MAX30102_IsOnWrist();
+        if (!on_wrist) anchored = 0;
+        if (was_on_wrist && !on_wrist) {
+            ComputeEvent_t off = { .type = EV_OFF_WRIST };
+            if (xQueueSend(compute_queue, &off, 0) != pdPASS) {
+                wrist_stats.ppg_dropped++;
+                on_wrist = 1;   /* Retried next pass */
+            }
+        }
+        was_on_wrist = on_wrist;
+        
         /* Toggle LED to show activity */
         if (HAL_GetTick() - led_toggle >= 500) {
             HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5); // Nucleo LED
+            Energy_Set(ENERGY_LED, (GPIOA->ODR & GPIO_PIN_5) != 0);
             led_toggle = HAL_GetTick();
         }
         
-        /* Check for nRF24 data */
-        if (nRF24_DataReady()) {
-            nRF24_ReadPayload((uint8_t*)&received_data, sizeof(sentData_t));
-            nrf_data_ready = 1;
-            
-            printf("\r\n>>> nRF24 Data Received! <<<\r\n");
-            Print_Received_Data();
+        /* Well inside one CYCCNT wrap (23 s at 180 MHz) */
+        Energy_Update();
+    }
+}
+
+static void Compute_Task(void *argument)
+{
+    ComputeEvent_t ev;
+    
+    for (;;) {
+        xQueueReceive(compute_queue, &ev, portMAX_DELAY);
+        if (ev.type == EV_PPG) {
+            Process_Vitals(ev.ppg.ir, ev.ppg.red, ev.ppg.count, ev.ppg.tick, ev.ppg.time_us, ev.ppg.die_temp);
+        } else if (ev.type == EV_OFF_WRIST) {
+            Clear_Vitals();
+        } else {
+            Process_Packet(&ev.packet);
         }
+    }
+}
+
+static void Log_Event(const LogEvent_t *ev)
+{
+    if (ev->type == EV_HEART_RATE) {
+        LogWriter_HeartRate(ev->heart_rate, ev->tick);
+    } else {
+        LogWriter_Packet(&ev->packet, ev->ir, ev->red, ev->heart_rate, ev->spo2, ev->flags);
+    }
+}
+
+/* Lowest application priority: card waits block here and nowhere else */
+static void Log_Task(void *argument)
+{
+    LogEvent_t ev;
+    uint32_t last_stats_print = HAL_GetTick();
+    
+    Log_Mount();
+    Console_Text("\r\nSystem Ready! Waiting for data...\r\nPlace finger on MAX30102 sensor\r\n\r\n");
+    
+    for (;;) {
+        /* Aligned step/HR records become available a few seconds after the step;
+           the writer then does at most one full sector or sync per pass */
+        LogWriter_Task();
         
-        /* Read MAX30102 every 100ms */
-        if (HAL_GetTick() - last_max30102_read >= 100) {
-            Read_MAX30102_Data();
-            last_max30102_read = HAL_GetTick();
+        if (LogWriter_Ready()) {
+            TickType_t wait = pdMS_TO_TICKS(LOG_TASK_MS);
+            while (LogWriter_Ready() && xQueueReceive(log_queue, &ev, wait) == pdPASS) {
+                Log_Event(&ev);
+                wait = 0;
+            }
+        } else {
+            /* Sector buffers full: events wait in the queue */
+            vTaskDelay(pdMS_TO_TICKS(LOG_TASK_MS));
         }
         
-        /* Save combined data every 1 second if nRF24 data available */
-        if (nrf_data_ready && (HAL_GetTick() - last_save_time >= 1000)) {
-            Save_Combined_Data_To_SD();
-            last_save_time = HAL_GetTick();
+        if (HAL_GetTick() - last_stats_print >= STATS_PERIOD_MS) {
+            Print_Logger_Stats();
+            last_stats_print = HAL_GetTick();
         }
         
-        HAL_Delay(10);
+        /* Console commands: 'p' dumps the profile probes, 'r' clears them */
+        switch (Rtos_ConsoleCommand()) {
+        case 'p':
+            Print_Profile();
+            break;
+        case 'r':
+            Prof_Reset();
+            Console_Text("Profile reset\r\n");
+            break;
+        default:
+            break;
+        }
     }
 }
 
-void Read_MAX30102_Data(void)
+void Log_Mount(void)
 {
-    if (MAX30102_ReadFIFO(&ir_value, &red_value) == 0) {
-        /* Calculate heart rate and SpO2 */
-        MAX30102_CalculateHeartRate(ir_value, &heart_rate, &valid_heart_rate);
-        MAX30102_CalculateSpO2(ir_value, red_value, &spo2, &valid_spo2);
+    char line[160];
+    Fmt_t f;
+    
+    Console_Text("Mounting SD Card...\r\n");
+    fres = f_mount(&FatFs, "", 1);
+    if (fres != FR_OK) {
+        Fmt_Init(&f, line, sizeof(line));
+        Fmt_Str(&f, "SD Card mount FAILED! Error: ");
+        Fmt_I32(&f, fres);
+        Fmt_Str(&f, "\r\nContinuing without SD card logging...\r\n");
+        Console_Write(&f);
+        return;
+    }
+    Console_Text("SD Card mounted successfully!\r\n");
+    
+    if (LogWriter_Open((uint8_t)(RCC->CSR >> 24)) == 0) {
+        __HAL_RCC_CLEAR_RESET_FLAGS();
         
-        /* Print only when valid */
-        static uint32_t last_print = 0;
-        if (HAL_GetTick() - last_print >= 2000 && valid_heart_rate) {
-            printf("HR: %ld bpm, SpO2: %ld%%, IR: %lu, Red: %lu\r\n", 
-                   heart_rate, spo2, ir_value, red_value);
-            last_print = HAL_GetTick();
+        const LogStats_t *st = Logger_GetStats();
+        Fmt_Init(&f, line, sizeof(line));
+        Fmt_Str(&f, "Log file " LOG_FILE_NAME " ready (");
+        Fmt_Str(&f, Logger_IsRaw(LOG_STREAM_RECORDS) ? "contiguous, raw CMD25" : "FatFs append");
+        Fmt_Str(&f, "), session ");
+        Fmt_U32(&f, Logger_Session(LOG_STREAM_RECORDS));
+        Fmt_Str(&f, ", entry ");
+        Fmt_U32(&f, Logger_NextSeq(LOG_STREAM_RECORDS));
+        Fmt_Str(&f, ", ");
+        Fmt_U32(&f, st->recovered_entries);
+        Fmt_Str(&f, " recovered, ");
+        Fmt_U32(&f, st->torn_entries);
+        Fmt_Str(&f, " torn, ");
+        Fmt_U32(&f, st->recovery_reads);
+        Fmt_Str(&f, " reads\r\n");
+        Console_Write(&f);
+    } else {
+        Console_Text("✗ SD Open Error\r\n");
+    }
+}
+
+/* One PPG batch: tick and time_us are for its oldest sample */
+void Process_Vitals(const uint32_t *ir, const uint32_t *red, uint8_t n, uint32_t tick, uint32_t time_us, float die_temp)
+{
+    uint32_t clean[PPG_BATCH];
+    PROF_SCOPE(PROF_VITALS);
+    ir_value = ir[n - 1];
+    red_value = red[n - 1];
+    
+    /* Remove cadence-locked arm-swing artifact before peak detection */
+    MotionCancel_Process(ir, clean, n);
+    ir_clean = clean[n - 1];
+    
+    /* Heart rate over the whole batch; SpO2 reads the sensor's buffers, so once per batch is enough */
+    MAX30102_CalculateHeartRate(clean, n, time_us, &heart_rate, &valid_heart_rate);
+    MAX30102_CalculateSpO2(ir_value, red_value, &spo2, &valid_spo2);
+    
+    if (valid_heart_rate) {
+        LogEvent_t ev;
+        ev.type = EV_HEART_RATE;
+        ev.heart_rate = heart_rate;
+        ev.tick = tick + (uint32_t)(n - 1) * PPG_SAMPLE_MS;
+        if (uxQueueSpacesAvailable(log_queue) <= LOG_QUEUE_RESERVE || xQueueSend(log_queue, &ev, 0) != pdPASS) {
+            wrist_stats.hr_dropped++;
+        }
+    }
+    
+    /* Print only when valid */
+    static uint32_t last_print = 0;
+    if (HAL_GetTick() - last_print >= 2000 && valid_heart_rate) {
+        char line[96];
+        Fmt_t f;
+        Fmt_Init(&f, line, sizeof(line));
+        Fmt_Str(&f, "HR: ");
+        Fmt_I32(&f, heart_rate);
+        Fmt_Str(&f, " bpm, SpO2: ");
+        Fmt_I32(&f, spo2);
+        Fmt_Str(&f, "%, IR: ");
+        Fmt_U32(&f, ir_value);
+        Fmt_Str(&f, ", Red: ");
+        Fmt_U32(&f, red_value);
+        Fmt_Str(&f, ", Die: ");
+        Fmt_Float(&f, die_temp, 2);
+        Fmt_Str(&f, " C\r\n");
+        Console_Write(&f);
+        last_print = HAL_GetTick();
+    }
+}
+
+/* Packets logged while the band is off carry zero vitals, flagged invalid */
+void Clear_Vitals(void)
+{
+    ir_value = 0;
+    red_value = 0;
+    ir_clean = 0;
+    heart_rate = 0;
+    spo2 = 0;
+    valid_heart_rate = 0;
+    valid_spo2 = 0;
+    static const char msg[] = "Sensor off the wrist\r\n";
+    Rtos_ConsoleWrite(msg, sizeof(msg) - 1);
+}
+
+void Process_Packet(const LogPacket_t *packet)
+{
+    LogEvent_t ev;
+    PROF_SCOPE(PROF_PACKET);
+    
+    received_data = packet->data;
+    
+    /* Feed step cadence to the PPG artifact canceller */
+    for (int i = 0; i < 5; i++) {
+        if (received_data.steps[i].period != 0) {
+            MotionCancel_AddStepPeriod(received_data.steps[i].period);
         }
     }
+    
+    Print_Received_Data();
+    
+    /* Wrist vitals at the time of the packet travel with it */
+    ev.type = EV_PACKET;
+    ev.packet = *packet;
+    ev.ir = ir_value;
+    ev.red = red_value;
+    ev.heart_rate = heart_rate;
+    ev.spo2 = spo2;
+    ev.flags = (valid_heart_rate ? LOG_FLAG_HR_VALID : 0) | (valid_spo2 ? LOG_FLAG_SPO2_VALID : 0);
+    if (xQueueSend(log_queue, &ev, 0) != pdPASS) {
+        wrist_stats.log_dropped++;
+    }
+    
+    uint32_t waiting = uxQueueMessagesWaiting(log_queue);
+    if (waiting > wrist_stats.log_queue_peak) wrist_stats.log_queue_peak = waiting;
 }
 
+static void Console_Write(Fmt_t *f)
+{
+    Rtos_ConsoleWrite(f->buf, Fmt_End(f));
+}
+
+static void Console_Text(const char *text)
+{
+    Rtos_ConsoleWrite(text, (int)strlen(text));
+}
+
+/* Per packet, so no printf: one buffer, handed to the console once */
 void Print_Received_Data(void)
 {
-    printf("Step Initial Count: %u\r\n", received_data.step_initial_count);
-    printf("Temperature: %.2f C\r\n", received_data.temp);
-    printf("Steps Data:\r\n");
+    char text[384];
+    Fmt_t f;
+    
+    Fmt_Init(&f, text, sizeof(text));
+    Fmt_Str(&f, "\r\n>>> nRF24 Data Received! <<<\r\nStep Initial Count: ");
+    Fmt_U32(&f, received_data.step_initial_count);
+    Fmt_Str(&f, "\r\nTemperature: ");
+    Fmt_Float(&f, received_data.temp, 2);
+    Fmt_Str(&f, " C\r\nSteps Data:\r\n");
     
     for (int i = 0; i < 5; i++) {
-        printf("  Step %d: Period=%u, Intensity=%u\r\n", 
-               i+1,
-               received_data.steps[i].period,
-               received_data.steps[i].intensity);
+        Fmt_Str(&f, "  Step ");
+        Fmt_U32(&f, i + 1);
+        Fmt_Str(&f, ": Period=");
+        Fmt_U32(&f, received_data.steps[i].period);
+        Fmt_Str(&f, ", Intensity=");
+        Fmt_U32(&f, received_data.steps[i].intensity);
+        Fmt_Str(&f, "\r\n");
     }
-    printf("\r\n");
+    Fmt_Str(&f, "\r\n");
+    Console_Write(&f);
 }
 
-void Save_Combined_Data_To_SD(void)
+/* Report columns joined by sep */
+static void Fmt_List(Fmt_t *f, const uint32_t *values, uint8_t n, const char *sep)
 {
-    char buffer[512];
-    UINT bytes_written;
-    
-    fres = f_open(&Fil, "sensor_data.csv", FA_WRITE | FA_OPEN_APPEND);
-    
-    if (fres == FR_OK) {
-        /* Format: Timestamp, HR, SpO2, IR, Red, StepInitial, Steps[0-4], Temp */
-        int len = sprintf(buffer, "%lu,%ld,%ld,%lu,%lu,%u,",
-                         HAL_GetTick(),
-                         heart_rate,
-                         spo2,
-                         ir_value,
-                         red_value,
-                         received_data.step_initial_count);
-        
-        /* Add all step data */
-        for (int i = 0; i < 5; i++) {
-            len += sprintf(buffer + len, "%u,%u,",
-                          received_data.steps[i].period,
-                          received_data.steps[i].intensity);
-        }
-        
-        /* Add temperature */
-        len += sprintf(buffer + len, "%.2f\r\n", received_data.temp);
-        
-        /* Write to file */
-        f_write(&Fil, buffer, len, &bytes_written);
-        f_close(&Fil);
-        
-        printf("✓ Data saved to SD card (%d bytes)\r\n\r\n", bytes_written);
-        nrf_data_ready = 0; // Clear flag after saving
-    } else {
-        printf("✗ SD Write Error: %d\r\n", fres);
+    for (uint8_t i = 0; i < n; i++) {
+        if (i > 0) Fmt_Str(f, sep);
+        Fmt_U32(f, values[i]);
     }
 }
 
+/* One buffer per line, like the per-packet report */
+void Print_Logger_Stats(void)
+{
+    char line[192];
+    Fmt_t f;
+    
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "Radio: rx ");
+    Fmt_U32(&f, wrist_stats.radio_packets);
+    Fmt_Str(&f, ", dropped ");
+    Fmt_U32(&f, wrist_stats.radio_dropped);
+    Fmt_Str(&f, " (compute queue), ");
+    Fmt_U32(&f, wrist_stats.log_dropped);
+    Fmt_Str(&f, " (log queue), log queue peak ");
+    Fmt_U32(&f, wrist_stats.log_queue_peak);
+    Fmt_Char(&f, '/');
+    Fmt_U32(&f, LOG_QUEUE_LEN);
+    Fmt_Str(&f, "\r\n");
+    Console_Write(&f);
+    
+    const LogStats_t *st = Logger_GetStats();
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "Log: deferred ");
+    Fmt_U32(&f, st->records_deferred);
+    Fmt_Str(&f, ", sectors ");
+    Fmt_U32(&f, st->sectors_written);
+    Fmt_Str(&f, ", err ");
+    Fmt_U32(&f, st->write_errors);
+    Fmt_Str(&f, ", full ");
+    Fmt_U32(&f, st->sectors_dropped);
+    Fmt_Str(&f, ", commits ");
+    Fmt_U32(&f, st->commits);
+    Fmt_Str(&f, ", write max ");
+    Fmt_U32(&f, st->write_max_ms);
+    Fmt_Str(&f, " ms, sync max ");
+    Fmt_U32(&f, st->sync_max_ms);
+    Fmt_Str(&f, " ms\r\n");
+    Console_Write(&f);
+    
+    const LogWriterStats_t *ws = LogWriter_GetStats();
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "Pack: steps ");
+    Fmt_U32(&f, ws->step_raw_bytes);
+    Fmt_Str(&f, " -> ");
+    Fmt_U32(&f, ws->step_packed_bytes);
+    Fmt_Str(&f, " bytes, vitals ");
+    Fmt_U32(&f, ws->vitals_raw_bytes);
+    Fmt_Str(&f, " -> ");
+    Fmt_U32(&f, ws->vitals_packed_bytes);
+    Fmt_Str(&f, " bytes, ");
+    Fmt_U32(&f, ws->rollups);
+    Fmt_Str(&f, " minutes\r\n");
+    Console_Write(&f);
+    
+    /* Histogram columns: <1, 1, 2-3, 4-7 ... 512-1023, >=1024 ms */
+    const SD_Health_t *sd = SD_GetHealth();
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "SD single: ");
+    Fmt_List(&f, sd->single_ms, SD_HIST_BINS, " ");
+    Fmt_Str(&f, "\r\nSD multi:  ");
+    Fmt_List(&f, sd->multi_ms, SD_HIST_BINS, " ");
+    Fmt_Str(&f, "\r\n");
+    Console_Write(&f);
+    
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "SD: busy ");
+    Fmt_U32(&f, sd->busy_ms);
+    Fmt_Str(&f, " ms in ");
+    Fmt_U32(&f, sd->busy_waits);
+    Fmt_Str(&f, " waits (max ");
+    Fmt_U32(&f, sd->busy_max_ms);
+    Fmt_Str(&f, ", ");
+    Fmt_U32(&f, sd->busy_timeouts);
+    Fmt_Str(&f, " timeouts), retries ");
+    Fmt_U32(&f, sd->retries);
+    Fmt_Str(&f, ", failed ");
+    Fmt_U32(&f, sd->failures);
+    Fmt_Str(&f, ", rejects ");
+    Fmt_U32(&f, sd->rejects);
+    Fmt_Str(&f, ", token timeouts ");
+    Fmt_U32(&f, sd->token_timeouts);
+    Fmt_Str(&f, ", worst ");
+    Fmt_U32(&f, sd->worst_ms);
+    Fmt_Str(&f, " ms at ");
+    Fmt_U32(&f, sd->worst_tick);
+    Fmt_Str(&f, "\r\n");
+    Console_Write(&f);
+    
+    const BusStats_t *bs = Bus_GetStats();
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "I2C: ");
+    Fmt_U32(&f, bs->transfers);
+    Fmt_Str(&f, " transfers, ");
+    Fmt_U32(&f, bs->errors);
+    Fmt_Str(&f, " errors, ");
+    Fmt_U32(&f, bs->timeouts);
+    Fmt_Str(&f, " timeouts\r\n");
+    Console_Write(&f);
+    
+    const UartTxStats_t *cs = Rtos_GetConsoleStats();
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "Dropped: ");
+    Fmt_U32(&f, wrist_stats.ppg_dropped);
+    Fmt_Str(&f, " PPG samples, ");
+    Fmt_U32(&f, wrist_stats.hr_dropped);
+    Fmt_Str(&f, " HR estimates, ");
+    Fmt_U32(&f, cs->bytes_dropped);
+    Fmt_Str(&f, " console bytes (peak ");
+    Fmt_U32(&f, cs->peak);
+    Fmt_Char(&f, '/');
+    Fmt_U32(&f, RTOS_CONSOLE_BUFFER);
+    Fmt_Str(&f, ", ");
+    Fmt_U32(&f, cs->errors);
+    Fmt_Str(&f, " UART errors)\r\n");
+    Console_Write(&f);
+    
+    Rtos_PrintTaskStats();
+    Print_Energy();
+}
+
+/* Charge and battery life so far, then the same totals as an energy_est trace line */
+void Print_Energy(void)
+{
+    EnergyReport_t r;
+    char line[256];
+    
+    Energy_Report(&r);
+    Rtos_ConsoleWrite(line, Energy_FormatSummary(&r, line, sizeof(line)));
+    Rtos_ConsoleWrite(line, Energy_FormatTrace(&r, line, sizeof(line)));
+}
+
+/* Probe table a line at a time, so the console ring never fills */
+void Print_Profile(void)
+{
+#if PROF_ENABLE
+    char line[128];
+    
+    Rtos_ConsoleWrite(line, Prof_FormatHeader(line, sizeof(line)));
+    for (uint8_t i = 0; i < PROF_COUNT; i++) {
+        Rtos_ConsoleWrite(line, Prof_FormatLine((ProfProbe_t)i, line, sizeof(line)));
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+#else
+    Console_Text("Profiling disabled: build with DEBUG or PROF_ENABLE=1\r\n");
+#endif
+}
+
 void SystemClock_Config(void)
 {
     RCC_OscInitTypeDef RCC_OscInitStruct = {0};
@@ -287,20 +795,38 @@ static void MX_SPI1_Init(void)
     HAL_SPI_Init(&hspi1);
 }
 
-static void MX_SPI3_Init(void)
+static void MX_SPI2_Init(void)
 {
-    hspi3.Instance = SPI3;
-    hspi3.Init.Mode = SPI_MODE_MASTER;
-    hspi3.Init.Direction = SPI_DIRECTION_2LINES;
-    hspi3.Init.DataSize = SPI_DATASIZE_8BIT;
-    hspi3.Init.CLKPolarity = SPI_POLARITY_LOW;
-    hspi3.Init.CLKPhase = SPI_PHASE_1EDGE;
-    hspi3.Init.NSS = SPI_NSS_SOFT;
-    hspi3.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_8;
-    hspi3.Init.FirstBit = SPI_FIRSTBIT_MSB;
-    hspi3.Init.TIMode = SPI_TIMODE_DISABLE;
-    hspi3.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
-    HAL_SPI_Init(&hspi3);
+    /* Starts slow; fatfs_sd raises the clock once the card is identified */
+    hspi2.Instance = SPI2;
+    hspi2.Init.Mode = SPI_MODE_MASTER;
+    hspi2.Init.Direction = SPI_DIRECTION_2LINES;
+    hspi2.Init.DataSize = SPI_DATASIZE_8BIT;
+    hspi2.Init.CLKPolarity = SPI_POLARITY_LOW;
+    hspi2.Init.CLKPhase = SPI_PHASE_1EDGE;
+    hspi2.Init.NSS = SPI_NSS_SOFT;
+    hspi2.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_128;
+    hspi2.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    hspi2.Init.TIMode = SPI_TIMODE_DISABLE;
+    hspi2.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    HAL_SPI_Init(&hspi2);
+}
+
+static void MX_DMA_Init(void)
+{
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    /* DMA1 Stream3 = SPI2_RX, Stream4 = SPI2_TX (SD sectors); they wake
+       the log task, so they sit at the FreeRTOS syscall level */
+    HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+
+    /* DMA1 Stream6 = USART2_TX (console); no kernel calls, so at the
+       USART2 level, where neither callback can interrupt the other */
+    HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
 }
 
 static void MX_USART2_UART_Init(void)
@@ -345,16 +871,15 @@ static void MX_GPIO_Init(void)
     GPIO_InitStruct.Pin = GPIO_PIN_4;
     HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
 
-    /* SD Card CS Pin - PA15 */
-    HAL_GPIO_WritePin(GPIOA, GPIO_PIN_15, GPIO_PIN_SET);
-    GPIO_InitStruct.Pin = GPIO_PIN_15;
-    HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+    /* SD Card CS Pin - PB12 */
+    HAL_GPIO_WritePin(GPIOB, GPIO_PIN_12, GPIO_PIN_SET);
+    GPIO_InitStruct.Pin = GPIO_PIN_12;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
 }
 
 int _write(int file, char *ptr, int len)
 {
-    HAL_UART_Transmit(&huart2, (uint8_t*)ptr, len, HAL_MAX_DELAY);
-    return len;
+    return Rtos_ConsoleWrite(ptr, len);
 }
 
 void Error_Handler(void)
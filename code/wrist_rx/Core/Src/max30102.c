@@ -4,26 +4,97 @@
    ======================================== */
 
 #include "max30102.h"
-#include <math.h>
+#include "dsp.h"
+#include "bus_io.h"
 
 static I2C_HandleTypeDef *hi2c_max30102;
 
+#define MAX30102_TIMEOUT_MS     100
+
 #define BUFFER_SIZE 100
 static uint32_t ir_buffer[BUFFER_SIZE];
 static uint32_t red_buffer[BUFFER_SIZE];
 static uint8_t buffer_index = 0;
 
+/* Automatic LED gain control: keep averaged DC inside the target band */
+#define AGC_WINDOW              16
+#define AGC_DC_LOW              100000
+#define AGC_DC_TARGET           150000
+#define AGC_DC_HIGH             200000
+#define AGC_PA_MIN              0x04
+#define AGC_PA_MAX              0xFF
+#define AGC_PA_INIT             0x24
+#define AGC_SETTLE_SAMPLES      4
+
+/* Off-wrist gating: below this DC nothing is reflecting the LEDs */
+#define AGC_NO_CONTACT_IR       10000
+#define AGC_OFF_WRIST_WINDOWS   3
+#define AGC_PROBE_INTERVAL_MS   1000
+#define AGC_PROBE_TIMEOUT_MS    100
+
+#define MODE_SPO2               0x03
+#define MODE_SHUTDOWN           0x80
+#define PW_MASK                 0x03
+
+typedef enum {
+    AGC_ON_WRIST = 0,
+    AGC_OFF_WRIST,
+    AGC_PROBING
+} AGC_State_t;
+
+static AGC_State_t agc_state = AGC_ON_WRIST;
+static uint8_t led_red_pa = AGC_PA_INIT;
+static uint8_t led_ir_pa = AGC_PA_INIT;
+static uint8_t spo2_config = 0x27;
+static uint32_t agc_ir_sum = 0;
+static uint32_t agc_red_sum = 0;
+static uint8_t agc_count = 0;
+static uint8_t agc_off_windows = 0;
+static uint8_t agc_settle = 0;
+static uint8_t spo2_settle = 0;
+static uint32_t agc_state_tick = 0;
+
+/* Die temperature conversion */
+#define TEMP_EN                 0x01
+#define INT_DIE_TEMP_RDY        0x02
+#define TEMP_CONV_MS            30
+#define TEMP_TIMEOUT_MS         100
+
+static uint8_t temp_pending = 0;
+static uint32_t temp_start_tick = 0;
+
+/* Heart rate: pulse peaks in the band-passed IR, a block at a time */
+#define HR_MIN_IR               50000
+#define HR_PEAK_FLOOR           100         /* Counts; weaker pulses are noise */
+#define HR_REFRACTORY           7           /* Samples, 214 bpm at 25 sps */
+#define HR_DECAY_Q15            31785       /* Threshold x0.97 per sample */
+#define HR_KEEP_Q15             16384       /* Next threshold at half the last peak */
+
+/* 0.5 Hz high-pass then 4 Hz low-pass, 2nd-order Butterworth at 25 sps, halved (post shift 1).
+   b1 = -2 b0 and b2 = b0 exactly in the high-pass, so the DC level cancels in full. */
+static const int32_t hr_coeffs[2 * DSP_BIQUAD_COEFFS] = {
+    982440638, -1964881276, 982440638, 1957103774, -898916953,
+    156040332,   312080664, 156040332,  720512000, -270931504
+};
+static int32_t hr_state[2 * DSP_BIQUAD_STATE];
+static DSP_BiquadQ31_t hr_filter;
+static DSP_PeakQ31_t hr_peaks;
+static uint8_t hr_primed = 0;
+
+/* Register pointer write plus repeated-start read; the calling task sleeps meanwhile */
+static uint8_t MAX30102_ReadBurst(uint8_t reg, uint8_t *data, uint16_t len)
+{
+    return Bus_I2C_MemRead(hi2c_max30102, MAX30102_I2C_ADDR, reg, data, len, MAX30102_TIMEOUT_MS);
+}
+
 static uint8_t MAX30102_WriteRegister(uint8_t reg, uint8_t value)
 {
-    uint8_t data[2] = {reg, value};
-    return HAL_I2C_Master_Transmit(hi2c_max30102, MAX30102_I2C_ADDR, data, 2, 100);
+    return Bus_I2C_MemWrite(hi2c_max30102, MAX30102_I2C_ADDR, reg, &value, 1, MAX30102_TIMEOUT_MS);
 }
 
 static uint8_t MAX30102_ReadRegister(uint8_t reg, uint8_t *value)
 {
-    if (HAL_I2C_Master_Transmit(hi2c_max30102, MAX30102_I2C_ADDR, &reg, 1, 100) != HAL_OK)
-        return 1;
-    return HAL_I2C_Master_Receive(hi2c_max30102, MAX30102_I2C_ADDR, value, 1, 100);
+    return MAX30102_ReadBurst(reg, value, 1);
 }
 
 uint8_t MAX30102_Init(I2C_HandleTypeDef *hi2c)
@@ -44,81 +115,284 @@ uint8_t MAX30102_Init(I2C_HandleTypeDef *hi2c)
     MAX30102_WriteRegister(MAX30102_MODE_CONFIG, 0x40);
     HAL_Delay(100);
     
+    led_red_pa = AGC_PA_INIT;
+    led_ir_pa = AGC_PA_INIT;
+    spo2_config = 0x27;
+    agc_state = AGC_ON_WRIST;
+    
     MAX30102_WriteRegister(MAX30102_FIFO_CONFIG, 0x4F);
-    MAX30102_WriteRegister(MAX30102_MODE_CONFIG, 0x03);
-    MAX30102_WriteRegister(MAX30102_SPO2_CONFIG, 0x27);
-    MAX30102_WriteRegister(MAX30102_LED1_PA, 0x24);
-    MAX30102_WriteRegister(MAX30102_LED2_PA, 0x24);
+    MAX30102_WriteRegister(MAX30102_MODE_CONFIG, MODE_SPO2);
+    MAX30102_WriteRegister(MAX30102_SPO2_CONFIG, spo2_config);
+    MAX30102_WriteRegister(MAX30102_LED1_PA, led_red_pa);
+    MAX30102_WriteRegister(MAX30102_LED2_PA, led_ir_pa);
     MAX30102_WriteRegister(MAX30102_INT_ENABLE_1, 0xE0);
+    MAX30102_WriteRegister(MAX30102_INT_ENABLE_2, INT_DIE_TEMP_RDY);
+    temp_pending = 0;
     
     HAL_Delay(100);
     return 0;
 }
 
-uint8_t MAX30102_ReadFIFO(uint32_t *ir_value, uint32_t *red_value)
+static void MAX30102_ClearFIFO(void)
+{
+    MAX30102_WriteRegister(MAX30102_FIFO_WR_PTR, 0);
+    MAX30102_WriteRegister(MAX30102_FIFO_OVF_CNT, 0);
+    MAX30102_WriteRegister(MAX30102_FIFO_RD_PTR, 0);
+}
+
+static void MAX30102_EnterOffWrist(void)
+{
+    MAX30102_WriteRegister(MAX30102_MODE_CONFIG, MODE_SHUTDOWN | MODE_SPO2);
+    agc_state = AGC_OFF_WRIST;
+    agc_state_tick = HAL_GetTick();
+}
+
+static void MAX30102_ResetAGCWindow(void)
+{
+    agc_ir_sum = 0;
+    agc_red_sum = 0;
+    agc_count = 0;
+}
+
+/* Scale a LED amplitude towards the target DC, at most 4x per step */
+static uint8_t MAX30102_ScalePA(uint8_t pa, uint32_t dc)
 {
-    uint8_t data[6];
-    uint8_t wr_ptr, rd_ptr, num_samples;
+    uint32_t next;
     
-    MAX30102_ReadRegister(MAX30102_FIFO_WR_PTR, &wr_ptr);
-    MAX30102_ReadRegister(MAX30102_FIFO_RD_PTR, &rd_ptr);
+    if (dc < AGC_DC_TARGET / 4) {
+        next = (uint32_t)pa * 4;
+    } else {
+        next = ((uint32_t)pa * AGC_DC_TARGET) / dc;
+    }
     
-    num_samples = (wr_ptr - rd_ptr) & 0x1F;
+    if (next == pa) next = (dc < AGC_DC_TARGET) ? pa + 1 : pa - 1;
+    if (next < AGC_PA_MIN) next = AGC_PA_MIN;
+    if (next > AGC_PA_MAX) next = AGC_PA_MAX;
+    return (uint8_t)next;
+}
+
+static void MAX30102_AGC_Update(uint32_t ir_value, uint32_t red_value)
+{
+    agc_ir_sum += ir_value;
+    agc_red_sum += red_value;
+    if (++agc_count < AGC_WINDOW) return;
     
-    if (num_samples == 0) return 1;
+    uint32_t ir_dc = agc_ir_sum / agc_count;
+    uint32_t red_dc = agc_red_sum / agc_count;
+    MAX30102_ResetAGCWindow();
     
-    uint8_t reg = MAX30102_FIFO_DATA;
-    if (HAL_I2C_Master_Transmit(hi2c_max30102, MAX30102_I2C_ADDR, &reg, 1, 100) != HAL_OK)
-        return 1;
+    if (ir_dc < AGC_NO_CONTACT_IR) {
+        if (++agc_off_windows >= AGC_OFF_WRIST_WINDOWS) {
+            agc_off_windows = 0;
+            MAX30102_EnterOffWrist();
+        }
+        return;
+    }
+    agc_off_windows = 0;
     
-    if (HAL_I2C_Master_Receive(hi2c_max30102, MAX30102_I2C_ADDR, data, 6, 100) != HAL_OK)
-        return 1;
+    uint8_t changed = 0;
     
-    *red_value = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
-    *red_value &= 0x3FFFF;
+    if (ir_dc < AGC_DC_LOW || ir_dc > AGC_DC_HIGH) {
+        uint8_t pa = MAX30102_ScalePA(led_ir_pa, ir_dc);
+        uint8_t pw = spo2_config & PW_MASK;
+        
+        /* Out of amplitude range: trade pulse width instead */
+        if (pa == led_ir_pa && pa == AGC_PA_MAX && ir_dc < AGC_DC_LOW && pw < PW_MASK) {
+            pw++;
+        } else if (pa == led_ir_pa && pa == AGC_PA_MIN && ir_dc > AGC_DC_HIGH && pw > 0) {
+            pw--;
+        }
+        
+        if (pw != (spo2_config & PW_MASK)) {
+            spo2_config = (spo2_config & ~PW_MASK) | pw;
+            MAX30102_WriteRegister(MAX30102_SPO2_CONFIG, spo2_config);
+            changed = 1;
+        }
+        if (pa != led_ir_pa) {
+            led_ir_pa = pa;
+            MAX30102_WriteRegister(MAX30102_LED2_PA, led_ir_pa);
+            changed = 1;
+        }
+    }
     
-    *ir_value = ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 8) | data[5];
-    *ir_value &= 0x3FFFF;
+    if (red_dc < AGC_DC_LOW || red_dc > AGC_DC_HIGH) {
+        uint8_t pa = MAX30102_ScalePA(led_red_pa, red_dc);
+        if (pa != led_red_pa) {
+            led_red_pa = pa;
+            MAX30102_WriteRegister(MAX30102_LED1_PA, led_red_pa);
+            changed = 1;
+        }
+    }
     
-    ir_buffer[buffer_index] = *ir_value;
-    red_buffer[buffer_index] = *red_value;
-    buffer_index = (buffer_index + 1) % BUFFER_SIZE;
+    if (changed) {
+        agc_settle = AGC_SETTLE_SAMPLES;
+        spo2_settle = BUFFER_SIZE;
+    }
+}
+
+/* Drains up to max samples, oldest first; returns how many were stored */
+uint8_t MAX30102_ReadFIFO(uint32_t *ir_values, uint32_t *red_values, uint8_t max)
+{
+    static uint8_t data[MAX30102_FIFO_DEPTH * 6];
+    uint8_t ptrs[3];
+    uint8_t num_samples;
     
+    /* Sensor is shut down while off-wrist; wake it briefly to probe */
+    if (agc_state == AGC_OFF_WRIST) {
+        if (HAL_GetTick() - agc_state_tick < AGC_PROBE_INTERVAL_MS) return 0;
+        MAX30102_ClearFIFO();
+        MAX30102_WriteRegister(MAX30102_MODE_CONFIG, MODE_SPO2);
+        agc_state = AGC_PROBING;
+        agc_state_tick = HAL_GetTick();
+        return 0;
+    }
+    
+    /* FIFO_WR_PTR, OVF_COUNTER and FIFO_RD_PTR are adjacent: one burst */
+    if (MAX30102_ReadBurst(MAX30102_FIFO_WR_PTR, ptrs, 3) != HAL_OK)
+        return 0;
+    
+    num_samples = (ptrs[0] - ptrs[2]) & 0x1F;
+    
+    /* Rollover is off, so a full FIFO has the pointers equal and counts overflows */
+    if (num_samples == 0 && ptrs[1] != 0) num_samples = MAX30102_FIFO_DEPTH;
+    
+    if (num_samples == 0) {
+        if (agc_state == AGC_PROBING && HAL_GetTick() - agc_state_tick >= AGC_PROBE_TIMEOUT_MS) {
+            MAX30102_EnterOffWrist();
+        }
+        return 0;
+    }
+    if (num_samples > max) num_samples = max;
+    
+    /* FIFO_DATA does not auto-increment: one burst pops every sample */
+    if (MAX30102_ReadBurst(MAX30102_FIFO_DATA, data, (uint16_t)num_samples * 6) != HAL_OK)
+        return 0;
+    
+    for (uint8_t i = 0; i < num_samples; i++) {
+        const uint8_t *d = &data[i * 6];
+        uint32_t red = (((uint32_t)d[0] << 16) | ((uint32_t)d[1] << 8) | d[2]) & 0x3FFFF;
+        uint32_t ir = (((uint32_t)d[3] << 16) | ((uint32_t)d[4] << 8) | d[5]) & 0x3FFFF;
+        
+        if (agc_state == AGC_PROBING) {
+            if (ir < AGC_NO_CONTACT_IR) {
+                MAX30102_EnterOffWrist();
+                return 0;
+            }
+            agc_state = AGC_ON_WRIST;
+            MAX30102_ResetAGCWindow();
+            agc_settle = AGC_SETTLE_SAMPLES;
+            spo2_settle = BUFFER_SIZE;
+        }
+        
+        ir_values[i] = ir;
+        red_values[i] = red;
+        ir_buffer[buffer_index] = ir;
+        red_buffer[buffer_index] = red;
+        buffer_index = (buffer_index + 1) % BUFFER_SIZE;
+        
+        if (spo2_settle) spo2_settle--;
+        MAX30102_AGC_Update(ir, red);
+        
+        /* A gain window that ends off the wrist shuts the sensor down mid-drain */
+        if (agc_state == AGC_OFF_WRIST) return i + 1;
+    }
+    
+    return num_samples;
+}
+
+uint8_t MAX30102_IsOnWrist(void)
+{
+    return agc_state == AGC_ON_WRIST;
+}
+
+void MAX30102_StartTemperature(void)
+{
+    if (temp_pending) return;
+    
+    temp_start_tick = HAL_GetTick();
+    temp_pending = 1;
+    MAX30102_WriteRegister(MAX30102_TEMP_CONFIG, TEMP_EN);
+}
+
+uint8_t MAX30102_GetTemperature(float *temperature)
+{
+    uint8_t status, data[2];
+    
+    if (!temp_pending) return 1;
+    
+    /* The INT pin is not routed: don't touch the bus before the ~29 ms conversion can finish */
+    if (HAL_GetTick() - temp_start_tick < TEMP_CONV_MS) return 1;
+    
+    if (MAX30102_ReadRegister(MAX30102_INT_STATUS_2, &status) != HAL_OK) return 1;
+    if (!(status & INT_DIE_TEMP_RDY)) {
+        if (HAL_GetTick() - temp_start_tick >= TEMP_TIMEOUT_MS) temp_pending = 0;
+        return 1;
+    }
+    
+    /* TEMP_INT and TEMP_FRAC are adjacent, fetch both in one burst */
+    if (MAX30102_ReadBurst(MAX30102_TEMP_INT, data, 2) != HAL_OK)
+        return 1;
+    
+    temp_pending = 0;
+    *temperature = (float)(int8_t)data[0] + ((float)(data[1] & 0x0F) * 0.0625f);
     return 0;
 }
 
-float MAX30102_ReadTemperature(void)
+/* Restart the filter as if it had long seen this level: no step response to ring through the peaks */
+static void MAX30102_PrimeHeartRate(uint32_t ir_value)
 {
-    uint8_t temp_int, temp_frac;
-    MAX30102_WriteRegister(MAX30102_MODE_CONFIG, 0x03);
-    HAL_Delay(30);
-    MAX30102_ReadRegister(MAX30102_TEMP_INT, &temp_int);
-    MAX30102_ReadRegister(MAX30102_TEMP_FRAC, &temp_frac);
-    return (float)temp_int + ((float)temp_frac * 0.0625f);
+    DSP_BiquadQ31_Init(&hr_filter, 2, 1, hr_coeffs, hr_state);
+    hr_state[0] = (int32_t)ir_value;
+    hr_state[1] = (int32_t)ir_value;
+    DSP_PeakQ31_Init(&hr_peaks, HR_PEAK_FLOOR, HR_REFRACTORY, HR_DECAY_Q15, HR_KEEP_Q15);
+    hr_primed = 1;
 }
 
-void MAX30102_CalculateHeartRate(uint32_t ir_value, int32_t *heart_rate, uint8_t *valid)
+/* ir: n consecutive samples (n <= MAX30102_FIFO_DEPTH), the first taken at first_us on the timebase.h clock */
+void MAX30102_CalculateHeartRate(const uint32_t *ir, uint8_t n, uint32_t first_us, int32_t *heart_rate, uint8_t *valid)
 {
-    static uint32_t last_peak_time = 0;
-    static uint32_t last_ir = 0;
+    static uint32_t last_peak_us = 0;
+    static uint8_t have_peak = 0;
     static int32_t accumulated_hr = 0;
     static uint8_t hr_count = 0;
+    int32_t filtered[MAX30102_FIFO_DEPTH];
+    uint32_t peaks[MAX30102_FIFO_DEPTH / HR_REFRACTORY + 1];
     
     *valid = 0;
     
-    if (ir_value < 50000) {
-        *heart_rate = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        if (ir[i] < HR_MIN_IR) {
+            *heart_rate = 0;
+            hr_primed = 0;
+            have_peak = 0;
+            return;
+        }
+    }
+    
+    /* Skip the DC step caused by an LED gain change */
+    if (agc_settle) {
+        agc_settle = (agc_settle > n) ? agc_settle - n : 0;
+        hr_primed = 0;
+        have_peak = 0;
         return;
     }
     
-    if (ir_value > last_ir && (ir_value - last_ir) > 1000) {
-        uint32_t current_time = HAL_GetTick();
+    if (!hr_primed) MAX30102_PrimeHeartRate(ir[0]);
+    
+    /* Samples are 18-bit, so the block is a Q31 block of counts */
+    uint32_t first_index = hr_peaks.index;
+    DSP_BiquadQ31_Process(&hr_filter, (const int32_t *)ir, filtered, n);
+    uint16_t found = DSP_PeakQ31_Process(&hr_peaks, filtered, n, peaks, sizeof(peaks) / sizeof(peaks[0]));
+    
+    for (uint16_t p = 0; p < found; p++) {
+        /* A peak can be the last sample of the previous block */
+        uint32_t peak_us = first_us + (uint32_t)((int32_t)(peaks[p] - first_index) * (int32_t)(1000000 / MAX30102_SAMPLE_HZ));
         
-        if (last_peak_time != 0) {
-            uint32_t interval = current_time - last_peak_time;
+        if (have_peak) {
+            uint32_t interval = peak_us - last_peak_us;
             
-            if (interval > 300 && interval < 2000) {
-                int32_t bpm = 60000 / interval;
+            if (interval > 300000 && interval < 2000000) {
+                int32_t bpm = (int32_t)((60000000u + interval / 2) / interval);
                 
                 if (bpm >= 40 && bpm <= 200) {
                     accumulated_hr += bpm;
@@ -133,40 +407,38 @@ void MAX30102_CalculateHeartRate(uint32_t ir_value, int32_t *heart_rate, uint8_t
                 }
             }
         }
-        last_peak_time = current_time;
+        last_peak_us = peak_us;
+        have_peak = 1;
     }
-    last_ir = ir_value;
 }
 
 void MAX30102_CalculateSpO2(uint32_t ir_value, uint32_t red_value, int32_t *spo2, uint8_t *valid)
 {
     *valid = 0;
     
-    if (ir_value < 50000 || red_value < 50000) {
+    if (ir_value < 50000 || red_value < 50000 || spo2_settle) {
         *spo2 = 0;
         return;
     }
     
-    float ac_red = 0, dc_red = 0, ac_ir = 0, dc_ir = 0;
+    /* Samples are 18-bit, so the buffers can be treated as Q31 blocks */
+    int32_t dc_red = (int32_t)(DSP_SumQ31((const int32_t *)red_buffer, BUFFER_SIZE) / BUFFER_SIZE);
+    int32_t dc_ir = (int32_t)(DSP_SumQ31((const int32_t *)ir_buffer, BUFFER_SIZE) / BUFFER_SIZE);
     
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        dc_red += red_buffer[i];
-        dc_ir += ir_buffer[i];
+    if (dc_red == 0 || dc_ir == 0) {
+        *spo2 = 0;
+        return;
     }
-    dc_red /= BUFFER_SIZE;
-    dc_ir /= BUFFER_SIZE;
     
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        ac_red += fabs((float)red_buffer[i] - dc_red);
-        ac_ir += fabs((float)ir_buffer[i] - dc_ir);
-    }
+    uint64_t ac_red = DSP_AbsDevQ31((const int32_t *)red_buffer, BUFFER_SIZE, dc_red);
+    uint64_t ac_ir = DSP_AbsDevQ31((const int32_t *)ir_buffer, BUFFER_SIZE, dc_ir);
     
-    if (dc_red == 0 || dc_ir == 0) {
+    if (ac_ir == 0) {
         *spo2 = 0;
         return;
     }
     
-    float R = (ac_red / dc_red) / (ac_ir / dc_ir);
+    float R = ((float)ac_red / dc_red) / ((float)ac_ir / dc_ir);
     *spo2 = (int32_t)(-45.060f * R * R + 30.354f * R + 94.845f);
     
     if (*spo2 >= 80 && *spo2 <= 100) {
@@ -0,0 +1,159 @@
+/* ========================================
+   File: motion_cancel.c
+   Cadence-Referenced PPG Motion-Artifact Canceller
+
+   Arm swing shows up in the IR signal at the step
+   frequency and its harmonics. The ankle tells us the
+   step period, so we synthesise sin/cos references at
+   those frequencies and let an NLMS filter subtract
+   whatever part of the PPG AC component they explain.
+   The references and taps are Q15 so each estimate is
+   two SMLALDs (dsp.h); weights keep 8 fraction bits
+   so small updates still add up. No sample history.
+   ======================================== */
+
+#include "motion_cancel.h"
+#include "dsp.h"
+#include <math.h>
+
+#define MC_TWO_PI               6.28318530718f
+#define MC_MIN_IR               50000       /* Same no-finger level as the HR code */
+#define MC_DC_ALPHA             0.05f       /* Baseline tracker, ~0.8 s at 25 sps */
+#define MC_PERIOD_ALPHA         0.25f       /* Cadence smoothing across steps */
+#define MC_MU                   0.02f       /* NLMS step size */
+#define MC_W_FRAC               8           /* Weight fraction bits */
+#define MC_W_MAX                ((int32_t)INT16_MAX << MC_W_FRAC)
+
+/* The references are unit phasors, so the NLMS power is MC_NUM_HARMONICS: a fixed gain, Q16 */
+#define MC_GAIN_Q16             ((int32_t)(MC_MU / MC_NUM_HARMONICS * 65536.0f + 0.5f))
+
+static int32_t weights[MC_NUM_TAPS];            /* Counts, MC_W_FRAC fraction bits */
+static int16_t taps[MC_NUM_TAPS];               /* Same in whole counts, for the dot product */
+static float osc_cos = 1.0f, osc_sin = 0.0f;   /* Fundamental phasor */
+static float rot_cos = 1.0f, rot_sin = 0.0f;   /* Per-sample rotation */
+static float period_ms = 0.0f;
+static float dc_level = 0.0f;
+static uint8_t dc_valid = 0;
+static uint8_t active = 0;
+static uint32_t samples_since_step = 0;
+
+static void MotionCancel_ClearWeights(void)
+{
+    for (int i = 0; i < MC_NUM_TAPS; i++) {
+        weights[i] = 0;
+        taps[i] = 0;
+    }
+}
+
+static void MotionCancel_TrackDC(float x)
+{
+    if (!dc_valid) {
+        dc_level = x;
+        dc_valid = 1;
+    } else {
+        dc_level += (x - dc_level) * MC_DC_ALPHA;
+    }
+}
+
+void MotionCancel_Init(void)
+{
+    MotionCancel_ClearWeights();
+    osc_cos = 1.0f;
+    osc_sin = 0.0f;
+    rot_cos = 1.0f;
+    rot_sin = 0.0f;
+    period_ms = 0.0f;
+    dc_level = 0.0f;
+    dc_valid = 0;
+    active = 0;
+    samples_since_step = 0;
+}
+
+void MotionCancel_AddStepPeriod(uint16_t period)
+{
+    if (period < MC_PERIOD_MIN_MS || period > MC_PERIOD_MAX_MS) return;
+
+    if (period_ms == 0.0f) {
+        period_ms = (float)period;
+    } else {
+        period_ms += ((float)period - period_ms) * MC_PERIOD_ALPHA;
+    }
+
+    /* Phase advance per PPG sample at the step frequency */
+    float step = MC_TWO_PI * 1000.0f / (period_ms * MC_SAMPLE_RATE_HZ);
+    rot_cos = cosf(step);
+    rot_sin = sinf(step);
+
+    samples_since_step = 0;
+    active = 1;
+}
+
+static uint32_t MotionCancel_Sample(uint32_t ir_value)
+{
+    if (ir_value < MC_MIN_IR) {
+        dc_valid = 0;
+        return ir_value;
+    }
+
+    float x = (float)ir_value;
+    if (!active) {
+        MotionCancel_TrackDC(x);
+        return ir_value;
+    }
+
+    /* Reference vector, Q15: fundamental and harmonics from the phasor */
+    int16_t ref[MC_NUM_TAPS];
+    float hc = osc_cos, hs = osc_sin;
+    for (int h = 0; h < MC_NUM_HARMONICS; h++) {
+        ref[2 * h] = (int16_t)(hc * 32767.0f);
+        ref[2 * h + 1] = (int16_t)(hs * 32767.0f);
+        float nc = hc * osc_cos - hs * osc_sin;
+        hs = hs * osc_cos + hc * osc_sin;
+        hc = nc;
+    }
+
+    int32_t y = (int32_t)(DSP_DotQ15(taps, ref, MC_NUM_TAPS) >> 15);
+
+    /* Baseline of the cleaned signal: tracking x would follow part of the swing and add it back */
+    MotionCancel_TrackDC(x - (float)y);
+    int32_t err = (int32_t)(x - dc_level) - y;
+    int32_t gain = err * MC_GAIN_Q16;
+    for (int i = 0; i < MC_NUM_TAPS; i++) {
+        /* Q16 gain x Q15 reference, down to MC_W_FRAC bits, rounded */
+        int32_t w = weights[i] + (int32_t)(((int64_t)gain * ref[i] + (1 << (30 - MC_W_FRAC))) >> (31 - MC_W_FRAC));
+        if (w > MC_W_MAX) w = MC_W_MAX;
+        if (w < -MC_W_MAX) w = -MC_W_MAX;
+        weights[i] = w;
+        taps[i] = (int16_t)((w + (1 << (MC_W_FRAC - 1))) >> MC_W_FRAC);
+    }
+
+    /* Advance the phasor and pull its magnitude back to 1 */
+    float c = osc_cos * rot_cos - osc_sin * rot_sin;
+    float s = osc_sin * rot_cos + osc_cos * rot_sin;
+    float g = 1.5f - 0.5f * (c * c + s * s);
+    osc_cos = c * g;
+    osc_sin = s * g;
+
+    if (++samples_since_step > (uint32_t)MC_CADENCE_TIMEOUT_S * MC_SAMPLE_RATE_HZ) {
+        active = 0;
+        period_ms = 0.0f;
+        MotionCancel_ClearWeights();
+    }
+
+    float out = dc_level + (float)err;
+    if (out < 0.0f) out = 0.0f;
+    return (uint32_t)(out + 0.5f);
+}
+
+/* dst may be src */
+void MotionCancel_Process(const uint32_t *src, uint32_t *dst, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = MotionCancel_Sample(src[i]);
+    }
+}
+
+uint8_t MotionCancel_IsActive(void)
+{
+    return active;
+}
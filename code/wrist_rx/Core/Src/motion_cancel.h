@@ -0,0 +1,31 @@
+/* ========================================
+   File: motion_cancel.h
+   Cadence-Referenced PPG Motion-Artifact Canceller
+   ======================================== */
+
+#ifndef MOTION_CANCEL_H
+#define MOTION_CANCEL_H
+
+#include <stdint.h>
+
+/* PPG rate seen by the canceller: every FIFO sample (MAX30102_SAMPLE_HZ, 100 sps averaged by 4) */
+#define MC_SAMPLE_RATE_HZ       25
+
+/* Reference harmonics of the step frequency (sin + cos pair each) */
+#define MC_NUM_HARMONICS        2
+#define MC_NUM_TAPS             (2 * MC_NUM_HARMONICS)
+
+/* Step periods accepted as walking cadence (same window as the ankle) */
+#define MC_PERIOD_MIN_MS        250
+#define MC_PERIOD_MAX_MS        2500
+
+/* Reference is dropped if no step arrives within this many seconds */
+#define MC_CADENCE_TIMEOUT_S    15
+
+/* Function prototypes */
+void MotionCancel_Init(void);
+void MotionCancel_AddStepPeriod(uint16_t period);
+void MotionCancel_Process(const uint32_t *src, uint32_t *dst, uint32_t n);
+uint8_t MotionCancel_IsActive(void);
+
+#endif /* MOTION_CANCEL_H */
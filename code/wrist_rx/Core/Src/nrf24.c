@@ -178,6 +178,12 @@ uint8_t nRF24_DataReady(void)
     return 0;
 }
 
+/* RX_DR flags arrivals; the FIFO can still hold up to three payloads */
+uint8_t nRF24_RxFifoEmpty(void)
+{
+    return (nRF24_ReadRegister(nRF24_REG_FIFO_STATUS) & nRF24_FIFO_RX_EMPTY) ? 1 : 0;
+}
+
 void nRF24_ReadPayload(uint8_t *data, uint8_t length)
 {
     uint8_t cmd = nRF24_CMD_R_RX_PAYLOAD;
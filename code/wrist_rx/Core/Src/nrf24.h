@@ -40,6 +40,9 @@
 #define nRF24_STATUS_TX_DS      0x20
 #define nRF24_STATUS_MAX_RT     0x10
 
+/* FIFO status bits */
+#define nRF24_FIFO_RX_EMPTY     0x01
+
 /* Data rates */
 typedef enum {
     nRF24_DR_250kbps = 0,
@@ -74,6 +77,7 @@ void nRF24_SetPayloadSize(uint8_t size);
 void nRF24_RXMode(void);
 void nRF24_TXMode(void);
 uint8_t nRF24_DataReady(void);
+uint8_t nRF24_RxFifoEmpty(void);
 void nRF24_ReadPayload(uint8_t *data, uint8_t length);
 void nRF24_WritePayload(uint8_t *data, uint8_t length);
 void nRF24_FlushRX(void);
@@ -0,0 +1,144 @@
+/* ========================================
+   File: prof.c
+   Cycle-count Profiling Shared by Ankle and Wrist Nodes
+   ======================================== */
+
+#include "prof.h"
+
+#if PROF_ENABLE
+
+#include "fmt.h"
+#include <string.h>
+
+#if !defined(__arm__)
+#include <time.h>
+#endif
+
+static const char *const probe_names[PROF_COUNT] = {
+#define PROF_NAME(id, name) name,
+    PROF_PROBES(PROF_NAME)
+#undef PROF_NAME
+};
+
+static ProfStats_t stats[PROF_COUNT];
+
+#if defined(__arm__)
+void Prof_Init(void)
+{
+    /* CYCCNT keeps counting if something else already enabled it */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    Prof_Reset();
+}
+
+uint32_t Prof_CyclesPerUs(void)
+{
+    return SystemCoreClock / 1000000;
+}
+#else
+/* Host: nanoseconds stand in for cycles */
+uint32_t Prof_Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+void Prof_Init(void)
+{
+    Prof_Reset();
+}
+
+uint32_t Prof_CyclesPerUs(void)
+{
+    return 1000;
+}
+#endif
+
+void Prof_Record(ProfProbe_t probe, uint32_t cycles)
+{
+    ProfStats_t *s = &stats[probe];
+    uint32_t v = cycles >> PROF_HIST_SHIFT;
+    uint32_t bin = v ? 32 - (uint32_t)__builtin_clz(v) : 0;
+
+    if (s->count == 0 || cycles < s->min) s->min = cycles;
+    if (cycles > s->max) s->max = cycles;
+    s->count++;
+    s->total += cycles;
+    if (bin >= PROF_HIST_BINS) bin = PROF_HIST_BINS - 1;
+    s->hist[bin]++;
+}
+
+void Prof_Reset(void)
+{
+    memset(stats, 0, sizeof(stats));
+}
+
+const ProfStats_t *Prof_Get(ProfProbe_t probe)
+{
+    return &stats[probe];
+}
+
+/* Cycles as microseconds with one decimal, right-aligned in 11 columns */
+static void Format_Us(Fmt_t *f, uint64_t cycles)
+{
+    uint64_t tenths = cycles * 10 / Prof_CyclesPerUs();
+    uint16_t start = f->len;
+
+    Fmt_U64(f, tenths / 10);
+    Fmt_Char(f, '.');
+    Fmt_Char(f, (char)('0' + tenths % 10));
+    Fmt_Right(f, start, 11);
+}
+
+static void Format_Column(Fmt_t *f, const char *text, uint8_t width)
+{
+    uint16_t start = f->len;
+    Fmt_Str(f, text);
+    Fmt_Right(f, start, width);
+}
+
+int Prof_FormatHeader(char *buf, int size)
+{
+    Fmt_t f;
+
+    Fmt_Init(&f, buf, (uint16_t)size);
+    Fmt_Str(&f, "probe");
+    Fmt_Left(&f, 0, 10);
+    Format_Column(&f, "count", 10);
+    Format_Column(&f, "min us", 12);
+    Format_Column(&f, "mean us", 11);
+    Format_Column(&f, "max us", 11);
+    Fmt_Str(&f, "  | log2 bins from <");
+    Fmt_U32(&f, 1u << PROF_HIST_SHIFT);
+    Fmt_Str(&f, " cycles\r\n");
+    return Fmt_End(&f);
+}
+
+/* One probe as a text line ending in \r\n; returns its length */
+int Prof_FormatLine(ProfProbe_t probe, char *buf, int size)
+{
+    const ProfStats_t *s = &stats[probe];
+    Fmt_t f;
+    uint16_t start;
+
+    Fmt_Init(&f, buf, (uint16_t)size);
+    Fmt_Str(&f, probe_names[probe]);
+    Fmt_Left(&f, 0, 10);
+    start = f.len;
+    Fmt_U32(&f, s->count);
+    Fmt_Right(&f, start, 10);
+    Fmt_Char(&f, ' ');
+    Format_Us(&f, s->min);
+    Format_Us(&f, s->count ? s->total / s->count : 0);
+    Format_Us(&f, s->max);
+    Fmt_Str(&f, "  |");
+    for (uint8_t i = 0; i < PROF_HIST_BINS; i++) {
+        Fmt_Char(&f, ' ');
+        Fmt_U32(&f, s->hist[i]);
+    }
+    Fmt_Str(&f, "\r\n");
+    return Fmt_End(&f);
+}
+
+#endif /* PROF_ENABLE */
@@ -0,0 +1,104 @@
+/* ========================================
+   File: prof.h
+   Cycle-count Profiling Shared by Ankle and Wrist Nodes
+
+   Probes time a stage with the DWT cycle counter
+   and keep count, min, max, mean and a log2
+   histogram per probe. Probe ids and names come
+   from each node's prof_probes.h. A probe measures
+   wall time, so anything that preempts the stage
+   is included. With PROF_ENABLE 0 (default outside
+   DEBUG builds) every probe compiles to nothing.
+   Host builds count nanoseconds instead of cycles.
+   Keep both node copies of prof.h/prof.c identical.
+   ======================================== */
+
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include "prof_probes.h"
+
+#ifndef PROF_ENABLE
+#ifdef DEBUG
+#define PROF_ENABLE 1
+#else
+#define PROF_ENABLE 0
+#endif
+#endif
+
+/* Bin 0: < 512 cycles; bin k: [2^(8+k), 2^(9+k)); last bin open-ended
+   (>= 2^23 cycles: 47 ms at 180 MHz, 1.05 s at 8 MHz) */
+#define PROF_HIST_BINS          16
+#define PROF_HIST_SHIFT         9
+
+typedef enum {
+#define PROF_ENUM(id, name) id,
+    PROF_PROBES(PROF_ENUM)
+#undef PROF_ENUM
+    PROF_COUNT
+} ProfProbe_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t hist[PROF_HIST_BINS];
+} ProfStats_t;
+
+#if PROF_ENABLE
+
+#if defined(__arm__)
+#include "main.h"
+static inline uint32_t Prof_Now(void)
+{
+    return DWT->CYCCNT;
+}
+#else
+uint32_t Prof_Now(void);
+#endif
+
+typedef struct {
+    ProfProbe_t probe;
+    uint32_t start;
+} ProfScope_t;
+
+/* Function prototypes */
+void Prof_Init(void);
+void Prof_Record(ProfProbe_t probe, uint32_t cycles);
+void Prof_Reset(void);
+const ProfStats_t *Prof_Get(ProfProbe_t probe);
+uint32_t Prof_CyclesPerUs(void);
+int Prof_FormatLine(ProfProbe_t probe, char *buf, int size);
+int Prof_FormatHeader(char *buf, int size);
+
+static inline void Prof_ScopeEnd(ProfScope_t *scope)
+{
+    Prof_Record(scope->probe, Prof_Now() - scope->start);
+}
+
+#define PROF_CAT2(a, b)         a##b
+#define PROF_CAT(a, b)          PROF_CAT2(a, b)
+
+/* Time from here to the end of the enclosing block */
+#define PROF_SCOPE(probe) \
+    ProfScope_t PROF_CAT(prof_scope_, __LINE__) __attribute__((cleanup(Prof_ScopeEnd))) = { (probe), Prof_Now() }
+
+/* Spans that start and end in different functions, e.g. across an interrupt */
+#define PROF_VAR(var)           static uint32_t var
+#define PROF_MARK(var)          ((var) = Prof_Now())
+#define PROF_SPAN(probe, var)   Prof_Record((probe), Prof_Now() - (var))
+
+#else
+
+#define Prof_Init()             ((void)0)
+#define Prof_Reset()            ((void)0)
+#define PROF_SCOPE(probe)       ((void)0)
+#define PROF_VAR(var)           extern int prof_disabled_
+#define PROF_MARK(var)          ((void)0)
+#define PROF_SPAN(probe, var)   ((void)0)
+
+#endif /* PROF_ENABLE */
+
+#endif /* PROF_H */
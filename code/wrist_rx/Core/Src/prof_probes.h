@@ -0,0 +1,23 @@
+/* ========================================
+   File: prof_probes.h
+   Wrist Node Profiling Probes
+
+   X(id, name) for each stage timed by prof.h,
+   printed in this order by the 'p' command.
+   Also used by the host benchmark, which runs
+   the logging probes against the emulated card.
+   ======================================== */
+
+#ifndef PROF_PROBES_H
+#define PROF_PROBES_H
+
+#define PROF_PROBES(X) \
+    X(PROF_RADIO_RX,   "radio rx")   /* Radio task pass draining the RX FIFO */ \
+    X(PROF_PPG_READ,   "ppg read")   /* MAX30102 FIFO read */ \
+    X(PROF_VITALS,     "vitals")     /* Motion cancel, HR and SpO2 on one PPG batch */ \
+    X(PROF_PACKET,     "packet")     /* Ankle packet to the log queue */ \
+    X(PROF_LOG_PACKET, "log packet") /* Packet into aligner and vitals pack */ \
+    X(PROF_LOG_TASK,   "log task")   /* One writer pass, card waits included */ \
+    X(PROF_SD_WRITE,   "sd write")   /* One sector to the card */
+
+#endif /* PROF_PROBES_H */
@@ -0,0 +1,268 @@
+/* ========================================
+   File: rtos_support.c
+   FreeRTOS Glue for the Wrist Node
+   ======================================== */
+
+#include "rtos_support.h"
+#include "fatfs.h"
+#include "energy.h"
+#include "fmt.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include <reent.h>
+
+extern UART_HandleTypeDef huart2;
+
+static uint32_t tick_base;
+
+UART_TX_DEFINE(console_tx, &huart2, RTOS_CONSOLE_BUFFER);
+static StaticSemaphore_t console_lock_cb;
+static SemaphoreHandle_t console_lock;
+static uint8_t console_rx;
+static uint8_t console_cmd;             /* Set by the RX interrupt, taken by Rtos_ConsoleCommand */
+
+static TaskHandle_t sd_waiter;
+
+uint8_t Rtos_Running(void)
+{
+    return xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+uint8_t Rtos_InTask(void)
+{
+    return Rtos_Running() && __get_IPSR() == 0 && __get_PRIMASK() == 0;
+}
+
+/* --- HAL timebase ---
+   SysTick keeps advancing uwTick, but tickless idle stops it while the
+   kernel sleeps and only steps the kernel's own count afterwards. */
+uint32_t HAL_GetTick(void)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) return uwTick;
+    return tick_base + xTaskGetTickCount();
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    if (Rtos_InTask()) {
+        vTaskDelay(pdMS_TO_TICKS(Delay) + 1);
+        return;
+    }
+
+    uint32_t start = HAL_GetTick();
+    uint32_t wait = Delay;
+    if (wait < HAL_MAX_DELAY) wait += (uint32_t)uwTickFreq;
+    while (HAL_GetTick() - start < wait) {
+    }
+}
+
+void Rtos_Start(void)
+{
+    /* HAL time carries on from where the boot code left it */
+    tick_base = uwTick;
+    vTaskStartScheduler();
+}
+
+/* --- Kernel hooks --- */
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *stack_words)
+{
+    static StaticTask_t idle_tcb;
+    static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+
+    *tcb = &idle_tcb;
+    *stack = idle_stack;
+    *stack_words = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t task, char *name)
+{
+    Error_Handler();
+}
+
+/* newlib allocates stdio buffers and dtoa temporaries; keep tasks out of each other's malloc */
+void __malloc_lock(struct _reent *r)
+{
+    if (Rtos_Running()) vTaskSuspendAll();
+}
+
+void __malloc_unlock(struct _reent *r)
+{
+    if (Rtos_Running()) xTaskResumeAll();
+}
+
+/* --- Run-time stats ---
+   CYCCNT only counts while the core is clocked, so time asleep in
+   tickless idle is missing from every task; Rtos_PrintTaskStats
+   reports it separately. The counter is read at each context switch,
+   which is far more often than CYCCNT wraps (24 s at 180 MHz). */
+void Rtos_RunTimeInit(void)
+{
+    /* Not cleared: energy.c and prof.c take differences of the same counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t Rtos_RunTimeCounter(void)
+{
+    static uint32_t last, high;
+    uint32_t now = DWT->CYCCNT;
+
+    if (now < last) high++;
+    last = now;
+    return (uint32_t)((((uint64_t)high << 32) | now) >> RTOS_RUNTIME_SHIFT);
+}
+
+void Rtos_PrintTaskStats(void)
+{
+    static TaskStatus_t status[RTOS_MAX_TASKS];
+    static uint32_t last_run[RTOS_MAX_TASKS];
+    static uint32_t last_total, last_tick;
+    uint32_t total;
+
+    UBaseType_t n = uxTaskGetSystemState(status, RTOS_MAX_TASKS, &total);
+    uint32_t now = xTaskGetTickCount();
+
+    /* Wall time in run-time counter units */
+    uint64_t span = ((uint64_t)(now - last_tick) * (SystemCoreClock / configTICK_RATE_HZ)) >> RTOS_RUNTIME_SHIFT;
+    if (span == 0) span = 1;
+
+    uint32_t awake = (uint32_t)((uint64_t)(total - last_total) * 1000 / span);
+    char line[80];
+    Fmt_t f;
+    uint16_t start;
+
+    Fmt_Init(&f, line, sizeof(line));
+    Fmt_Str(&f, "Tasks over ");
+    Fmt_U32(&f, now - last_tick);
+    Fmt_Str(&f, " ms: awake ");
+    Fmt_Fixed(&f, (int32_t)awake, 1);
+    Fmt_Str(&f, "%, asleep ");
+    Fmt_Fixed(&f, 1000 - (int32_t)awake, 1);
+    Fmt_Str(&f, "%\r\n");
+    Rtos_ConsoleWrite(line, Fmt_End(&f));
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        TaskStatus_t *t = &status[i];
+        uint8_t slot = t->xTaskNumber % RTOS_MAX_TASKS;
+        uint32_t cpu = (uint32_t)((uint64_t)(t->ulRunTimeCounter - last_run[slot]) * 1000 / span);
+        uint32_t free_bytes = (uint32_t)t->usStackHighWaterMark * sizeof(StackType_t);
+        last_run[slot] = t->ulRunTimeCounter;
+
+        Fmt_Init(&f, line, sizeof(line));
+        Fmt_Str(&f, "  ");
+        start = f.len;
+        Fmt_Str(&f, t->pcTaskName);
+        Fmt_Left(&f, start, 8);
+        Fmt_Str(&f, " prio ");
+        Fmt_U32(&f, (uint32_t)t->uxCurrentPriority);
+        Fmt_Str(&f, "  cpu ");
+        start = f.len;
+        Fmt_Fixed(&f, (int32_t)cpu, 1);
+        Fmt_Right(&f, start, 4);
+        Fmt_Str(&f, "%  stack free ");
+        start = f.len;
+        Fmt_U32(&f, free_bytes);
+        Fmt_Right(&f, start, 4);
+        Fmt_Str(&f, free_bytes < RTOS_STACK_LOW_BYTES ? " B  LOW\r\n" : " B\r\n");
+        Rtos_ConsoleWrite(line, Fmt_End(&f));
+    }
+
+    last_total = total;
+    last_tick = now;
+}
+
+const UartTxStats_t *Rtos_GetConsoleStats(void)
+{
+    return &console_tx.stats;
+}
+
+/* --- SD driver waits --- */
+void SD_IdleHook(uint32_t waited_ms)
+{
+    /* Card programming or read latency: give up the CPU a tick at a time */
+    if (waited_ms > 0 && Rtos_InTask()) vTaskDelay(1);
+}
+
+void SD_DMA_Sleep(void)
+{
+    if (!Rtos_InTask()) {
+        __WFI();
+        return;
+    }
+    /* A completion that lands before the take leaves the count at 1 */
+    sd_waiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 1);
+}
+
+void SD_ActiveHook(uint8_t active)
+{
+    Energy_Set(ENERGY_SD, active);
+}
+
+void SD_DMA_Done(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (sd_waiter == NULL) return;
+    vTaskNotifyGiveFromISR(sd_waiter, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+/* --- Console --- */
+/* DMA1 Stream6 interrupts: free what USART2 has sent, start the next chunk */
+void HAL_UART_TxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart2) UartTx_HalfDone(&console_tx);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart2) UartTx_Done(&console_tx);
+}
+
+/* One byte at a time; the newest unread command wins */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != &huart2) return;
+    console_cmd = console_rx;
+    HAL_UART_Receive_IT(&huart2, &console_rx, 1);
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == &huart2) {
+        UartTx_Error(&console_tx);
+        HAL_UART_Receive_IT(&huart2, &console_rx, 1);
+    }
+}
+
+/* Last byte received on USART2, 0 if none since the previous call */
+uint8_t Rtos_ConsoleCommand(void)
+{
+    return __atomic_exchange_n(&console_cmd, 0, __ATOMIC_RELAXED);
+}
+
+void Rtos_ConsoleInit(void)
+{
+    console_lock = xSemaphoreCreateMutexStatic(&console_lock_cb);
+    HAL_UART_Receive_IT(&huart2, &console_rx, 1);
+}
+
+/* Copies into the ring, or drops the write whole when it is full; nobody waits
+   on the UART. Boot code is the only writer before the scheduler starts (the
+   kernel masks the DMA interrupt from the first queue created, so the tail of
+   the boot text goes out once tasks run), and interrupts do not print */
+int Rtos_ConsoleWrite(const char *ptr, int len)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        UartTx_Write(&console_tx, ptr, (uint16_t)len);
+        return len;
+    }
+    if (!Rtos_InTask()) return len;
+
+    xSemaphoreTake(console_lock, portMAX_DELAY);
+    UartTx_Write(&console_tx, ptr, (uint16_t)len);
+    xSemaphoreGive(console_lock);
+    return len;
+}
@@ -0,0 +1,44 @@
+/* ========================================
+   File: rtos_support.h
+   FreeRTOS Glue for the Wrist Node
+
+   HAL timebase on top of the kernel tick, static
+   memory for the idle task, the run-time counter
+   for CPU-load stats, SD driver waits that block
+   instead of spinning, and the console: fmt.c lines
+   and setup printf output go into a RAM ring that DMA drains to
+   USART2 (uart_tx.h), so no task ever waits on the
+   UART. Single-byte console commands arrive on the
+   same UART.
+   ======================================== */
+
+#ifndef RTOS_SUPPORT_H
+#define RTOS_SUPPORT_H
+
+#include "main.h"
+#include "uart_tx.h"
+
+/* Console output buffered between the tasks and USART2, a power of two */
+#define RTOS_CONSOLE_BUFFER     2048
+
+/* Run-time counter unit: 2^7 core cycles (0.71 us at 180 MHz) */
+#define RTOS_RUNTIME_SHIFT      7
+
+/* Tasks covered by Rtos_PrintTaskStats, idle included */
+#define RTOS_MAX_TASKS          8
+
+/* Stack high-water marks below this are flagged LOW in Rtos_PrintTaskStats:
+   one exception frame with FPU state plus a FatFs call */
+#define RTOS_STACK_LOW_BYTES    256
+
+/* Function prototypes */
+void Rtos_ConsoleInit(void);
+int Rtos_ConsoleWrite(const char *ptr, int len);
+void Rtos_Start(void);
+uint8_t Rtos_Running(void);
+uint8_t Rtos_InTask(void);
+uint8_t Rtos_ConsoleCommand(void);
+void Rtos_PrintTaskStats(void);
+const UartTxStats_t *Rtos_GetConsoleStats(void);
+
+#endif /* RTOS_SUPPORT_H */
@@ -0,0 +1,409 @@
+/* ========================================
+   File: sd_logger.c
+   Sector-Aligned SD Logging Pipeline
+
+   The formatter appends journal entries to a pair
+   of 512-byte buffers per file, and the writer
+   hands the card one full sector at a time, so
+   every write lands on a sector boundary and never
+   needs a read-modify-write. On the wrist the
+   logger runs in its own low-priority task and the
+   radio task preempts the card waits; the RAM ring
+   behind Logger_PollRadio serves single-threaded
+   builds such as the host benchmark.
+
+   A contiguous log is pre-allocated once with
+   f_expand and erased; after that sectors go to
+   the card as one open CMD25 at known LBAs, with
+   no FAT or directory updates per append.
+
+   Each sync appends a commit marker and rewrites
+   the partial sector. A journal sector is only
+   valid at the index it was written for, so the
+   written part of a pre-allocated log is a prefix
+   found by binary search in O(log n) reads at boot.
+   The last sector is scanned for the entry count
+   (a torn tail is dropped) and the new session
+   starts in the sector after it.
+   ======================================== */
+
+#include "sd_logger.h"
+#include "log_record.h"
+#include "nrf24.h"
+#include "fatfs.h"
+#include "ff.h"
+#include "containers.h"
+#include "prof.h"
+#include <string.h>
+
+typedef struct {
+    FIL fil;
+    uint8_t open;
+    uint8_t buf[2][LOG_SECTOR_SIZE];
+    uint8_t active;         /* Buffer being filled */
+    uint16_t fill;
+    uint8_t pending;        /* Other buffer holds the sealed sector before this one */
+    uint8_t dirty;          /* Entries appended since the last commit */
+    uint32_t sector;        /* File sector the active buffer belongs to */
+    uint32_t next_seq;
+    uint16_t session;
+    uint32_t last_sync;
+    uint8_t raw;            /* Contiguous file written below FatFs */
+    DWORD lba_start;
+    DWORD lba_count;
+} LogStream_t;
+
+RING_DEFINE(rx_ring, LogPacket_t, LOG_RX_RING);
+
+static LogStream_t streams[LOG_STREAMS];
+static LogStats_t stats;
+
+void Logger_Init(void)
+{
+    Ring_Reset(&rx_ring);
+    memset(streams, 0, sizeof(streams));
+    memset(&stats, 0, sizeof(stats));
+}
+
+/* One file sector to the card; returns 1 on success */
+static uint8_t Logger_Write(LogStream_t *s, uint32_t index, const uint8_t *buf)
+{
+    PROF_SCOPE(PROF_SD_WRITE);
+
+    if (s->raw) {
+        return SD_StreamWrite(s->lba_start + index, buf) == RES_OK;
+    }
+
+    UINT bw;
+    FSIZE_t pos = (FSIZE_t)index * LOG_SECTOR_SIZE;
+    if (f_tell(&s->fil) != pos && f_lseek(&s->fil, pos) != FR_OK) return 0;
+    return f_write(&s->fil, buf, LOG_SECTOR_SIZE, &bw) == FR_OK && bw == LOG_SECTOR_SIZE;
+}
+
+static uint8_t Logger_Read(LogStream_t *s, uint32_t index, uint8_t *buf)
+{
+    stats.recovery_reads++;
+    if (s->raw) {
+        return SD_disk_read(s->fil.obj.fs->drv, buf, s->lba_start + index, 1) == RES_OK;
+    }
+
+    UINT br;
+    memset(buf, 0, LOG_SECTOR_SIZE);
+    if (f_lseek(&s->fil, (FSIZE_t)index * LOG_SECTOR_SIZE) != FR_OK) return 0;
+    return f_read(&s->fil, buf, LOG_SECTOR_SIZE, &br) == FR_OK;
+}
+
+static uint8_t Logger_Flush(LogStream_t *s)
+{
+    if (s->raw) return SD_StreamStop() == RES_OK;
+    return f_sync(&s->fil) == FR_OK;
+}
+
+/* Entry count up to the last intact entry of a journal sector */
+static uint32_t Logger_ScanSector(const uint8_t *sector)
+{
+    JournalSectorHeader_t hdr;
+    JournalEntry_t entry;
+    memcpy(&hdr, sector, sizeof(hdr));
+
+    uint32_t seq = hdr.first_seq;
+    uint16_t off = JOURNAL_SECTOR_HEADER;
+    while (1) {
+        uint16_t next = Journal_NextEntry(sector, off, seq, &entry);
+        if (next == JOURNAL_END) break;
+        if (next == JOURNAL_CORRUPT) {
+            stats.torn_entries++;
+            break;
+        }
+        stats.recovered_entries++;
+        seq++;
+        off = next;
+    }
+    return seq;
+}
+
+/* Header in sector 0, then a new session after the last journal sector before end */
+static uint8_t Logger_Resume(LogStream_t *s, const void *header, uint16_t header_len, uint32_t end)
+{
+    uint8_t *buf = s->buf[0];
+
+    if (end == 0 || !Logger_Read(s, 0, buf) || memcmp(buf, header, 4) != 0) {
+        memset(buf, 0, LOG_SECTOR_SIZE);
+        memcpy(buf, header, header_len);
+        if (!Logger_Write(s, 0, buf) || !Logger_Flush(s)) return 1;
+        end = 1;
+    }
+
+    uint8_t found = 0;
+    s->sector = end;
+    while (!found && s->sector > 1) {
+        s->sector--;
+        if (!Logger_Read(s, s->sector, buf)) return 1;
+        found = Journal_SectorValid(buf, s->sector);
+    }
+
+    s->next_seq = 0;
+    s->session = 1;
+    if (found) {
+        /* Whatever is torn stays behind; the old sector is never rewritten */
+        JournalSectorHeader_t hdr;
+        memcpy(&hdr, buf, sizeof(hdr));
+        s->next_seq = Logger_ScanSector(buf);
+        s->session = hdr.session + 1;
+        s->sector++;
+    }
+    Journal_InitSector(buf, s->session, s->sector, s->next_seq, HAL_GetTick());
+    s->fill = JOURNAL_SECTOR_HEADER;
+
+    s->open = 1;
+    s->active = 0;
+    s->pending = 0;
+    s->dirty = 0;
+    s->last_sync = HAL_GetTick();
+    return 0;
+}
+
+uint8_t Logger_Open(uint8_t stream, const char *path, const void *header, uint16_t header_len)
+{
+    if (stream >= LOG_STREAMS) return 1;
+    LogStream_t *s = &streams[stream];
+
+    if (f_open(&s->fil, path, FA_READ | FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) return 1;
+    s->raw = 0;
+
+    /* Commits always write whole sectors, so the size ends on a sector */
+    uint32_t end = (f_size(&s->fil) + LOG_SECTOR_SIZE - 1) / LOG_SECTOR_SIZE;
+    if (Logger_Resume(s, header, header_len, end) != 0) {
+        f_close(&s->fil);
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t Logger_OpenContiguous(uint8_t stream, const char *path, uint32_t size, const void *header, uint16_t header_len)
+{
+    if (stream >= LOG_STREAMS) return 1;
+    LogStream_t *s = &streams[stream];
+
+    if (f_open(&s->fil, path, FA_READ | FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) return 1;
+    FATFS *fs = s->fil.obj.fs;
+    uint8_t fresh = (f_size(&s->fil) == 0);
+
+    if (fresh) {
+        /* One contiguous cluster run; the directory entry is final from here on */
+        if (f_expand(&s->fil, size, 1) != FR_OK || f_sync(&s->fil) != FR_OK) {
+            f_close(&s->fil);
+            f_unlink(path);
+            return 1;
+        }
+    } else if (f_size(&s->fil) != size) {
+        f_close(&s->fil); /* Appended log from the FatFs path */
+        return 1;
+    }
+
+    s->raw = 1;
+    s->lba_start = fs->database + (DWORD)fs->csize * (s->fil.obj.sclust - 2);
+    s->lba_count = size / LOG_SECTOR_SIZE;
+
+    uint32_t end = 0;
+    if (fresh) {
+        /* Old data in the clusters must not pass for journal sectors */
+        DWORD range[2] = { s->lba_start, s->lba_start + s->lba_count - 1 };
+        if (SD_disk_ioctl(fs->drv, CTRL_TRIM, range) != RES_OK) {
+            f_close(&s->fil);
+            f_unlink(path);
+            return 1;
+        }
+    } else {
+        /* First sector that is not a journal sector at its own index */
+        uint32_t lo = 1, hi = s->lba_count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (!Logger_Read(s, mid, s->buf[0])) {
+                f_close(&s->fil);
+                return 1;
+            }
+            if (Journal_SectorValid(s->buf[0], mid)) lo = mid + 1; else hi = mid;
+        }
+        end = lo;
+    }
+
+    if (Logger_Resume(s, header, header_len, end) != 0) {
+        f_close(&s->fil);
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t Logger_IsRaw(uint8_t stream)
+{
+    return streams[stream].raw;
+}
+
+uint32_t Logger_NextSeq(uint8_t stream)
+{
+    return streams[stream].next_seq;
+}
+
+uint16_t Logger_Session(uint8_t stream)
+{
+    return streams[stream].session;
+}
+
+void Logger_PollRadio(void)
+{
+    while (!nRF24_RxFifoEmpty()) {
+        LogPacket_t *p = Ring_Slot(&rx_ring);
+        if (p == NULL) {
+            /* Payload still has to leave the FIFO or reception stalls */
+            sentData_t discard;
+            nRF24_ReadPayload((uint8_t *)&discard, sizeof(sentData_t));
+            stats.packets_dropped++;
+            continue;
+        }
+
+        nRF24_ReadPayload((uint8_t *)&p->data, sizeof(sentData_t));
+        p->rx_tick = HAL_GetTick();
+        Ring_Commit(&rx_ring);
+        stats.packets_received++;
+        if (Ring_Count(&rx_ring) > stats.ring_high_water) stats.ring_high_water = Ring_Count(&rx_ring);
+    }
+}
+
+uint8_t Logger_GetPacket(LogPacket_t *packet)
+{
+    return Ring_Pop(&rx_ring, packet) ? 0 : 1;
+}
+
+uint16_t Logger_Free(uint8_t stream)
+{
+    LogStream_t *s = &streams[stream];
+    if (!s->open) return 2 * LOG_SECTOR_SIZE; /* No card: records are discarded */
+    return (LOG_SECTOR_SIZE - s->fill) + (s->pending ? 0 : LOG_SECTOR_SIZE - JOURNAL_SECTOR_HEADER);
+}
+
+/* Largest payload that still fits in the sector being filled */
+uint16_t Logger_Room(uint8_t stream)
+{
+    LogStream_t *s = &streams[stream];
+    uint16_t left = LOG_SECTOR_SIZE - s->fill;
+    if (left <= JOURNAL_ENTRY_SIZE(0)) return 0;
+    left -= JOURNAL_ENTRY_SIZE(0);
+    return left > 255 ? 255 : left;
+}
+
+/* 1 when the next Logger_Task commits this stream: entries appended now make the commit */
+uint8_t Logger_SyncDue(uint8_t stream)
+{
+    LogStream_t *s = &streams[stream];
+    return s->open && !s->pending && HAL_GetTick() - s->last_sync >= LOG_SYNC_MS;
+}
+
+static uint8_t Logger_AppendTo(LogStream_t *s, uint8_t type, const void *payload, uint8_t len)
+{
+    if (s->fill + JOURNAL_ENTRY_SIZE(len) > LOG_SECTOR_SIZE) {
+        if (s->pending) {
+            stats.records_deferred++;
+            return 1;
+        }
+        /* Hand the full sector to the writer and start the next one */
+        s->pending = 1;
+        s->active ^= 1;
+        s->sector++;
+        Journal_InitSector(s->buf[s->active], s->session, s->sector, s->next_seq, HAL_GetTick());
+        s->fill = JOURNAL_SECTOR_HEADER;
+    }
+
+    s->fill += Journal_Encode(&s->buf[s->active][s->fill], type, s->next_seq, payload, len);
+    s->next_seq++;
+    s->dirty = 1;
+    return 0;
+}
+
+uint8_t Logger_Append(uint8_t stream, uint8_t type, const void *payload, uint8_t len)
+{
+    if (stream >= LOG_STREAMS) return 1;
+    LogStream_t *s = &streams[stream];
+    if (!s->open) return 0;
+    return Logger_AppendTo(s, type, payload, len);
+}
+
+static void Logger_WriteSector(LogStream_t *s)
+{
+    uint32_t index = s->sector - 1;
+    uint32_t start = HAL_GetTick();
+
+    if (s->raw && index >= s->lba_count) {
+        /* Pre-allocated file is full; stop rather than wrap over old data */
+        stats.sectors_dropped++;
+        s->pending = 0;
+        s->open = 0;
+        SD_StreamStop();
+        return;
+    }
+
+    uint8_t ok = Logger_Write(s, index, s->buf[s->active ^ 1]);
+    uint32_t took = HAL_GetTick() - start;
+
+    if (!ok) {
+        stats.write_errors++;
+    } else {
+        stats.sectors_written++;
+    }
+    if (took > stats.write_max_ms) stats.write_max_ms = took;
+    s->pending = 0;
+}
+
+/* Commit marker and partial sector; the full sector overwrites it later */
+static void Logger_Sync(LogStream_t *s)
+{
+    uint32_t start = HAL_GetTick();
+
+    if (s->dirty) {
+        LogCommitRecord_t commit;
+        commit.time_ms = start;
+        if (Logger_AppendTo(s, LOG_REC_COMMIT, &commit, sizeof(commit)) != 0) return;
+        if (s->pending) {
+            Logger_WriteSector(s);
+            if (!s->open) return;
+        }
+
+        if (s->raw && s->sector >= s->lba_count) {
+            stats.sectors_dropped++;
+        } else if (!Logger_Write(s, s->sector, s->buf[s->active])) {
+            stats.write_errors++;
+        }
+        s->dirty = 0;
+        stats.commits++;
+    }
+    if (!Logger_Flush(s)) stats.write_errors++;
+
+    uint32_t took = HAL_GetTick() - start;
+    if (took > stats.sync_max_ms) stats.sync_max_ms = took;
+    s->last_sync = HAL_GetTick();
+}
+
+void Logger_Task(void)
+{
+    /* At most one card operation per call keeps the superloop responsive */
+    for (uint8_t i = 0; i < LOG_STREAMS; i++) {
+        LogStream_t *s = &streams[i];
+        if (s->open && s->pending) {
+            Logger_WriteSector(s);
+            return;
+        }
+    }
+
+    for (uint8_t i = 0; i < LOG_STREAMS; i++) {
+        LogStream_t *s = &streams[i];
+        if (s->open && HAL_GetTick() - s->last_sync >= LOG_SYNC_MS) {
+            Logger_Sync(s);
+            return;
+        }
+    }
+}
+
+const LogStats_t *Logger_GetStats(void)
+{
+    return &stats;
+}
@@ -0,0 +1,67 @@
+/* ========================================
+   File: sd_logger.h
+   Sector-Aligned SD Logging Pipeline
+   ======================================== */
+
+#ifndef SD_LOGGER_H
+#define SD_LOGGER_H
+
+#include "main.h"
+#include "log_journal.h"
+
+#define LOG_SECTOR_SIZE         JOURNAL_SECTOR_SIZE
+
+/* Room a caller needs before appending its largest entry (a packed block) */
+#define LOG_ENTRY_MAX           JOURNAL_ENTRY_SIZE(255)
+
+/* Radio payloads held while the card is busy (one per 5 steps) */
+#define LOG_RX_RING             32
+
+/* Output files kept open by the logger */
+#define LOG_STREAMS             1
+#define LOG_STREAM_RECORDS      0
+
+/* Commit marker, partial sector and FAT entries go out this often */
+#define LOG_SYNC_MS             5000
+
+/* Size of a pre-allocated contiguous log (about 4M records) */
+#define LOG_PREALLOC_BYTES      (64UL * 1024 * 1024)
+
+typedef struct {
+    uint32_t rx_tick;       /* Wrist tick when the payload left the radio */
+    sentData_t data;
+} LogPacket_t;
+
+typedef struct {
+    uint32_t packets_received;
+    uint32_t packets_dropped;   /* RX ring full; means the writer fell behind */
+    uint16_t ring_high_water;
+    uint32_t records_deferred;  /* Formatter waited for a free sector buffer */
+    uint32_t sectors_written;
+    uint32_t write_errors;
+    uint32_t sectors_dropped;   /* Contiguous log file is full */
+    uint32_t commits;
+    uint32_t write_max_ms;      /* Slowest single sector write */
+    uint32_t sync_max_ms;       /* Slowest commit */
+    uint32_t recovery_reads;    /* Sectors read at boot to find the journal end */
+    uint32_t recovered_entries; /* Valid entries in the last sector of the previous session */
+    uint32_t torn_entries;      /* Corrupt tail entries discarded at boot */
+} LogStats_t;
+
+/* Function prototypes */
+void Logger_Init(void);
+uint8_t Logger_Open(uint8_t stream, const char *path, const void *header, uint16_t header_len);
+uint8_t Logger_OpenContiguous(uint8_t stream, const char *path, uint32_t size, const void *header, uint16_t header_len);
+uint8_t Logger_IsRaw(uint8_t stream);
+void Logger_PollRadio(void);
+uint8_t Logger_GetPacket(LogPacket_t *packet);
+uint16_t Logger_Free(uint8_t stream);
+uint16_t Logger_Room(uint8_t stream);
+uint8_t Logger_SyncDue(uint8_t stream);
+uint8_t Logger_Append(uint8_t stream, uint8_t type, const void *payload, uint8_t len);
+uint32_t Logger_NextSeq(uint8_t stream);
+uint16_t Logger_Session(uint8_t stream);
+void Logger_Task(void);
+const LogStats_t *Logger_GetStats(void);
+
+#endif /* SD_LOGGER_H */
@@ -0,0 +1,181 @@
+/* ========================================
+   File: step_align.c
+   Step / Heart-Rate Time Alignment
+
+   The ankle sends step periods relative to the
+   previous step. A full batch leaves the ankle on
+   its fifth step and a partial one after the flush
+   timeout, so the reception tick pins the last step
+   and the periods walk back from there. Each step is
+   held until an HR estimate exists on both sides of
+   it, then joined with the interpolated value.
+   ======================================== */
+
+#include "step_align.h"
+#include <string.h>
+
+#define BATCH_STEPS     5
+
+typedef struct {
+    uint32_t tick;
+    int32_t bpm;
+} HRSample_t;
+
+static HRSample_t hr_history[ALIGN_HR_HISTORY];
+static uint8_t hr_head = 0;     /* Next slot to write */
+static uint8_t hr_count = 0;
+
+static AlignedStep_t pending[ALIGN_PENDING_STEPS];
+static uint8_t pending_head = 0; /* Oldest step */
+static uint8_t pending_count = 0;
+
+static uint32_t last_step_number = 0;
+static AlignStats_t stats;
+
+void Align_Init(void)
+{
+    hr_head = 0;
+    hr_count = 0;
+    pending_head = 0;
+    pending_count = 0;
+    last_step_number = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+static void Align_Push(const AlignedStep_t *step)
+{
+    if (pending_count == ALIGN_PENDING_STEPS) {
+        pending_head = (pending_head + 1) % ALIGN_PENDING_STEPS;
+        pending_count--;
+        stats.steps_overflow++;
+    }
+    pending[(pending_head + pending_count) % ALIGN_PENDING_STEPS] = *step;
+    pending_count++;
+}
+
+void Align_AddBatch(const sentData_t *batch, uint32_t rx_tick)
+{
+    uint8_t n = 0;
+    while (n < BATCH_STEPS && batch->steps[n].period != 0) n++;
+    if (n == 0) return;
+
+    /* Absolute wrist time of every step, walking back from the last one.
+       A step from before the wrist booted is timed at tick 0, not wrapped. */
+    uint32_t times[BATCH_STEPS];
+    uint8_t early = 0;      /* Steps 0..early-1 predate the boot */
+    int64_t t = (int64_t)rx_tick - ((n < BATCH_STEPS) ? ALIGN_FLUSH_DELAY_MS : 0);
+    for (int i = n - 1; i >= 0; i--) {
+        times[i] = t > 0 ? (uint32_t)t : 0;
+        if (t < 0 && early == 0) early = (uint8_t)(i + 1);
+        t -= batch->steps[i].period;
+    }
+
+    uint32_t first = batch->step_initial_count;
+
+    /* step_initial_count is 16-bit on air; extend it against our counter */
+    if (last_step_number != 0) {
+        first |= last_step_number & 0xFFFF0000u;
+        if (first + 0x8000u < last_step_number) first += 0x10000u;
+    }
+
+    /* Far behind our counter means the ankle restarted, not a retransmit */
+    if (last_step_number != 0 && first + BATCH_STEPS <= last_step_number) {
+        last_step_number = 0;
+    }
+
+    if (last_step_number != 0 && first > last_step_number + 1) {
+        stats.steps_lost += first - last_step_number - 1;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        uint32_t number = first + i;
+        if (last_step_number != 0 && number <= last_step_number) {
+            stats.steps_duplicate++;
+            continue;
+        }
+
+        AlignedStep_t step;
+        step.step_number = number;
+        step.time_ms = times[i];
+        step.period = batch->steps[i].period;
+        step.intensity = batch->steps[i].intensity;
+        step.heart_rate = 0;
+        step.hr_valid = 0;
+        step.temp = batch->temp;
+        if (i < early) stats.steps_early++;
+        Align_Push(&step);
+        last_step_number = number;
+    }
+}
+
+void Align_AddHeartRate(int32_t bpm, uint32_t tick)
+{
+    hr_history[hr_head].tick = tick;
+    hr_history[hr_head].bpm = bpm;
+    hr_head = (hr_head + 1) % ALIGN_HR_HISTORY;
+    if (hr_count < ALIGN_HR_HISTORY) hr_count++;
+}
+
+/* Signed tick difference a - b, safe across the 32-bit wrap */
+static int32_t Align_Diff(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b);
+}
+
+/* Interpolate HR at time t; returns 1 if an estimate after t exists */
+static uint8_t Align_Lookup(uint32_t t, int32_t *bpm, uint8_t *valid)
+{
+    const HRSample_t *before = NULL, *after = NULL;
+
+    for (uint8_t i = 0; i < hr_count; i++) {
+        const HRSample_t *s = &hr_history[(hr_head + ALIGN_HR_HISTORY - 1 - i) % ALIGN_HR_HISTORY];
+        if (Align_Diff(s->tick, t) >= 0) {
+            after = s;
+        } else {
+            before = s;
+            break;
+        }
+    }
+
+    *bpm = 0;
+    *valid = 0;
+
+    int32_t d_before = before ? Align_Diff(t, before->tick) : INT32_MAX;
+    int32_t d_after = after ? Align_Diff(after->tick, t) : INT32_MAX;
+
+    if (before && after && d_before <= ALIGN_HR_TOLERANCE_MS && d_after <= ALIGN_HR_TOLERANCE_MS) {
+        int32_t span = d_before + d_after;
+        *bpm = before->bpm + (span ? (after->bpm - before->bpm) * d_before / span : 0);
+        *valid = 1;
+    } else if (d_before <= d_after && d_before <= ALIGN_HR_TOLERANCE_MS) {
+        *bpm = before->bpm;
+        *valid = 1;
+    } else if (d_after <= ALIGN_HR_TOLERANCE_MS) {
+        *bpm = after->bpm;
+        *valid = 1;
+    }
+
+    return after != NULL;
+}
+
+uint8_t Align_GetRecord(AlignedStep_t *record, uint32_t now)
+{
+    if (pending_count == 0) return 1;
+
+    AlignedStep_t *step = &pending[pending_head];
+    uint8_t have_after = Align_Lookup(step->time_ms, &step->heart_rate, &step->hr_valid);
+
+    /* Hold the step until HR after it is known, unless it has waited too long */
+    if (!have_after && Align_Diff(now, step->time_ms) < ALIGN_MAX_WAIT_MS) return 1;
+
+    *record = *step;
+    pending_head = (pending_head + 1) % ALIGN_PENDING_STEPS;
+    pending_count--;
+    stats.steps_aligned++;
+    return 0;
+}
+
+const AlignStats_t *Align_GetStats(void)
+{
+    return &stats;
+}
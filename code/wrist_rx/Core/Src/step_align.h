@@ -0,0 +1,51 @@
+/* ========================================
+   File: step_align.h
+   Step / Heart-Rate Time Alignment
+   ======================================== */
+
+#ifndef STEP_ALIGN_H
+#define STEP_ALIGN_H
+
+#include "main.h"
+
+/* HR estimates kept for interpolation (one every few beats) */
+#define ALIGN_HR_HISTORY        32
+
+/* Reconstructed steps waiting for an HR estimate after them */
+#define ALIGN_PENDING_STEPS     16
+
+/* Ankle flushes a partial batch this long after its last step */
+#define ALIGN_FLUSH_DELAY_MS    2500
+
+/* Emit a step with the nearest estimate if nothing newer arrives */
+#define ALIGN_MAX_WAIT_MS       5000
+
+/* Largest distance to an HR estimate that still counts as valid */
+#define ALIGN_HR_TOLERANCE_MS   5000
+
+typedef struct {
+    uint32_t step_number;
+    uint32_t time_ms;       /* Wrist tick at which the step happened */
+    uint16_t period;
+    uint16_t intensity;
+    int32_t heart_rate;     /* bpm at time_ms, 0 if unknown */
+    uint8_t hr_valid;
+    float temp;
+} AlignedStep_t;
+
+typedef struct {
+    uint32_t steps_aligned;
+    uint32_t steps_lost;        /* Gaps in step numbering (missed packets) */
+    uint32_t steps_duplicate;   /* Retransmitted batches */
+    uint32_t steps_overflow;    /* Dropped because the merge buffer was full */
+    uint32_t steps_early;       /* Before the wrist booted, timed at tick 0 */
+} AlignStats_t;
+
+/* Function prototypes */
+void Align_Init(void);
+void Align_AddBatch(const sentData_t *batch, uint32_t rx_tick);
+void Align_AddHeartRate(int32_t bpm, uint32_t tick);
+uint8_t Align_GetRecord(AlignedStep_t *record, uint32_t now);
+const AlignStats_t *Align_GetStats(void);
+
+#endif /* STEP_ALIGN_H */
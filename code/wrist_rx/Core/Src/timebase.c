@@ -0,0 +1,33 @@
+/* ========================================
+   File: timebase.c
+   Microsecond Timebase Shared by Ankle and Wrist Nodes
+   ======================================== */
+
+#include "timebase.h"
+
+/* After SystemClock_Config: the prescaler is worked out from the APB1 clock */
+void Time_Init(void)
+{
+    uint32_t clk = HAL_RCC_GetPCLK1Freq();
+
+    /* APB1 timers run at twice PCLK1 whenever APB1 is divided */
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) clk *= 2;
+
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    TIM2->CR1 = 0;
+    TIM2->PSC = clk / 1000000 - 1;
+    TIM2->ARR = 0xFFFFFFFFu;
+    TIM2->CNT = 0;
+    TIM2->EGR = TIM_EGR_UG;     /* Loads the prescaler now instead of at the first overflow */
+    TIM2->SR = 0;
+    TIM2->CR1 = TIM_CR1_CEN;
+}
+
+/* Busy wait, for setup and hold times shorter than a tick */
+void Time_DelayUs(uint32_t us)
+{
+    uint32_t start = Time_NowUs();
+
+    while (Time_SinceUs(start) < us) {
+    }
+}
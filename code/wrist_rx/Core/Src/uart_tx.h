@@ -0,0 +1,57 @@
+/* ========================================
+   File: uart_tx.h
+   DMA UART Transmit Shared by Ankle and Wrist Nodes
+
+   Writers copy whole messages into a RAM byte ring
+   and return at once; a message that does not fit
+   is dropped and counted, never waited for. The
+   ring drains as DMA chunks: the half-transfer
+   callback frees the first half of a chunk early,
+   the transfer-complete callback frees the rest and
+   starts the next contiguous run. Writers must not
+   run concurrently (one context, or serialized by
+   the caller); the callbacks run in interrupts.
+   Keep both node copies of this file identical.
+   ======================================== */
+
+#ifndef UART_TX_H
+#define UART_TX_H
+
+#include "main.h"
+#include "containers.h"
+
+typedef struct {
+    uint32_t bytes_sent;
+    uint32_t bytes_dropped;     /* Writes refused with the ring full */
+    uint32_t writes_dropped;
+    uint32_t peak;              /* Most bytes queued at once */
+    uint32_t errors;            /* Transfers aborted by a DMA or UART error */
+} UartTxStats_t;
+
+typedef struct {
+    UART_HandleTypeDef *huart;
+    Ring_t *ring;
+    volatile uint16_t inflight; /* Bytes handed to the DMA, still held in the ring */
+    volatile uint16_t released; /* Of those, freed at half transfer */
+    UartTxStats_t stats;
+} UartTx_t;
+
+/* Ring capacity must be a power of two */
+#define UART_TX_DEFINE(name, huart, capacity) \
+    RING_DEFINE(name##_ring, uint8_t, capacity); \
+    static UartTx_t name = { (huart), &name##_ring, 0, 0, { 0, 0, 0, 0, 0 } }
+
+/* Function prototypes */
+uint8_t UartTx_Write(UartTx_t *tx, const void *data, uint16_t len);
+void UartTx_Kick(UartTx_t *tx);
+void UartTx_HalfDone(UartTx_t *tx);
+void UartTx_Done(UartTx_t *tx);
+void UartTx_Error(UartTx_t *tx);
+uint8_t UartTx_Flush(UartTx_t *tx, uint32_t timeout_ms);
+
+static inline uint32_t UartTx_Space(const UartTx_t *tx)
+{
+    return Ring_Space(tx->ring);
+}
+
+#endif /* UART_TX_H */